@@ -14,8 +14,10 @@
 // limitations under the License.
 //
 
+#include <exception>
 #include <functional>
 
+#include <pixl/async.h>
 #include <pixl/errors.h>
 #include <pixl/io.h>
 #include "job.h"
@@ -33,41 +35,65 @@ void Job::setInfoHandler(std::function<void(const std::string&)> handler) {
     this->infoHandler = handler;
 }
 
-// ---------------------------------------------------------------------------
-// TODO in case of an exception. Will the image be destructed ???
+// ----------------------------------------------------------------------------
+// Message of an error passed to a callback of the async api.
+static std::string errorMessage(std::exception_ptr error) {
+    try {
+        std::rethrow_exception(error);
+    } catch (pixl::PixlException& e) {
+        return e.getMessage();
+    } catch (std::exception& e) {
+        return e.what();
+    } catch (...) {
+        return "unknown error";
+    }
+}
+
+// ----------------------------------------------------------------------------
 void Job::start(std::function<void(bool)> handler) {
     this->doneHandler = handler;
 
+    // all steps below inherit the context
+    pixl::ExecutionContext context;
+    context.token = &this->token;
+    context.onProgress = [this](float progress) {
+        const int percent = (int)(progress * 100);
+        if (percent % 25 == 0) {
+            postInfoMessage(std::to_string(percent) + "%");
+        }
+    };
+    pixl::ContextScope scope(context);
+
     // read image
     postInfoMessage("Decoding input image: " + this->input);
-    pixl::Image* image;
-    try {
-        image = pixl::read(this->input.c_str());
-        if (image == nullptr) {
-            postInfoMessage("Failed to read image: " + this->input);
+    pixl::read_async(this->input, [this](pixl::Image* image, std::exception_ptr error) {
+        if (error) {
+            postInfoMessage("Error while decoding: " + errorMessage(error));
             doneHandler(false);
             return;
         }
-    } catch (pixl::PixlException e) {
-        postInfoMessage("Error while decoding; " + e.getMessage());
-        doneHandler(false);
-        return;
-    }
 
-    // apply operation
-    postInfoMessage("Applying operation");
-    operation(image);
+        // apply operation
+        postInfoMessage("Applying operation");
+        try {
+            operation(image);
+        } catch (...) {
+            delete image;
+            postInfoMessage("Error while processing: " + errorMessage(std::current_exception()));
+            doneHandler(false);
+            return;
+        }
 
-    // write image
-    postInfoMessage("Encoding output image: " + this->output);
-    try {
-        pixl::write(image, this->output.c_str());
-        doneHandler(true);
-    } catch (pixl::PixlException e) {
-        postInfoMessage("Error while decoding; " + e.getMessage());
-        doneHandler(false);
-        return;
-    }
+        // write image
+        postInfoMessage("Encoding output image: " + this->output);
+        pixl::write_async(image, this->output, 75, [this, image](std::exception_ptr error) {
+            delete image;
+            if (error) {
+                postInfoMessage("Error while encoding: " + errorMessage(error));
+            }
+            doneHandler(!error);
+        });
+    });
 }
 
 // ----------------------------------------------------------------------------
@@ -75,4 +101,9 @@ void Job::postInfoMessage(const std::string message) {
     if (this->infoHandler != nullptr) {
         this->infoHandler(message);
     }
-}
\ No newline at end of file
+}
+
+// ----------------------------------------------------------------------------
+void Job::cancel() {
+    this->token.cancel();
+}
@@ -21,6 +21,7 @@
 #include <thread>
 #include <functional>
 
+#include <pixl/context.h>
 #include <pixl/operations.h>
 #include <pixl/image.h>
 
@@ -33,8 +34,14 @@ public:
         std::function<void(pixl::Image*)> operation);
 
     void setInfoHandler(std::function<void(const std::string&)> handler);
+
+    // Starts the job & returns right away. The handler is called from a thread of the pixl
+    // thread pool once the job is done, the job must stay alive until then.
     void start(std::function<void(bool)> handler);
 
+    // Aborts a started job as soon as possible, the handler of start() is called with false.
+    void cancel();
+
 private:
     std::string name;
     std::string input;
@@ -42,6 +49,7 @@ private:
     std::function<void(pixl::Image*)> operation;
     std::function<void(const std::string&)> infoHandler;
     std::function<void(bool)> doneHandler;
+    pixl::CancellationToken token;
 
     void postInfoMessage(const std::string message);
 };
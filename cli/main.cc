@@ -16,6 +16,7 @@
 
 #define VERSION "0.1.0"
 
+#include <cstdlib>
 #include <vector>
 
 #include <pixl/pixl.h>
@@ -32,6 +33,7 @@ static CliParser parser;
 
 static CliSubcommand flipCmd("flip");
 static CliSubcommand resizeCmd("resize");
+static CliSubcommand runCmd("run");
 
 static CliArg helpArg("h", "Prints the help", false);
 static CliArg versionArg("v", "Prints the version number", false);
@@ -41,6 +43,14 @@ static CliArg sizeArg("s",
                       "Specifies the new image dimensions for the output image. Must be in the "
                       "form 512x512 (width, height) or 1.2 (upscale) / 0.8 (downscale)",
                       true);
+static CliArg pipelineArg("p",
+                          "Pipeline spec, e.g. resize:512x512|contrast:1.2|jpeg:q=82:420",
+                          true,
+                          true);
+static CliArg cacheArg("c", "Directory of a result cache used by run (max. 1 GiB)", true);
+static CliArg deadlineArg("d",
+                          "Time budget of run in milliseconds, the result is degraded if needed",
+                          true);
 
 
 // ----------------------------------------------------------------------------
@@ -64,6 +74,14 @@ int main(int argc, char** argv) {
     resizeCmd.addArg(&sizeArg);
     parser.addSubcommand(&resizeCmd);
 
+    // Run subcommand
+    runCmd.addArg(&inputArg);
+    runCmd.addArg(&outputArg);
+    runCmd.addArg(&pipelineArg);
+    runCmd.addArg(&cacheArg);
+    runCmd.addArg(&deadlineArg);
+    parser.addSubcommand(&runCmd);
+
     if (parser.parse(argc, argv, result)) {
         process_command(result);
     } else {
@@ -118,5 +136,25 @@ void process_command(CliParserResult& result) {
     } else if (cmd == &flipCmd) {
         // TODO parse orientation from cli result
         // execute_operation("flip", inputArg.param, outputArg.param, &flip);
+        // Run
+    } else if (cmd == &runCmd) {
+        try {
+            auto pipeline = pixl::Pipeline::parse(pipelineArg.param);
+            if (result.getArgument(cacheArg.name) != nullptr) {
+                pipeline.cache = std::make_shared<pixl::DiskCache>(cacheArg.param, 1ull << 30);
+            }
+            if (result.getArgument(deadlineArg.name) != nullptr) {
+                pixl::DeadlinePipeline deadline(pipeline, atof(deadlineArg.param.c_str()) / 1000);
+                deadline.write(inputArg.param.c_str(), outputArg.param.c_str());
+                for (auto degradation : deadline.report().degradations) {
+                    LOG_INFO("Degraded: " << pixl::degradation_name(degradation));
+                }
+            } else {
+                pipeline.write(inputArg.param.c_str(), outputArg.param.c_str());
+            }
+            LOG_SUCCESS(outputArg.param);
+        } catch (pixl::PixlException& e) {
+            LOG_ERROR(e.getMessage());
+        }
     }
 }
\ No newline at end of file
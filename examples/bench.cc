@@ -14,28 +14,446 @@
 // limitations under the License.
 //
 
+// Benchmark suite of the operations & codecs.
+//
+// Every benchmark runs for each image size, channel count & number of threads it supports
+// and reports the best time of a few runs as megapixels & bytes (of the uncompressed image)
+// per second. Build with -DCMAKE_BUILD_TYPE=Release.
+//
+//     bench                          all benchmarks
+//     bench --filter='^resize'       only the ones whose name matches the regex
+//     bench --sizes=1mp,12mp --channels=3 --threads=1,8
+//     bench --json > results.json    machine readable results
+//     bench --list                   names only
+//
+// Names are <benchmark>/<size>/c<channels>/t<threads>, e.g. invert/12mp/c3/t4.
+
 #include <pixl/pixl.h>
-#include <pixl/debug.h>
+#include <pixl/operations.h>
 
-#include <thread>
+#include <algorithm>
 #include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace pixl;
+
+// Temporary file of the png benchmarks, in the working directory
+#define PNG_FILE "bench.png"
+
+// A named image size.
+struct Size {
+    std::string name;
+    u32 width;
+    u32 height;
+};
+
+static const std::vector<Size> SIZES = {
+    {"64", 64, 64},
+    {"512", 512, 512},
+    {"1mp", 1024, 1024},
+    {"12mp", 4000, 3000},
+    {"50mp", 8660, 5774},
+};
+
+// A benchmark: setup prepares the input of a run outside of the measurement, run is timed.
+// Returns the number of encoded bytes for codecs, 0 otherwise.
+struct Benchmark {
+    Benchmark(std::string name,
+              std::vector<u32> channels,
+              std::function<u64(Image* image)> run,
+              std::function<Image*(const Image* source)> setup = nullptr)
+        : name(name), channels(channels), run(run), setup(setup) {}
+
+    std::string name;
+    std::vector<u32> channels;
+    std::function<u64(Image* image)> run;
+
+    // Prepares the image a run starts with, a copy of the source image by default.
+    std::function<Image*(const Image* source)> setup;
+};
+
+// Command line options.
+struct Options {
+    std::string filter;
+    std::vector<std::string> sizes;
+    std::vector<u32> channels = {1, 3, 4};
+    std::vector<u32> threads;
+    f64 minTimeMs = 200;
+    u32 maxRuns = 20;
+    bool json = false;
+    bool list = false;
+};
+
+// Result of a single benchmark.
+struct Result {
+    std::string name;
+    std::string benchmark;
+    Size size;
+    u32 channels;
+    u32 threads;
+    u32 runs;
+    f64 bestMs;
+    f64 medianMs;
+    u64 encodedBytes;
+};
+
+// ----------------------------------------------------------------------------
+// Smooth gradients with some noise, so codecs see realistic data.
+static Image* testImage(const Size& size, u32 channels) {
+    Image* image = new Image(size.width, size.height, channels);
+    u32 state = 42;
+    for (u32 y = 0; y < size.height; y++) {
+        u8* row = image->data + (u64)y * image->lineSize;
+        for (u32 x = 0; x < size.width; x++) {
+            state = state * 1103515245 + 12345;
+            const u32 noise = (state >> 16) & 15;
+            for (u32 c = 0; c < channels; c++) {
+                const u32 gradient = c % 2 == 0 ? x * 255 / size.width : y * 255 / size.height;
+                row[x * channels + c] = (u8)std::min(gradient + noise, 255u);
+            }
+        }
+    }
+    return image;
+}
+
+// ----------------------------------------------------------------------------
+static std::vector<Benchmark> benchmarks() {
+    const Kernel sharpen = {0, -1, 0, -1, 5, -1, 0, -1, 0};
+    const std::vector<u32> all = {1, 2, 3, 4};
+    const std::vector<u32> rgb = {3, 4};
+
+    Pipeline points;
+    points.contrast(1.2f)->invert()->grayscale();
+
+    auto encodeJpeg = [](const Image* source) {
+        JpegTurboWriter writer;
+        std::vector<u8> jpeg;
+        writer.encode(const_cast<Image*>(source), jpeg);
+        // the jpeg is stored as a 1 pixel high image
+        Image* encoded = new Image((u32)jpeg.size(), 1, 1);
+        std::copy(jpeg.begin(), jpeg.end(), encoded->data);
+        return encoded;
+    };
+    auto writePng = [](const Image* source) {
+        PngWriter writer;
+        writer.write(const_cast<Image*>(source), PNG_FILE);
+        return new Image(1, 1, 1);
+    };
+
+    return {
+        {"resize-bilinear", all,
+         [](Image* image) {
+             image->resize(image->width / 2, image->height / 2);
+             return 0;
+         }},
+        {"resize-nearest", all,
+         [](Image* image) {
+             image->resize(image->width / 2, image->height / 2, ResizeMethod::NEARSET_NEIGHBOR);
+             return 0;
+         }},
+        {"upscale-bilinear", all,
+         [](Image* image) {
+             image->resize(image->width * 3 / 2, image->height * 3 / 2);
+             return 0;
+         }},
+        {"flip-horizontal", all,
+         [](Image* image) {
+             image->flip();
+             return 0;
+         }},
+        {"flip-vertical", all,
+         [](Image* image) {
+             image->flip(Orientation::VERTICAL);
+             return 0;
+         }},
+        {"convolution", all,
+         [sharpen](Image* image) {
+             image->convolution(sharpen);
+             return 0;
+         }},
+        {"grayscale", all,
+         [](Image* image) {
+             image->grayscale();
+             return 0;
+         }},
+        {"invert", all,
+         [](Image* image) {
+             image->invert();
+             return 0;
+         }},
+        {"contrast", all,
+         [](Image* image) {
+             image->contrast(1.3f);
+             return 0;
+         }},
+        {"add-alpha", {3},
+         [](Image* image) {
+             image->addAlphaChannel();
+             return 0;
+         }},
+        {"remove-alpha", {4},
+         [](Image* image) {
+             image->removeAlphaChannel();
+             return 0;
+         }},
+        {"point", all,
+         [points](Image* image) {
+             points.execute(image);
+             return 0;
+         }},
+        {"ssim", all,
+         [](Image* image) {
+             op::ssim(image, image);
+             return 0;
+         }},
+        {"png-encode", rgb,
+         [](Image* image) {
+             PngWriter writer;
+             writer.write(image, PNG_FILE);
+             return 0;
+         }},
+        {"png-decode", rgb,
+         [](Image*) {
+             PngReader reader;
+             delete reader.read(PNG_FILE);
+             return 0;
+         },
+         writePng},
+        {"jpeg-encode", rgb,
+         [](Image* image) {
+             JpegTurboWriter writer;
+             std::vector<u8> jpeg;
+             writer.encode(image, jpeg);
+             return (u64)jpeg.size();
+         }},
+        {"jpeg-decode", {3},
+         [](Image* encoded) {
+             JpegTurboReader reader;
+             delete reader.decode(encoded->data, encoded->size);
+             return encoded->size;
+         },
+         encodeJpeg},
+    };
+}
+
+// ----------------------------------------------------------------------------
+static Result measure(const Benchmark& benchmark,
+                      const Image* source,
+                      const Options& options,
+                      Result result) {
+    typedef std::chrono::steady_clock Clock;
+    ThreadScope scope(result.threads);
+
+    std::vector<f64> times;
+    f64 total = 0;
+    std::unique_ptr<Image> prepared(benchmark.setup ? benchmark.setup(source) : nullptr);
+    while (times.empty() || (total < options.minTimeMs && times.size() < options.maxRuns)) {
+        std::unique_ptr<Image> image(new Image(prepared ? prepared.get() : source));
+
+        const Clock::time_point start = Clock::now();
+        result.encodedBytes = benchmark.run(image.get());
+        const f64 ms = std::chrono::duration<f64, std::milli>(Clock::now() - start).count();
+
+        times.push_back(ms);
+        total += ms;
+    }
+
+    std::sort(times.begin(), times.end());
+    result.runs = (u32)times.size();
+    result.bestMs = times.front();
+    result.medianMs = times[times.size() / 2];
+    return result;
+}
+
+// ----------------------------------------------------------------------------
+static f64 megapixelsPerSecond(const Result& result) {
+    return result.size.width * (f64)result.size.height / 1e6 / (result.bestMs / 1000);
+}
+
+// ----------------------------------------------------------------------------
+static f64 bytesPerSecond(const Result& result) {
+    const f64 bytes = (f64)result.size.width * result.size.height * result.channels;
+    return bytes / (result.bestMs / 1000);
+}
+
+// ----------------------------------------------------------------------------
+static void printResult(const Result& result) {
+    std::cout << std::left << std::setw(36) << result.name << std::right << std::fixed
+              << std::setprecision(3) << std::setw(12) << result.bestMs << " ms"
+              << std::setprecision(1) << std::setw(10) << megapixelsPerSecond(result)
+              << " MP/s" << std::setw(10) << bytesPerSecond(result) / 1e6 << " MB/s"
+              << std::setw(5) << result.runs << " runs" << std::endl;
+}
+
+// ----------------------------------------------------------------------------
+static void printJson(const std::vector<Result>& results) {
+    std::cout << "{\n";
+    std::cout << "  \"version\": \"" << PIXL_VERSION << "\",\n";
+    std::cout << "  \"isa\": \"" << (reference_kernels() ? "reference" : isa_name(cpu_isa()))
+              << "\",\n";
+    std::cout << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n";
+    std::cout << "  \"results\": [";
+    for (u64 i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        std::cout << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << r.name << "\", "
+                  << "\"benchmark\": \"" << r.benchmark << "\", "
+                  << "\"size\": \"" << r.size.name << "\", "
+                  << "\"width\": " << r.size.width << ", \"height\": " << r.size.height << ", "
+                  << "\"channels\": " << r.channels << ", \"threads\": " << r.threads << ", "
+                  << "\"runs\": " << r.runs << ", "
+                  << std::setprecision(6) << "\"best_ms\": " << r.bestMs << ", "
+                  << "\"median_ms\": " << r.medianMs << ", "
+                  << "\"megapixels_per_second\": " << megapixelsPerSecond(r) << ", "
+                  << "\"bytes_per_second\": " << (u64)bytesPerSecond(r) << ", "
+                  << "\"encoded_bytes\": " << r.encodedBytes << "}";
+    }
+    std::cout << "\n  ]\n}" << std::endl;
+}
+
+// ----------------------------------------------------------------------------
+static std::vector<std::string> splitList(const std::string& list) {
+    std::vector<std::string> values;
+    str_split(list, ',', values);
+    return values;
+}
+
+// ----------------------------------------------------------------------------
+static std::vector<u32> splitNumbers(const std::string& list) {
+    std::vector<u32> numbers;
+    for (const std::string& value : splitList(list)) {
+        numbers.push_back((u32)std::stoul(value));
+    }
+    return numbers;
+}
+
+// ----------------------------------------------------------------------------
+static void usage() {
+    std::cerr << "usage: bench [--filter=REGEX] [--sizes=64,512,1mp,12mp,50mp] "
+              << "[--channels=1,3,4] [--threads=1,2,...] [--min-time=MS] [--max-runs=N] "
+              << "[--json] [--list]" << std::endl;
+}
+
+// ----------------------------------------------------------------------------
+static bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const u64 equals = arg.find('=');
+        const std::string name = arg.substr(0, equals);
+        const std::string value = equals == std::string::npos ? "" : arg.substr(equals + 1);
+
+        if (name == "--filter") {
+            options.filter = value;
+        } else if (name == "--sizes") {
+            options.sizes = splitList(value);
+        } else if (name == "--channels") {
+            options.channels = splitNumbers(value);
+        } else if (name == "--threads") {
+            options.threads = splitNumbers(value);
+        } else if (name == "--min-time") {
+            options.minTimeMs = std::stod(value);
+        } else if (name == "--max-runs") {
+            options.maxRuns = std::max((u32)std::stoul(value), 1u);
+        } else if (name == "--json") {
+            options.json = true;
+        } else if (name == "--list") {
+            options.list = true;
+        } else {
+            return false;
+        }
+    }
+
+    // 1, 2, 4, ... up to the number of cores
+    if (options.threads.empty()) {
+        const u32 cores = std::max(std::thread::hardware_concurrency(), 1u);
+        for (u32 threads = 1; threads < cores; threads *= 2) {
+            options.threads.push_back(threads);
+        }
+        options.threads.push_back(cores);
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    try {
+        if (!parseOptions(argc, argv, options)) {
+            usage();
+            return 1;
+        }
+    } catch (std::exception&) {
+        usage();
+        return 1;
+    }
+
+    std::regex filter;
+    try {
+        filter = std::regex(options.filter);
+    } catch (std::regex_error&) {
+        std::cerr << "invalid filter: " << options.filter << std::endl;
+        return 1;
+    }
 
-#define IMAGE_BIRD "../images/bird.jpg"
-#define IMAGE_LENA "../images/lena.png"
+    std::vector<Result> results;
+    for (const Size& size : SIZES) {
+        if (!options.sizes.empty() &&
+            std::find(options.sizes.begin(), options.sizes.end(), size.name) ==
+                options.sizes.end())
+            continue;
 
-int main() {
-    auto image = pixl::read(IMAGE_BIRD);
+        for (u32 channels : options.channels) {
+            // created when the first benchmark needs it
+            std::unique_ptr<Image> source;
+            for (const Benchmark& benchmark : benchmarks()) {
+                if (std::find(benchmark.channels.begin(), benchmark.channels.end(), channels) ==
+                    benchmark.channels.end())
+                    continue;
 
-    std::array<float, 9> edge = {0, 1, 0, 1, -4, 1, 0, 1, 0};
+                for (u32 threads : options.threads) {
+                    Result result;
+                    result.benchmark = benchmark.name;
+                    result.size = size;
+                    result.channels = channels;
+                    result.threads = threads;
+                    result.name = benchmark.name + "/" + size.name + "/c" +
+                                  std::to_string(channels) + "/t" + std::to_string(threads);
+                    if (!std::regex_search(result.name, filter))
+                        continue;
 
-    pixl::benchmark("test", 20, [&](pixl::Timer& timer) {
-        // create new image. Stop measurment for now.
-        timer.pause();
-        pixl::Image tmpImage(image);
-        timer.resume();
+                    if (options.list) {
+                        std::cout << result.name << std::endl;
+                        continue;
+                    }
+                    if (!source) {
+                        source.reset(testImage(size, channels));
+                    }
 
-        tmpImage.convolution(edge);
-    });
+                    try {
+                        results.push_back(measure(benchmark, source.get(), options, result));
+                    } catch (PixlException& e) {
+                        std::cerr << result.name << " failed: " << e.getMessage() << std::endl;
+                        continue;
+                    }
+                    if (!options.json) {
+                        printResult(results.back());
+                    }
+                }
+            }
+        }
+    }
+    std::remove(PNG_FILE);
 
+    if (options.json && !options.list) {
+        printJson(results);
+    }
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,268 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Compares kernels written with simd.h against the same kernels written with raw intrinsics,
+// to check that the abstraction costs nothing. Uses the backend of the flags this file is
+// compiled with, so build with -DCMAKE_BUILD_TYPE=Release, and e.g.
+// -DCMAKE_CXX_FLAGS=-mavx2 for the AVX2 backend.
+//
+// With --verify, runs all operations of the library with the reference & the optimized
+// kernels instead (pixl::compare_kernels) and reports differences & speedups.
+
+#define PIXL_KERNELS_NAMESPACE bench
+#include <pixl/simd.h>
+#include <pixl/debug.h>
+#include <pixl/cpu.h>
+#include <pixl/verify.h>
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+using namespace pixl;
+namespace simd = pixl::bench::simd;
+
+// Bytes per row & rows per run
+#define ROW_BYTES (4096 * 4)
+#define ROWS 512
+
+// ----------------------------------------------------------------------------
+static void invertSimd(const u8* src, u8* dst, u64 length) {
+    const simd::U8 mask = simd::set1(255);
+    for (u64 i = 0; i + simd::LANES <= length; i += simd::LANES) {
+        simd::store(dst + i, simd::bit_xor(simd::load(src + i), mask));
+    }
+}
+
+// ----------------------------------------------------------------------------
+static void convolutionSimd(const u8* row0, const u8* row1, const u8* row2, u8* dst, u64 count) {
+    const simd::F32 weight = simd::set1_f32(1 / 9.0f);
+    const u8* rows[3] = {row0, row1, row2};
+    for (u64 i = 0; i + simd::LANES <= count; i += simd::LANES) {
+        simd::F32 sums[4];
+        for (u32 t = 0; t < 9; t++) {
+            const simd::U8 values = simd::load(rows[t / 3] + i + (t % 3) * 4);
+            const simd::I16 lo = simd::widen_lo(values);
+            const simd::I16 hi = simd::widen_hi(values);
+            const simd::F32 quarters[4] = {simd::to_f32_lo(lo), simd::to_f32_hi(lo),
+                                           simd::to_f32_lo(hi), simd::to_f32_hi(hi)};
+            for (u32 q = 0; q < 4; q++) {
+                const simd::F32 product = simd::mul(weight, quarters[q]);
+                sums[q] = t == 0 ? product : simd::add(sums[q], product);
+            }
+        }
+        simd::store(dst + i, simd::narrow(simd::to_i16(sums[0], sums[1]),
+                                          simd::to_i16(sums[2], sums[3])));
+    }
+}
+
+// ----------------------------------------------------------------------------
+static void addAlphaSimd(const u8* src, u8* dst, u64 pixels) {
+    static const u8 expand[16] = {0, 1, 2, 0x80, 3, 4, 5, 0x80, 6, 7, 8, 0x80, 9, 10, 11, 0x80};
+    static const u8 alphas[16] = {0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255};
+    const simd::Block indices = simd::load_block(expand);
+    const simd::Block alpha = simd::load_block(alphas);
+    for (u64 x = 0; x + 6 <= pixels; x += 4) {
+        const simd::Block in = simd::load_block(src + x * 3);
+        simd::store_block(dst + x * 4, simd::block_or(simd::shuffle(in, indices), alpha));
+    }
+}
+
+#if defined(PIXL_SIMD_AVX2)
+
+// ----------------------------------------------------------------------------
+static void invertRaw(const u8* src, u8* dst, u64 length) {
+    const __m256i mask = _mm256_set1_epi8(-1);
+    for (u64 i = 0; i + 32 <= length; i += 32) {
+        const __m256i in = _mm256_loadu_si256((const __m256i*)(src + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_xor_si256(in, mask));
+    }
+}
+
+// ----------------------------------------------------------------------------
+static void convolutionRaw(const u8* row0, const u8* row1, const u8* row2, u8* dst, u64 count) {
+    const __m256 weight = _mm256_set1_ps(1 / 9.0f);
+    const u8* rows[3] = {row0, row1, row2};
+    for (u64 i = 0; i + 32 <= count; i += 32) {
+        __m256 sums[4];
+        for (u32 t = 0; t < 9; t++) {
+            const __m256i values = _mm256_loadu_si256((const __m256i*)(rows[t / 3] + i + (t % 3) * 4));
+            const __m256i lo = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(values));
+            const __m256i hi = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(values, 1));
+            const __m256 quarters[4] = {
+                _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(lo))),
+                _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(lo, 1))),
+                _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(hi))),
+                _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(hi, 1)))};
+            for (u32 q = 0; q < 4; q++) {
+                const __m256 product = _mm256_mul_ps(weight, quarters[q]);
+                sums[q] = t == 0 ? product : _mm256_add_ps(sums[q], product);
+            }
+        }
+        const __m256i a = _mm256_permute4x64_epi64(
+            _mm256_packs_epi32(_mm256_cvttps_epi32(sums[0]), _mm256_cvttps_epi32(sums[1])), 0xD8);
+        const __m256i b = _mm256_permute4x64_epi64(
+            _mm256_packs_epi32(_mm256_cvttps_epi32(sums[2]), _mm256_cvttps_epi32(sums[3])), 0xD8);
+        _mm256_storeu_si256((__m256i*)(dst + i),
+                            _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8));
+    }
+}
+
+#elif defined(PIXL_SIMD_SSE2)
+
+// ----------------------------------------------------------------------------
+static void invertRaw(const u8* src, u8* dst, u64 length) {
+    const __m128i mask = _mm_set1_epi8(-1);
+    for (u64 i = 0; i + 16 <= length; i += 16) {
+        const __m128i in = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_xor_si128(in, mask));
+    }
+}
+
+// ----------------------------------------------------------------------------
+static void convolutionRaw(const u8* row0, const u8* row1, const u8* row2, u8* dst, u64 count) {
+    const __m128 weight = _mm_set1_ps(1 / 9.0f);
+    const __m128i zero = _mm_setzero_si128();
+    const u8* rows[3] = {row0, row1, row2};
+    for (u64 i = 0; i + 16 <= count; i += 16) {
+        __m128 sums[4];
+        for (u32 t = 0; t < 9; t++) {
+            const __m128i values = _mm_loadu_si128((const __m128i*)(rows[t / 3] + i + (t % 3) * 4));
+            const __m128i lo = _mm_unpacklo_epi8(values, zero);
+            const __m128i hi = _mm_unpackhi_epi8(values, zero);
+            const __m128 quarters[4] = {
+                _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)),
+                _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)),
+                _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)),
+                _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero))};
+            for (u32 q = 0; q < 4; q++) {
+                const __m128 product = _mm_mul_ps(weight, quarters[q]);
+                sums[q] = t == 0 ? product : _mm_add_ps(sums[q], product);
+            }
+        }
+        const __m128i a = _mm_packs_epi32(_mm_cvttps_epi32(sums[0]), _mm_cvttps_epi32(sums[1]));
+        const __m128i b = _mm_packs_epi32(_mm_cvttps_epi32(sums[2]), _mm_cvttps_epi32(sums[3]));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(a, b));
+    }
+}
+
+#endif
+
+#if defined(PIXL_SIMD_AVX2) || (defined(PIXL_SIMD_SSE2) && defined(__SSSE3__))
+
+// ----------------------------------------------------------------------------
+static void addAlphaRaw(const u8* src, u8* dst, u64 pixels) {
+    const __m128i indices = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+    for (u64 x = 0; x + 6 <= pixels; x += 4) {
+        const __m128i in = _mm_loadu_si128((const __m128i*)(src + x * 3));
+        _mm_storeu_si128((__m128i*)(dst + x * 4),
+                         _mm_or_si128(_mm_shuffle_epi8(in, indices), alpha));
+    }
+}
+
+#define HAS_RAW_SHUFFLE
+#endif
+
+// ----------------------------------------------------------------------------
+// Best time of a few runs in ms.
+static f64 measure(const std::function<void()>& run) {
+    Timer timer;
+    f64 best = 1e30;
+    for (u32 i = 0; i < 20; i++) {
+        timer.begin();
+        run();
+        timer.end();
+        best = std::min(best, timer.time_ms());
+    }
+    return best;
+}
+
+// ----------------------------------------------------------------------------
+static void report(const char* name, f64 simd, f64 raw, bool same) {
+    std::cout << name << ": simd.h " << simd << " ms";
+    if (raw > 0) {
+        std::cout << ", intrinsics " << raw << " ms, ratio " << simd / raw;
+        std::cout << (same ? "" : " (RESULTS DIFFER)");
+    }
+    std::cout << std::endl;
+}
+
+// ----------------------------------------------------------------------------
+// Returns 1 if any operation differs from the reference.
+static int verify() {
+    std::cout << "reference vs " << isa_name(cpu_isa()) << " kernels" << std::endl;
+    int result = 0;
+    for (const KernelComparison& comparison : compare_kernels(1920, 1080, 5)) {
+        std::cout << comparison.operation << " (" << comparison.channels << " channels): ";
+        std::cout << comparison.referenceMs << " ms -> " << comparison.optimizedMs << " ms, ";
+        std::cout << "speedup " << comparison.speedup() << ", max difference ";
+        std::cout << comparison.maxDifference << std::endl;
+        if (comparison.maxDifference != 0) {
+            result = 1;
+        }
+    }
+    return result;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "--verify") == 0)
+        return verify();
+
+    std::vector<u8> src((u64)ROW_BYTES * (ROWS + 2));
+    for (u64 i = 0; i < src.size(); i++) {
+        src[i] = (u8)(i * 7 + i / 13);
+    }
+    std::vector<u8> a(src.size() * 2), b(src.size() * 2);
+
+    std::cout << "backend: " << simd::BACKEND << ", " << simd::LANES << " lanes" << std::endl;
+
+    const u64 length = (u64)ROW_BYTES * ROWS;
+    f64 raw = 0;
+    const f64 invert = measure([&]() { invertSimd(src.data(), a.data(), length); });
+#if defined(PIXL_SIMD_AVX2) || defined(PIXL_SIMD_SSE2)
+    raw = measure([&]() { invertRaw(src.data(), b.data(), length); });
+#endif
+    report("invert", invert, raw, memcmp(a.data(), b.data(), length) == 0);
+
+    const f64 convolution = measure([&]() {
+        for (u32 y = 0; y < ROWS; y++) {
+            const u8* row = src.data() + (u64)y * ROW_BYTES;
+            convolutionSimd(row, row + ROW_BYTES, row + 2 * ROW_BYTES, a.data() + y * ROW_BYTES,
+                            ROW_BYTES - 8);
+        }
+    });
+#if defined(PIXL_SIMD_AVX2) || defined(PIXL_SIMD_SSE2)
+    raw = measure([&]() {
+        for (u32 y = 0; y < ROWS; y++) {
+            const u8* row = src.data() + (u64)y * ROW_BYTES;
+            convolutionRaw(row, row + ROW_BYTES, row + 2 * ROW_BYTES, b.data() + y * ROW_BYTES,
+                           ROW_BYTES - 8);
+        }
+    });
+#endif
+    report("convolution", convolution, raw, memcmp(a.data(), b.data(), length) == 0);
+
+    const u64 pixels = length / 3;
+    const f64 addAlpha = measure([&]() { addAlphaSimd(src.data(), a.data(), pixels); });
+    raw = 0;
+#ifdef HAS_RAW_SHUFFLE
+    raw = measure([&]() { addAlphaRaw(src.data(), b.data(), pixels); });
+#endif
+    report("add alpha", addAlpha, raw, memcmp(a.data(), b.data(), (pixels - 6) * 4) == 0);
+
+    return 0;
+}
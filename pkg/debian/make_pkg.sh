@@ -33,8 +33,22 @@ install src/pixl/pixl.h 		$TMP_DIR/pixl/$INCLUDE_DIR
 install src/pixl/debug.h 		$TMP_DIR/pixl/$INCLUDE_DIR
 install src/pixl/errors.h 		$TMP_DIR/pixl/$INCLUDE_DIR
 install src/pixl/image.h 		$TMP_DIR/pixl/$INCLUDE_DIR
+install src/pixl/incremental.h 	$TMP_DIR/pixl/$INCLUDE_DIR
 install src/pixl/io.h 			$TMP_DIR/pixl/$INCLUDE_DIR
+install src/pixl/numa.h 		$TMP_DIR/pixl/$INCLUDE_DIR
 install src/pixl/operations.h 	$TMP_DIR/pixl/$INCLUDE_DIR
+install src/pixl/fixed.h 		$TMP_DIR/pixl/$INCLUDE_DIR
+install src/pixl/async.h 		$TMP_DIR/pixl/$INCLUDE_DIR
+install src/pixl/batch.h 		$TMP_DIR/pixl/$INCLUDE_DIR
+install src/pixl/cpu.h 		$TMP_DIR/pixl/$INCLUDE_DIR
+install src/pixl/verify.h 		$TMP_DIR/pixl/$INCLUDE_DIR
+install src/pixl/context.h 		$TMP_DIR/pixl/$INCLUDE_DIR
+install src/pixl/deadline.h 		$TMP_DIR/pixl/$INCLUDE_DIR
+install src/pixl/cache.h 		$TMP_DIR/pixl/$INCLUDE_DIR
+install src/pixl/pipe.h 		$TMP_DIR/pixl/$INCLUDE_DIR
+install src/pixl/pipeline.h 		$TMP_DIR/pixl/$INCLUDE_DIR
+install src/pixl/preview.h 		$TMP_DIR/pixl/$INCLUDE_DIR
+install src/pixl/threads.h 		$TMP_DIR/pixl/$INCLUDE_DIR
 install src/pixl/types.h 		$TMP_DIR/pixl/$INCLUDE_DIR
 install src/pixl/utils.h 		$TMP_DIR/pixl/$INCLUDE_DIR
 
@@ -37,7 +37,11 @@ class IMAGE(Structure):
 
 _LIBPIXL.pixl_load_image.argtypes = [c_char_p]
 _LIBPIXL.pixl_load_image.restype = POINTER(IMAGE)
+_LIBPIXL.pixl_load_image_for_size.argtypes = [c_char_p, c_uint, c_uint]
+_LIBPIXL.pixl_load_image_for_size.restype = POINTER(IMAGE)
 _LIBPIXL.pixl_save_image.argtypes = [POINTER(IMAGE), c_char_p, c_int]
+_LIBPIXL.pixl_save_image_budget.argtypes = [POINTER(IMAGE), c_char_p, c_ulong, c_float]
+_LIBPIXL.pixl_save_image_budget.restype = c_int
 _LIBPIXL.pixl_flip.argtypes = [POINTER(IMAGE), c_int]
 _LIBPIXL.pixl_resize.argtypes = [POINTER(IMAGE), c_uint, c_uint, c_int]
 _LIBPIXL.pixl_grayscale.argtypes = [POINTER(IMAGE)]
@@ -46,6 +50,19 @@ _LIBPIXL.pixl_convolution.argtypes = [POINTER(IMAGE), c_float*9, c_float]
 _LIBPIXL.pixl_add_alpha_channel.argtypes = [POINTER(IMAGE), c_ubyte]
 _LIBPIXL.pixl_remove_alpha_channel.argtypes = [POINTER(IMAGE)]
 _LIBPIXL.pixl_contrast.argtypes = [POINTER(IMAGE), c_float]
+_LIBPIXL.pixl_jpeg_quality.argtypes = [c_char_p]
+_LIBPIXL.pixl_jpeg_quality.restype = c_int
+_LIBPIXL.pixl_jpeg_requantize.argtypes = [c_char_p, c_char_p, c_int]
+_LIBPIXL.pixl_pipeline_parse.argtypes = [c_char_p]
+_LIBPIXL.pixl_pipeline_parse.restype = c_void_p
+_LIBPIXL.pixl_pipeline_destroy.argtypes = [c_void_p]
+_LIBPIXL.pixl_pipeline_execute.argtypes = [c_void_p, POINTER(IMAGE)]
+_LIBPIXL.pixl_pipeline_execute.restype = c_int
+_LIBPIXL.pixl_pipeline_run.argtypes = [c_void_p, c_char_p, c_char_p]
+_LIBPIXL.pixl_pipeline_run.restype = c_int
+_LIBPIXL.pixl_pipeline_set_cache.argtypes = [c_void_p, c_char_p, c_ulong]
+_LIBPIXL.pixl_pipeline_set_cache.restype = c_int
+_LIBPIXL.pixl_last_error.restype = c_char_p
 
 
 # -----------------------------------------------------------------------------
@@ -60,11 +77,43 @@ class ResizeMethod(enum.Enum):
     NEAREST = 0
     BILINEAR = 1
 
+# -----------------------------------------------------------------------------
+def jpeg_quality(path):
+    """
+    Estimates the quality (1-100) the jpeg at path has been encoded with, without decoding it.
+    Returns -1 if the file is not a jpeg.
+    """
+    return _LIBPIXL.pixl_jpeg_quality(c_char_p(path.encode()))
+
+def jpeg_requantize(input, output, quality=75):
+    """
+    Lowers the quality of the jpeg at input without decoding it to pixels and saves the
+    result at output. Jpegs already at or below the quality are copied as they are.
+    """
+    _LIBPIXL.pixl_jpeg_requantize(c_char_p(input.encode()), c_char_p(output.encode()), quality)
+
+def set_threads(threads):
+    """
+    Sets the number of threads operations may use. 0 uses one per core, 1 disables threading.
+    """
+    _LIBPIXL.pixl_set_threads(threads)
+
+def set_thread_pinning(pin):
+    """
+    Pins the worker threads to the CPUs of their NUMA node.
+    """
+    _LIBPIXL.pixl_set_thread_pinning(1 if pin else 0)
+
 # -----------------------------------------------------------------------------
 class Image:
-    def __init__(self, path):
-        """Loads the image, located at path."""
-        self._IMAGE = _LIBPIXL.pixl_load_image(c_char_p(path.encode()))
+    def __init__(self, path, min_width=0, min_height=0):
+        """
+        Loads the image, located at path.
+        If the image is going to be shrunk anyway, min_width & min_height allow the decoder to
+        take shortcuts, like using the exif thumbnail of a jpeg.
+        """
+        self._IMAGE = _LIBPIXL.pixl_load_image_for_size(c_char_p(path.encode()),
+                                                        min_width, min_height)
 
     def save(self, path, quality=75):
         """
@@ -73,6 +122,16 @@ class Image:
         """
         _LIBPIXL.pixl_save_image(self._IMAGE, c_char_p(path.encode()), quality)
 
+    def save_with_budget(self, path, max_bytes=0, min_ssim=0.0):
+        """
+        Saves the image as jpeg using the highest quality that fits into max_bytes and/or
+        the lowest quality that reaches min_ssim compared to this image.
+        The qualities are searched in parallel inside the library.
+        Returns the chosen quality.
+        """
+        return _LIBPIXL.pixl_save_image_budget(self._IMAGE, c_char_p(path.encode()),
+                                               max_bytes, min_ssim)
+
     def destroy(self):
         """
         Frees the allocated memory of the native image object.
@@ -148,3 +207,47 @@ class Image:
         """
         _LIBPIXL.pixl_contrast(self._IMAGE, contrast)
         return self
+
+# -----------------------------------------------------------------------------
+class Pipeline:
+    def __init__(self, spec):
+        """
+        Parses a pipeline spec like 'resize:512x384|contrast:1.2|jpeg:q=82:420'.
+        Raises a ValueError if the spec is invalid.
+        """
+        self._PIPELINE = _LIBPIXL.pixl_pipeline_parse(c_char_p(spec.encode()))
+        if not self._PIPELINE:
+            raise ValueError(_LIBPIXL.pixl_last_error().decode())
+
+    def destroy(self):
+        """
+        Frees the native pipeline object. The pipeline can no longer be used afterwards.
+        """
+        _LIBPIXL.pixl_pipeline_destroy(self._PIPELINE)
+
+    def execute(self, image):
+        """
+        Executes the pipeline on the image. Raises a RuntimeError on failure.
+        Returns the image for chaining.
+        """
+        if _LIBPIXL.pixl_pipeline_execute(self._PIPELINE, image._IMAGE) != 0:
+            raise RuntimeError(_LIBPIXL.pixl_last_error().decode())
+        return image
+
+    def run(self, input, output):
+        """
+        Reads the image at input, executes the pipeline and saves the result at output using
+        the encoder of the spec. Raises an IOError on failure.
+        """
+        if _LIBPIXL.pixl_pipeline_run(self._PIPELINE, c_char_p(input.encode()),
+                                      c_char_p(output.encode())) != 0:
+            raise IOError(_LIBPIXL.pixl_last_error().decode())
+
+    def set_cache(self, directory, max_bytes):
+        """
+        Stores the results of run() in directory and reuses them for identical inputs.
+        Least recently used results are deleted once all of them exceed max_bytes.
+        """
+        if _LIBPIXL.pixl_pipeline_set_cache(self._PIPELINE, c_char_p(directory.encode()),
+                                            max_bytes) != 0:
+            raise IOError(_LIBPIXL.pixl_last_error().decode())
@@ -0,0 +1,105 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <memory>
+
+#include "async.h"
+#include "errors.h"
+#include "io.h"
+#include "threads.h"
+#include "types.h"
+
+namespace pixl {
+
+    // ----------------------------------------------------------------------------
+    // Turns a callback based function into one returning a future.
+    static std::future<Image*> imageFuture(std::function<void(ImageCallback)> start) {
+        auto promise = std::make_shared<std::promise<Image*>>();
+        start([promise](Image* image, std::exception_ptr error) {
+            if (error) {
+                promise->set_exception(error);
+            } else {
+                promise->set_value(image);
+            }
+        });
+        return promise->get_future();
+    }
+
+    // ----------------------------------------------------------------------------
+    void read_async(const std::string& path, ImageCallback done) {
+        run_async([=]() {
+            Image* image = nullptr;
+            std::exception_ptr error;
+            try {
+                image = read(path.c_str());
+                if (image == nullptr)
+                    throw PixlException("Failed to read image: " + path);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            done(image, error);
+        });
+    }
+
+    // ----------------------------------------------------------------------------
+    std::future<Image*> read_async(const std::string& path) {
+        return imageFuture([&](ImageCallback done) { read_async(path, done); });
+    }
+
+    // ----------------------------------------------------------------------------
+    void write_async(Image* image, const std::string& path, i32 quality, DoneCallback done) {
+        run_async([=]() {
+            std::exception_ptr error;
+            try {
+                write(image, path.c_str(), quality);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            done(error);
+        });
+    }
+
+    // ----------------------------------------------------------------------------
+    std::future<void> write_async(Image* image, const std::string& path, i32 quality) {
+        auto promise = std::make_shared<std::promise<void>>();
+        write_async(image, path, quality, [promise](std::exception_ptr error) {
+            if (error) {
+                promise->set_exception(error);
+            } else {
+                promise->set_value();
+            }
+        });
+        return promise->get_future();
+    }
+
+    // ----------------------------------------------------------------------------
+    void execute_async(const Pipeline& pipeline, Image* image, ImageCallback done) {
+        run_async([=]() {
+            std::exception_ptr error;
+            try {
+                pipeline.execute(image);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            done(image, error);
+        });
+    }
+
+    // ----------------------------------------------------------------------------
+    std::future<Image*> execute_async(const Pipeline& pipeline, Image* image) {
+        return imageFuture([&](ImageCallback done) { execute_async(pipeline, image, done); });
+    }
+}
@@ -0,0 +1,58 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef PIXL_ASYNC_H
+#define PIXL_ASYNC_H
+
+#include <exception>
+#include <functional>
+#include <future>
+#include <string>
+
+#include "image.h"
+#include "pipeline.h"
+#include "types.h"
+
+namespace pixl {
+
+    // Asynchronous versions of read, write & Pipeline::execute.
+    //
+    // All of them return right away and do the work on the thread pool of the library (or the
+    // executor set with set_executor / ThreadScope). Either wait for the returned future, or
+    // pass a callback which is called from the thread that did the work. Errors are rethrown
+    // by future::get(), callbacks get an exception_ptr instead.
+    //
+    // Images passed in must stay alive until the work is done. Don't wait for a future inside
+    // a task of the pool, the task it waits for might be queued behind it.
+
+    typedef std::function<void(Image* image, std::exception_ptr error)> ImageCallback;
+    typedef std::function<void(std::exception_ptr error)> DoneCallback;
+
+    // Decodes the image at path. Fails if the image can't be read.
+    std::future<Image*> read_async(const std::string& path);
+    void read_async(const std::string& path, ImageCallback done);
+
+    // Encodes the image to path.
+    std::future<void> write_async(Image* image, const std::string& path, i32 quality = 75);
+    void write_async(Image* image, const std::string& path, i32 quality, DoneCallback done);
+
+    // Executes the pipeline on the image & returns the same image. The pipeline is copied,
+    // so it may change while the work is in progress.
+    std::future<Image*> execute_async(const Pipeline& pipeline, Image* image);
+    void execute_async(const Pipeline& pipeline, Image* image, ImageCallback done);
+}
+
+#endif
@@ -0,0 +1,175 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <thread>
+
+#include "batch.h"
+#include "context.h"
+#include "errors.h"
+#include "image.h"
+#include "io.h"
+#include "threads.h"
+#include "types.h"
+
+namespace pixl {
+
+    // An image on its way through the stages.
+    struct BatchImage {
+        u64 index;
+        Image* image;
+        // key in the cache of the pipeline, empty without one
+        std::string key;
+    };
+
+    // ----------------------------------------------------------------------------
+    // Starts 'count' threads running 'work'. 'done' is called once by the last one to finish.
+    static void startStage(std::vector<std::thread>& threads,
+                           u32 count,
+                           std::function<void()> work,
+                           std::function<void()> done) {
+        count = std::max(count, 1u);
+        auto running = std::make_shared<std::atomic<u32>>(count);
+
+        // the stages run in the context & with the priority of the caller
+        const ExecutionContext* current = current_context();
+        const ExecutionContext context = current ? *current : ExecutionContext();
+        const Priority priority = current_priority();
+        for (u32 i = 0; i < count; i++) {
+            threads.push_back(std::thread([=]() {
+                ContextScope scope(context);
+                PriorityScope priorityScope(priority);
+                work();
+                if (--(*running) == 0) {
+                    done();
+                }
+            }));
+        }
+    }
+
+    // ----------------------------------------------------------------------------
+    // Runs a step of an item. Returns the message of the exception it threw, an empty string
+    // on success. The stages run on their own threads, where nothing may escape.
+    static std::string attempt(const std::function<void()>& step) {
+        std::string error;
+        try {
+            step();
+            return "";
+        } catch (PixlException& e) {
+            error = e.getMessage();
+        } catch (std::exception& e) {
+            error = e.what();
+        } catch (...) {
+        }
+        return error.empty() ? "Unknown error" : error;
+    }
+
+    // ----------------------------------------------------------------------------
+    Batch::Batch(const Pipeline& pipeline) : pipeline(pipeline) {}
+
+    // ----------------------------------------------------------------------------
+    std::vector<BatchResult> Batch::run(const std::vector<BatchItem>& items) {
+        std::vector<BatchResult> results(items.size());
+        for (u64 i = 0; i < items.size(); i++) {
+            results[i].input = items[i].input;
+            results[i].output = items[i].output;
+        }
+
+        // every item ends up here exactly once
+        std::mutex finishMutex;
+        auto finish = [&](u64 index, const std::string& error) {
+            std::lock_guard<std::mutex> lock(finishMutex);
+            results[index].success = error.empty();
+            results[index].error = error;
+            if (this->onDone) {
+                this->onDone(results[index]);
+            }
+        };
+
+        BoundedQueue<BatchImage> decoded(this->queueSize);
+        BoundedQueue<BatchImage> processed(this->queueSize);
+        std::atomic<u64> next(0);
+        std::vector<std::thread> threads;
+
+        // decode
+        startStage(threads, this->decodeThreads, [&]() {
+            for (u64 i = next++; i < items.size(); i = next++) {
+                std::string key;
+                bool cached = false;
+                Image* image = nullptr;
+                const std::string error = attempt([&]() {
+                    if (this->pipeline.cache) {
+                        const char* output = items[i].output.c_str();
+                        key = this->pipeline.cacheKey(items[i].input.c_str(), output);
+                        cached = !key.empty() && this->pipeline.cache->fetch(key, output);
+                    }
+                    if (!cached) {
+                        image = this->pipeline.decode(items[i].input.c_str());
+                    }
+                });
+
+                if (!error.empty()) {
+                    delete image;
+                    finish(i, error);
+                } else if (cached) {
+                    finish(i, "");
+                } else if (image == nullptr) {
+                    finish(i, "Failed to read image");
+                } else {
+                    decoded.push(BatchImage{i, image, key});
+                }
+            }
+        }, [&]() { decoded.close(); });
+
+        // process
+        startStage(threads, this->processThreads, [&]() {
+            BatchImage item;
+            while (decoded.pop(item)) {
+                const std::string error = attempt([&]() { this->pipeline.execute(item.image); });
+                if (!error.empty()) {
+                    finish(item.index, error);
+                    delete item.image;
+                    continue;
+                }
+                processed.push(item);
+            }
+        }, [&]() { processed.close(); });
+
+        // encode
+        startStage(threads, this->encodeThreads, [&]() {
+            BatchImage item;
+            while (processed.pop(item)) {
+                const std::string error = attempt([&]() {
+                    const char* output = items[item.index].output.c_str();
+                    this->pipeline.write(item.image, output);
+                    if (!item.key.empty()) {
+                        this->pipeline.cache->store(item.key, output);
+                    }
+                });
+                finish(item.index, error);
+                delete item.image;
+            }
+        }, []() {});
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        return results;
+    }
+}
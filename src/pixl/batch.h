@@ -0,0 +1,133 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef PIXL_BATCH_H
+#define PIXL_BATCH_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "image.h"
+#include "pipeline.h"
+#include "types.h"
+
+namespace pixl {
+
+    // FIFO queue with a maximum size. Pushing blocks while the queue is full, popping blocks
+    // while it is empty, which makes a fast producer wait for a slow consumer.
+    template <typename T>
+    class BoundedQueue {
+    public:
+        BoundedQueue(u32 capacity) : capacity(std::max(capacity, 1u)) {}
+
+        // Adds an item, waits while the queue is full.
+        // Returns false if the queue has been closed.
+        bool push(T item) {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->notFull.wait(lock, [this]() {
+                return this->closed || this->items.size() < this->capacity;
+            });
+            if (this->closed)
+                return false;
+
+            this->items.push_back(std::move(item));
+            this->notEmpty.notify_one();
+            return true;
+        }
+
+        // Takes the oldest item, waits while the queue is empty.
+        // Returns false once the queue has been closed and is empty.
+        bool pop(T& item) {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->notEmpty.wait(lock, [this]() { return this->closed || !this->items.empty(); });
+            if (this->items.empty())
+                return false;
+
+            item = std::move(this->items.front());
+            this->items.pop_front();
+            this->notFull.notify_one();
+            return true;
+        }
+
+        // No more items will be pushed. Items already queued can still be popped.
+        void close() {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->closed = true;
+            this->notEmpty.notify_all();
+            this->notFull.notify_all();
+        }
+
+    private:
+        const u32 capacity;
+        std::deque<T> items;
+        std::mutex mutex;
+        std::condition_variable notEmpty;
+        std::condition_variable notFull;
+        bool closed = false;
+    };
+
+    // A single image of a batch.
+    struct BatchItem {
+        std::string input;
+        std::string output;
+    };
+
+    // Outcome of a single image of a batch.
+    struct BatchResult {
+        std::string input;
+        std::string output;
+        bool success = false;
+        std::string error;
+    };
+
+    // Runs a pipeline over many images. Results are encoded as set in Pipeline::encoding.
+    //
+    // Decoding, processing and encoding are separate stages with their own threads, connected
+    // by bounded queues. While one image is encoded the next ones are already processed and
+    // decoded, and a slow stage makes the ones in front of it wait, so at most
+    //     decodeThreads + processThreads + encodeThreads + 2 * queueSize
+    // images are in memory at the same time. Results found in the cache of the pipeline skip
+    // all stages.
+    class Batch {
+    public:
+        Batch(const Pipeline& pipeline);
+
+        // Processes all items and returns their results in the same order. The context of the
+        // calling thread applies to all stages: once cancelled, the remaining items fail.
+        std::vector<BatchResult> run(const std::vector<BatchItem>& items);
+
+        // Threads per stage. Operations use the thread pool on top of that.
+        u32 decodeThreads = 2;
+        u32 processThreads = 1;
+        u32 encodeThreads = 2;
+
+        // Maximum number of images waiting in between two stages.
+        u32 queueSize = 4;
+
+        // Called whenever an item is done or failed, from the thread of the stage it ended in.
+        std::function<void(const BatchResult&)> onDone;
+
+    private:
+        Pipeline pipeline;
+    };
+}
+
+#endif
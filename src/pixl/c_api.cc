@@ -23,7 +23,14 @@ extern "C" {
 
 // ----------------------------------------------------------------------------
 CPixlImage* pixl_load_image(const char* path) {
-    auto handle = pixl::read(path);
+    return pixl_load_image_for_size(path, 0, 0);
+}
+
+// ----------------------------------------------------------------------------
+CPixlImage* pixl_load_image_for_size(const char* path,
+                                     unsigned int min_width,
+                                     unsigned int min_height) {
+    auto handle = pixl::read(path, min_width, min_height);
 
     auto cimg = (CPixlImage*)malloc(sizeof(CPixlImage));
     cimg->width = handle->width;
@@ -45,6 +52,18 @@ void pixl_save_image(CPixlImage* image, const char* path, int quality) {
     pixl::write(static_cast<pixl::Image*>(image->__handle), path, quality);
 }
 
+// ----------------------------------------------------------------------------
+int pixl_save_image_budget(CPixlImage* image,
+                           const char* path,
+                           unsigned long max_bytes,
+                           float min_ssim) {
+    pixl::JpegTargetWriter writer;
+    writer.maxBytes = max_bytes;
+    writer.minSsim = min_ssim;
+    writer.write(static_cast<pixl::Image*>(image->__handle), path);
+    return writer.quality;
+}
+
 // ----------------------------------------------------------------------------
 void pixl_resize(CPixlImage* image, unsigned int width, unsigned int height, int method) {
     auto handle = static_cast<pixl::Image*>(image->__handle);
@@ -120,4 +139,94 @@ void pixl_contrast(CPixlImage* image, float contrast) {
     handle->contrast(contrast);
 }
 
-}
\ No newline at end of file
+// ----------------------------------------------------------------------------
+int pixl_jpeg_quality(const char* path) {
+    return pixl::jpeg_estimate_quality(path);
+}
+
+// ----------------------------------------------------------------------------
+void pixl_jpeg_requantize(const char* input, const char* output, int quality) {
+    pixl::JpegRequantizer requantizer;
+    requantizer.quality = quality;
+    requantizer.requantize(input, output);
+}
+
+// ----------------------------------------------------------------------------
+void pixl_set_threads(unsigned int threads) {
+    pixl::set_threads(threads);
+}
+
+// ----------------------------------------------------------------------------
+void pixl_set_thread_pinning(int pin) {
+    pixl::set_thread_pinning(pin != 0);
+}
+
+static thread_local std::string lastError;
+
+// ----------------------------------------------------------------------------
+CPixlPipeline* pixl_pipeline_parse(const char* spec) {
+    pixl::Pipeline* handle = nullptr;
+    try {
+        handle = new pixl::Pipeline(pixl::Pipeline::parse(spec));
+    } catch (pixl::PixlException& e) {
+        lastError = e.getMessage();
+        return nullptr;
+    }
+
+    auto cpipeline = (CPixlPipeline*)malloc(sizeof(CPixlPipeline));
+    cpipeline->__handle = handle;
+    return cpipeline;
+}
+
+// ----------------------------------------------------------------------------
+void pixl_pipeline_destroy(CPixlPipeline* pipeline) {
+    auto handle = static_cast<pixl::Pipeline*>(pipeline->__handle);
+    delete handle;
+    free(pipeline);
+}
+
+// ----------------------------------------------------------------------------
+int pixl_pipeline_execute(CPixlPipeline* pipeline, CPixlImage* image) {
+    auto handle = static_cast<pixl::Image*>(image->__handle);
+    try {
+        static_cast<pixl::Pipeline*>(pipeline->__handle)->execute(handle);
+    } catch (pixl::PixlException& e) {
+        lastError = e.getMessage();
+        return -1;
+    }
+    image->width = handle->width;
+    image->height = handle->height;
+    return 0;
+}
+
+// ----------------------------------------------------------------------------
+int pixl_pipeline_run(CPixlPipeline* pipeline, const char* input, const char* output) {
+    try {
+        static_cast<pixl::Pipeline*>(pipeline->__handle)->write(input, output);
+    } catch (pixl::PixlException& e) {
+        lastError = e.getMessage();
+        return -1;
+    }
+    return 0;
+}
+
+// ----------------------------------------------------------------------------
+int pixl_pipeline_set_cache(CPixlPipeline* pipeline,
+                            const char* directory,
+                            unsigned long max_bytes) {
+    auto handle = static_cast<pixl::Pipeline*>(pipeline->__handle);
+    try {
+        handle->cache = std::make_shared<pixl::DiskCache>(directory, max_bytes);
+    } catch (pixl::PixlException& e) {
+        lastError = e.getMessage();
+        return -1;
+    }
+    return 0;
+}
+
+// ----------------------------------------------------------------------------
+const char* pixl_last_error(void) {
+    return lastError.c_str();
+}
+
+}
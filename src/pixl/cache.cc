@@ -0,0 +1,362 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cache.h"
+#include "errors.h"
+#include "image.h"
+#include "io.h"
+#include "types.h"
+
+namespace pixl {
+
+    // Keys are 128 bit hashes written as hex
+    #define PIXL_CACHE_KEY_LENGTH 32
+
+    // ----------------------------------------------------------------------------
+    static inline u64 rotl(u64 x, i32 r) {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    // ----------------------------------------------------------------------------
+    static inline u64 fmix(u64 k) {
+        k ^= k >> 33;
+        k *= 0xff51afd7ed558ccdULL;
+        k ^= k >> 33;
+        k *= 0xc4ceb9fe1a85ec53ULL;
+        k ^= k >> 33;
+        return k;
+    }
+
+    // MurmurHash3, x64 128 bit variant.
+    // ----------------------------------------------------------------------------
+    static void murmur3(const u8* data, u64 length, u64 seed, u64 out[2]) {
+        const u64 c1 = 0x87c37b91114253d5ULL;
+        const u64 c2 = 0x4cf5ad432745937fULL;
+        u64 h1 = seed;
+        u64 h2 = seed;
+
+        const u64 blocks = length / 16;
+        for (u64 i = 0; i < blocks; i++) {
+            u64 k1, k2;
+            memcpy(&k1, data + i * 16, 8);
+            memcpy(&k2, data + i * 16 + 8, 8);
+
+            k1 *= c1; k1 = rotl(k1, 31); k1 *= c2; h1 ^= k1;
+            h1 = rotl(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+            k2 *= c2; k2 = rotl(k2, 33); k2 *= c1; h2 ^= k2;
+            h2 = rotl(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+        }
+
+        const u8* tail = data + blocks * 16;
+        const u64 rest = length & 15;
+        u64 k1 = 0;
+        u64 k2 = 0;
+        for (u64 i = rest; i > 8; i--) {
+            k2 ^= (u64)tail[i - 1] << ((i - 9) * 8);
+        }
+        if (rest > 8) {
+            k2 *= c2; k2 = rotl(k2, 33); k2 *= c1; h2 ^= k2;
+        }
+        for (u64 i = std::min(rest, (u64)8); i > 0; i--) {
+            k1 ^= (u64)tail[i - 1] << ((i - 1) * 8);
+        }
+        if (rest > 0) {
+            k1 *= c1; k1 = rotl(k1, 31); k1 *= c2; h1 ^= k1;
+        }
+
+        h1 ^= length;
+        h2 ^= length;
+        h1 += h2;
+        h2 += h1;
+        h1 = fmix(h1);
+        h2 = fmix(h2);
+        h1 += h2;
+        h2 += h1;
+
+        out[0] = h1;
+        out[1] = h2;
+    }
+
+    // ----------------------------------------------------------------------------
+    static bool isEntry(const char* name) {
+        if (strlen(name) != PIXL_CACHE_KEY_LENGTH)
+            return false;
+        for (const char* c = name; *c != '\0'; c++) {
+            if (!((*c >= '0' && *c <= '9') || (*c >= 'a' && *c <= 'f')))
+                return false;
+        }
+        return true;
+    }
+
+    // ----------------------------------------------------------------------------
+    static bool copyFile(const char* from, const char* to) {
+        u64 length = 0;
+        u8* data = read_binary(from, &length);
+        if (data == nullptr)
+            return false;
+
+        FILE* file = fopen(to, "wb");
+        bool success = file != nullptr;
+        if (success) {
+            success = fwrite(data, 1, length, file) == length;
+            success = (fclose(file) == 0) && success;
+        }
+        delete[] data;
+        return success;
+    }
+
+    // ----------------------------------------------------------------------------
+    DiskCache::DiskCache(const std::string& directory, u64 maxBytes)
+        : directory(directory), maxBytes(maxBytes), bytes(0), hitCount(0), missCount(0),
+          tmpCount(0) {
+        if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST)
+            throw PixlException("Can't create cache directory " + directory);
+
+        // entries of earlier runs
+        evict();
+    }
+
+    // ----------------------------------------------------------------------------
+    std::string DiskCache::key(const u8* data, u64 length, const std::string& spec) {
+        // hash of the input, rehashed together with the spec
+        std::vector<u8> combined(16 + spec.size());
+        u64 hash[2];
+        murmur3(data, length, 0, hash);
+        memcpy(combined.data(), hash, 16);
+        memcpy(combined.data() + 16, spec.data(), spec.size());
+        murmur3(combined.data(), combined.size(), 0, hash);
+
+        char hex[PIXL_CACHE_KEY_LENGTH + 1];
+        snprintf(hex, sizeof(hex), "%016llx%016llx",
+                 (unsigned long long)hash[0], (unsigned long long)hash[1]);
+        return hex;
+    }
+
+    // ----------------------------------------------------------------------------
+    std::string DiskCache::path(const std::string& key) const {
+        return this->directory + "/" + key;
+    }
+
+    // ----------------------------------------------------------------------------
+    bool DiskCache::fetch(const std::string& key, const char* path) {
+        const std::string entry = this->path(key);
+        if (!copyFile(entry.c_str(), path)) {
+            this->missCount++;
+            return false;
+        }
+
+        // mark as recently used
+        utimensat(AT_FDCWD, entry.c_str(), nullptr, 0);
+        this->hitCount++;
+        return true;
+    }
+
+    // ----------------------------------------------------------------------------
+    void DiskCache::store(const std::string& key, const char* path) {
+        const std::string entry = this->path(key);
+        const std::string tmp = entry + ".tmp." + std::to_string(getpid()) + "." +
+                                std::to_string(this->tmpCount++);
+
+        if (!copyFile(path, tmp.c_str())) {
+            unlink(tmp.c_str());
+            return;
+        }
+
+        // another worker may have stored the same key already, the rename replaces its entry
+        struct stat info;
+        const u64 replaced = stat(entry.c_str(), &info) == 0 ? info.st_size : 0;
+        if (rename(tmp.c_str(), entry.c_str()) != 0) {
+            unlink(tmp.c_str());
+            return;
+        }
+
+        if (stat(entry.c_str(), &info) == 0) {
+            this->bytes += info.st_size;
+            this->bytes -= replaced;
+        }
+        if (this->bytes > this->maxBytes) {
+            evict();
+        }
+    }
+
+    // ----------------------------------------------------------------------------
+    void DiskCache::evict() {
+        std::lock_guard<std::mutex> lock(this->mutex);
+
+        struct Entry {
+            std::string path;
+            u64 size;
+            struct timespec time;
+        };
+        std::vector<Entry> entries;
+
+        DIR* dir = opendir(this->directory.c_str());
+        if (dir == nullptr)
+            return;
+        u64 total = 0;
+        while (struct dirent* file = readdir(dir)) {
+            if (!isEntry(file->d_name))
+                continue;
+
+            Entry entry;
+            entry.path = this->path(file->d_name);
+            struct stat info;
+            if (stat(entry.path.c_str(), &info) != 0)
+                continue;
+            entry.size = info.st_size;
+            entry.time = info.st_mtim;
+            entries.push_back(entry);
+            total += entry.size;
+        }
+        closedir(dir);
+
+        // oldest first
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+            if (a.time.tv_sec != b.time.tv_sec)
+                return a.time.tv_sec < b.time.tv_sec;
+            return a.time.tv_nsec < b.time.tv_nsec;
+        });
+        for (const Entry& entry : entries) {
+            if (total <= this->maxBytes)
+                break;
+            if (unlink(entry.path.c_str()) == 0) {
+                total -= entry.size;
+            }
+        }
+
+        this->bytes = total;
+    }
+
+    // ----------------------------------------------------------------------------
+    ImageCache::ImageCache(u64 maxBytes, u32 shards)
+        : maxBytes(maxBytes), bytes(0), hitCount(0), missCount(0), clock(0) {
+        for (u32 i = 0; i < std::max(shards, 1u); i++) {
+            this->shards.push_back(std::unique_ptr<Shard>(new Shard()));
+        }
+    }
+
+    // ----------------------------------------------------------------------------
+    std::shared_ptr<const Image> ImageCache::read(const char* path, u32 minWidth, u32 minHeight) {
+        struct stat info;
+        if (stat(path, &info) != 0)
+            return nullptr;
+
+        const std::string key = std::string(path) + ":" + std::to_string(info.st_mtim.tv_sec) +
+                                "." + std::to_string(info.st_mtim.tv_nsec) + ":" +
+                                std::to_string(info.st_size) + ":" + std::to_string(minWidth) +
+                                "x" + std::to_string(minHeight);
+        const u32 index = (u32)(std::hash<std::string>()(key) % this->shards.size());
+
+        {
+            Shard& shard = *this->shards[index];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto it = shard.index.find(key);
+            if (it != shard.index.end()) {
+                shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+                it->second->used = ++this->clock;
+                this->hitCount++;
+                return it->second->image;
+            }
+        }
+
+        // decoded without holding the lock, concurrent misses of the same image decode twice
+        this->missCount++;
+        std::shared_ptr<const Image> image(pixl::read(path, minWidth, minHeight));
+        if (image) {
+            add(index, key, image);
+        }
+        return image;
+    }
+
+    // ----------------------------------------------------------------------------
+    void ImageCache::add(u32 index, const std::string& key, std::shared_ptr<const Image> image) {
+        if (image->size > this->maxBytes)
+            return;
+
+        {
+            Shard& shard = *this->shards[index];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            if (shard.index.count(key) > 0)
+                return;
+            shard.entries.push_front(Entry{key, image, ++this->clock});
+            shard.index[key] = shard.entries.begin();
+            this->bytes += image->size;
+        }
+
+        while (this->bytes > this->maxBytes) {
+            if (!evictOldest(key))
+                break;
+        }
+    }
+
+    // ----------------------------------------------------------------------------
+    bool ImageCache::evictOldest(const std::string& keep) {
+        // the last entry of a shard is its oldest one. Only one shard is locked at a time, so
+        // the oldest entry found may have been used in between, then the search starts over.
+        while (true) {
+            u32 oldest = 0;
+            u64 oldestUsed = 0;
+            bool found = false;
+            for (u32 i = 0; i < this->shards.size(); i++) {
+                Shard& shard = *this->shards[i];
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                if (shard.entries.empty() || shard.entries.back().key == keep)
+                    continue;
+                if (!found || shard.entries.back().used < oldestUsed) {
+                    oldest = i;
+                    oldestUsed = shard.entries.back().used;
+                    found = true;
+                }
+            }
+            if (!found)
+                return false;
+
+            Shard& shard = *this->shards[oldest];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            if (shard.entries.empty() || shard.entries.back().used != oldestUsed)
+                continue;
+
+            const Entry& entry = shard.entries.back();
+            this->bytes -= entry.image->size;
+            shard.index.erase(entry.key);
+            shard.entries.pop_back();
+            return true;
+        }
+    }
+
+    // ----------------------------------------------------------------------------
+    void ImageCache::clear() {
+        for (auto& shard : this->shards) {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            for (const Entry& entry : shard->entries) {
+                this->bytes -= entry.image->size;
+            }
+            shard->entries.clear();
+            shard->index.clear();
+        }
+    }
+}
@@ -0,0 +1,130 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef PIXL_CACHE_H
+#define PIXL_CACHE_H
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "image.h"
+#include "types.h"
+
+namespace pixl {
+
+    // Content addressed cache of encoded images on the local disk.
+    //
+    // Entries are files named by their key inside the cache directory. They are written to a
+    // temporary file first and renamed, so readers never see half written entries, and
+    // several processes may share the same directory. Whenever the size of all entries
+    // exceeds maxBytes, the least recently used ones (by modification time, which is updated
+    // on every hit) are deleted.
+    class DiskCache {
+    public:
+        // Creates the directory if it doesn't exist, throws a PixlException if that fails.
+        DiskCache(const std::string& directory, u64 maxBytes);
+
+        // Key of the result of processing the encoded input as described by spec.
+        static std::string key(const u8* data, u64 length, const std::string& spec);
+
+        // Copies the entry to path. Returns false if there is no entry for the key.
+        bool fetch(const std::string& key, const char* path);
+
+        // Copies the file at path into the cache.
+        void store(const std::string& key, const char* path);
+
+        // Deletes the least recently used entries until the cache fits into maxBytes.
+        void evict();
+
+        // Total size of all entries.
+        u64 size() const { return this->bytes; }
+
+        u64 hits() const { return this->hitCount; }
+        u64 misses() const { return this->missCount; }
+
+        const std::string directory;
+        const u64 maxBytes;
+
+    private:
+        std::string path(const std::string& key) const;
+
+        std::mutex mutex;
+        std::atomic<u64> bytes;
+        std::atomic<u64> hitCount;
+        std::atomic<u64> missCount;
+        std::atomic<u32> tmpCount;
+    };
+
+    // In memory cache of decoded images, bounded by the size of their pixel data.
+    //
+    // Images are keyed by path, modification time & file size, so a changed file is decoded
+    // again. They are handed out as shared read-only images, which stay valid after being
+    // evicted. The entries are split into shards with their own lock & LRU list, so threads
+    // reading different images rarely wait for each other. Every use stamps the entry with a
+    // global counter, and eviction drops the entry with the oldest stamp of all shards, never
+    // the one just added.
+    class ImageCache {
+    public:
+        ImageCache(u64 maxBytes, u32 shards = 16);
+
+        // Returns the cached image or decodes & adds it. minWidth & minHeight are passed to
+        // the decoder (see pixl::read) and are part of the key.
+        // Returns a nullptr if the image can't be read.
+        std::shared_ptr<const Image> read(const char* path, u32 minWidth = 0, u32 minHeight = 0);
+
+        // Drops all entries.
+        void clear();
+
+        // Size of the pixel data of all entries.
+        u64 size() const { return this->bytes; }
+
+        u64 hits() const { return this->hitCount; }
+        u64 misses() const { return this->missCount; }
+
+        const u64 maxBytes;
+
+    private:
+        struct Entry {
+            std::string key;
+            std::shared_ptr<const Image> image;
+            // value of 'clock' when last used
+            u64 used;
+        };
+
+        struct Shard {
+            std::mutex mutex;
+            // most recently used first
+            std::list<Entry> entries;
+            std::unordered_map<std::string, std::list<Entry>::iterator> index;
+        };
+
+        void add(u32 shard, const std::string& key, std::shared_ptr<const Image> image);
+        bool evictOldest(const std::string& keep);
+
+        std::vector<std::unique_ptr<Shard>> shards;
+        std::atomic<u64> bytes;
+        std::atomic<u64> hitCount;
+        std::atomic<u64> missCount;
+        std::atomic<u64> clock;
+    };
+}
+
+#endif
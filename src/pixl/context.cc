@@ -0,0 +1,80 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <algorithm>
+
+#include "context.h"
+#include "types.h"
+
+namespace pixl {
+
+    static thread_local const ExecutionContext* currentContext = nullptr;
+
+    // Serializes all progress handlers, operations may run in parallel (e.g. in a batch)
+    static std::mutex progressMutex;
+
+    // ----------------------------------------------------------------------------
+    ContextScope::ContextScope(const ExecutionContext& context)
+        : context(context), previous(currentContext) {
+        currentContext = &this->context;
+    }
+
+    // ----------------------------------------------------------------------------
+    ContextScope::~ContextScope() {
+        currentContext = this->previous;
+    }
+
+    // ----------------------------------------------------------------------------
+    const ExecutionContext* current_context() {
+        return currentContext;
+    }
+
+    // ----------------------------------------------------------------------------
+    bool is_cancelled() {
+        return currentContext != nullptr && currentContext->token != nullptr &&
+               currentContext->token->cancelled();
+    }
+
+    // ----------------------------------------------------------------------------
+    void check_cancelled() {
+        if (is_cancelled())
+            throw CancelledException();
+    }
+
+    // ----------------------------------------------------------------------------
+    Progress::Progress(u64 total) : total(total), done(0), reported(-1) {
+        if (currentContext != nullptr) {
+            this->handler = currentContext->onProgress;
+        }
+    }
+
+    // ----------------------------------------------------------------------------
+    void Progress::advance(u64 amount) {
+        if (!this->handler || this->total == 0)
+            return;
+
+        const u64 done = this->done += amount;
+        const i32 percent = (i32)(std::min(done, this->total) * 100 / this->total);
+        if (percent <= this->reported)
+            return;
+
+        std::lock_guard<std::mutex> lock(progressMutex);
+        if (percent > this->reported) {
+            this->reported = percent;
+            this->handler(percent / 100.0f);
+        }
+    }
+}
@@ -0,0 +1,101 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef PIXL_CONTEXT_H
+#define PIXL_CONTEXT_H
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+
+#include "errors.h"
+#include "types.h"
+
+namespace pixl {
+
+    // Set to abort the operations using it. Operations check it once per band of rows, so
+    // they stop within milliseconds. Codecs check it per row (png) or before & after the
+    // image (jpeg).
+    class CancellationToken {
+    public:
+        void cancel() { this->cancelledFlag = true; }
+        bool cancelled() const { return this->cancelledFlag; }
+
+    private:
+        std::atomic<bool> cancelledFlag{false};
+    };
+
+    // Thrown by operations & codecs whose token has been cancelled. The image they were
+    // working on is left in an unspecified (but valid) state.
+    class CancelledException : public PixlException {
+    public:
+        CancelledException() : PixlException("Cancelled") {}
+    };
+
+    // Called with the progress [0, 1] of the running operation or codec. Calls may come from
+    // several threads but never overlap, and the values only increase until the next
+    // operation starts.
+    typedef std::function<void(f32 progress)> ProgressHandler;
+
+    struct ExecutionContext {
+        const CancellationToken* token = nullptr;
+        ProgressHandler onProgress;
+    };
+
+    // Uses the context for all operations started by the current thread while the scope is
+    // alive, including the parts running on the thread pool.
+    //
+    //     pixl::CancellationToken token;
+    //     pixl::ExecutionContext context;
+    //     context.token = &token;
+    //     pixl::ContextScope scope(context);
+    //     image->resize(1024, 768);   // throws a CancelledException once token.cancel() is called
+    class ContextScope {
+    public:
+        ContextScope(const ExecutionContext& context);
+        ~ContextScope();
+
+    private:
+        ExecutionContext context;
+        const ExecutionContext* previous;
+    };
+
+    // Context of the current thread, nullptr outside of a ContextScope.
+    const ExecutionContext* current_context();
+
+    // Checks if the token of the current context has been cancelled.
+    bool is_cancelled();
+
+    // Throws a CancelledException if the token of the current context has been cancelled.
+    void check_cancelled();
+
+    // Progress of a single operation, reported to the current context in steps of 1%.
+    class Progress {
+    public:
+        Progress(u64 total);
+
+        // Marks 'amount' more units of work as done. Thread safe.
+        void advance(u64 amount);
+
+    private:
+        ProgressHandler handler;
+        u64 total;
+        std::atomic<u64> done;
+        std::atomic<i32> reported;
+    };
+}
+
+#endif
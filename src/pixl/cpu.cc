@@ -0,0 +1,130 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+#include "cpu.h"
+#include "kernels.h"
+#include "types.h"
+
+namespace pixl {
+
+    static const Isa ISAS[] = {Isa::SSE2, Isa::SSE41, Isa::AVX2, Isa::AVX512};
+
+    // ----------------------------------------------------------------------------
+    static bool cpuSupports(Isa isa) {
+#if defined(__x86_64__) || defined(__i386__)
+        // also checks that the OS saves the AVX registers
+        __builtin_cpu_init();
+        switch (isa) {
+            case Isa::SSE2:
+                return true;
+            case Isa::SSE41:
+                return __builtin_cpu_supports("sse4.1");
+            case Isa::AVX2:
+                return __builtin_cpu_supports("avx2");
+            case Isa::AVX512:
+                return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+        }
+        return false;
+#else
+        return isa == Isa::SSE2;
+#endif
+    }
+
+    // ----------------------------------------------------------------------------
+    const char* isa_name(Isa isa) {
+        switch (isa) {
+            case Isa::SSE2:
+                return "sse2";
+            case Isa::SSE41:
+                return "sse4.1";
+            case Isa::AVX2:
+                return "avx2";
+            case Isa::AVX512:
+                return "avx512";
+        }
+        return "";
+    }
+
+    // ----------------------------------------------------------------------------
+    const Kernels* kernels_for(Isa isa) {
+        if (!cpuSupports(isa))
+            return nullptr;
+
+        switch (isa) {
+            case Isa::SSE2:
+                return kernels_sse2();
+            case Isa::SSE41:
+                return kernels_sse41();
+            case Isa::AVX2:
+                return kernels_avx2();
+            case Isa::AVX512:
+                return kernels_avx512();
+        }
+        return nullptr;
+    }
+
+    // ----------------------------------------------------------------------------
+    Isa select_isa(const char* requested) {
+        Isa selected = Isa::SSE2;
+        for (Isa isa : ISAS) {
+            if (kernels_for(isa) != nullptr) {
+                selected = isa;
+            }
+            if (requested != nullptr && strcmp(requested, isa_name(isa)) == 0)
+                break;
+        }
+        return selected;
+    }
+
+    // ----------------------------------------------------------------------------
+    Isa cpu_supported() {
+        static const Isa supported = select_isa(nullptr);
+        return supported;
+    }
+
+    // ----------------------------------------------------------------------------
+    Isa cpu_isa() {
+        static const Isa isa = select_isa(getenv("PIXL_CPU"));
+        return isa;
+    }
+
+    // ----------------------------------------------------------------------------
+    static std::atomic<bool>& referenceKernels() {
+        static std::atomic<bool> reference(getenv("PIXL_CPU") != nullptr &&
+                                           strcmp(getenv("PIXL_CPU"), "reference") == 0);
+        return reference;
+    }
+
+    // ----------------------------------------------------------------------------
+    void set_reference_kernels(bool reference) {
+        referenceKernels() = reference;
+    }
+
+    // ----------------------------------------------------------------------------
+    bool reference_kernels() {
+        return referenceKernels();
+    }
+
+    // ----------------------------------------------------------------------------
+    const Kernels& kernels() {
+        static const Kernels* selected = kernels_for(cpu_isa());
+        return referenceKernels() ? *kernels_reference() : *selected;
+    }
+}
@@ -0,0 +1,62 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef PIXL_CPU_H
+#define PIXL_CPU_H
+
+#include "types.h"
+
+namespace pixl {
+
+    // Instruction sets the kernels of the library are compiled for, from old to new.
+    //
+    // The hot loops of the operations are built once per instruction set and the best one the
+    // CPU supports is picked at startup, so a single binary runs at full speed on mixed
+    // machines. Setting the environment variable PIXL_CPU (sse2, sse4.1, avx2, avx512) caps
+    // the instruction set, e.g. to test the older variants on a new machine.
+    //
+    // Point operations, convolutions, alpha channels & the rows of resizes are dispatched
+    // (see Kernels). Flips & the fused point table (op::point) are not: they only move bytes
+    // or look them up in a table, are bound by memory and gain nothing from wider vectors.
+    enum class Isa {
+        // the baseline of the build (plain C++ on other architectures than x86)
+        SSE2,
+        SSE41,
+        AVX2,
+        // AVX-512F & BW, 64 byte vectors
+        AVX512,
+    };
+
+    // The newest instruction set that is both compiled in & supported by the CPU.
+    Isa cpu_supported();
+
+    // The instruction set the kernels run with, cpu_supported() capped by PIXL_CPU.
+    Isa cpu_isa();
+
+    // Name of the instruction set, as used by PIXL_CPU.
+    const char* isa_name(Isa isa);
+
+    // Runs all operations with the scalar reference kernels instead of the ones of cpu_isa(),
+    // to check whether an optimized kernel is to blame for a result (see compare_kernels).
+    // PIXL_CPU=reference turns this on at startup. Must not be called while the library is
+    // in use.
+    void set_reference_kernels(bool reference);
+
+    // Checks if the reference kernels are used.
+    bool reference_kernels();
+}
+
+#endif
@@ -0,0 +1,426 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <chrono>
+#include <utility>
+
+#include "deadline.h"
+#include "errors.h"
+#include "io.h"
+#include "types.h"
+#include "utils.h"
+
+namespace pixl {
+
+    // Degradations in the order they are tried, the ones hurting the result least come first.
+    static const Degradation ORDER[] = {
+        Degradation::FAST_PNG,
+        Degradation::FAST_DCT,
+        Degradation::NEAREST_RESIZE,
+        Degradation::REDUCED_DECODE,
+    };
+
+    // Weight of a new measurement in the moving average of the cost model
+    static const f64 LEARNING_RATE = 0.25;
+
+    // Dimensions & format of an input, read from its header.
+    struct Input {
+        ImageFormat format = ImageFormat::AUTO;
+        u32 width = 0;
+        u32 height = 0;
+    };
+
+    // A step of the optimized operations and the pixels it touches.
+    typedef std::pair<Cost, u64> Step;
+
+    typedef std::chrono::steady_clock Clock;
+
+    // ----------------------------------------------------------------------------
+    static f64 secondsSince(Clock::time_point start) {
+        return std::chrono::duration<f64>(Clock::now() - start).count();
+    }
+
+    // ----------------------------------------------------------------------------
+    const char* degradation_name(Degradation degradation) {
+        switch (degradation) {
+            case Degradation::FAST_PNG:
+                return "fast_png";
+            case Degradation::FAST_DCT:
+                return "fast_dct";
+            case Degradation::NEAREST_RESIZE:
+                return "nearest_resize";
+            case Degradation::REDUCED_DECODE:
+                return "reduced_decode";
+        }
+        return "";
+    }
+
+    // ----------------------------------------------------------------------------
+    CostModel::CostModel() {
+        // nanoseconds per pixel on a single core of a desktop machine
+        nanos[(u32)Cost::DECODE_JPEG] = 8;
+        nanos[(u32)Cost::DECODE_JPEG_FAST] = 6;
+        nanos[(u32)Cost::DECODE_PNG] = 15;
+        nanos[(u32)Cost::RESIZE_BILINEAR] = 8;
+        nanos[(u32)Cost::RESIZE_NEAREST] = 2;
+        nanos[(u32)Cost::CONVOLUTION] = 12;
+        nanos[(u32)Cost::POINT] = 1;
+        nanos[(u32)Cost::COPY] = 1;
+        nanos[(u32)Cost::ENCODE_JPEG] = 10;
+        nanos[(u32)Cost::ENCODE_JPEG_FAST] = 8;
+        nanos[(u32)Cost::ENCODE_PNG] = 40;
+        nanos[(u32)Cost::ENCODE_PNG_FAST] = 12;
+    }
+
+    // ----------------------------------------------------------------------------
+    f64 CostModel::estimate(Cost cost, u64 pixels) const {
+        return get(cost) * pixels * 1e-9;
+    }
+
+    // ----------------------------------------------------------------------------
+    void CostModel::record(Cost cost, u64 pixels, f64 seconds) {
+        if (pixels == 0 || cost == Cost::COUNT)
+            return;
+
+        std::lock_guard<std::mutex> lock(this->mutex);
+        f64& current = this->nanos[(u32)cost];
+        current += (seconds * 1e9 / pixels - current) * LEARNING_RATE;
+    }
+
+    // ----------------------------------------------------------------------------
+    f64 CostModel::get(Cost cost) const {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->nanos[(u32)cost];
+    }
+
+    // ----------------------------------------------------------------------------
+    void CostModel::set(Cost cost, f64 nanosPerPixel) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->nanos[(u32)cost] = nanosPerPixel;
+    }
+
+    // ----------------------------------------------------------------------------
+    std::shared_ptr<CostModel> CostModel::shared() {
+        static std::shared_ptr<CostModel> model = std::make_shared<CostModel>();
+        return model;
+    }
+
+    // ----------------------------------------------------------------------------
+    static bool has(const std::vector<Degradation>& degradations, Degradation degradation) {
+        for (Degradation d : degradations) {
+            if (d == degradation)
+                return true;
+        }
+        return false;
+    }
+
+    // ----------------------------------------------------------------------------
+    static bool probe(const char* path, Input& input) {
+        if (is_jpg(path)) {
+            JpegTurboReader reader;
+            input.format = ImageFormat::JPEG;
+            return reader.readSize(path, &input.width, &input.height);
+        }
+        if (is_png(path)) {
+            PngReader reader;
+            input.format = ImageFormat::PNG;
+            return reader.readSize(path, &input.width, &input.height);
+        }
+        return false;
+    }
+
+    // ----------------------------------------------------------------------------
+    // Format the result is encoded in, AUTO if there is none.
+    static ImageFormat outputFormat(const Pipeline& pipeline, const char* output) {
+        if (output == nullptr)
+            return ImageFormat::AUTO;
+        if (pipeline.encoding.format != ImageFormat::AUTO)
+            return pipeline.encoding.format;
+        if (is_png(output))
+            return ImageFormat::PNG;
+        if (is_jpg(output))
+            return ImageFormat::JPEG;
+        throw PixlException("Unsupported output format: " + std::string(output));
+    }
+
+    // ----------------------------------------------------------------------------
+    // The pipeline with the degradations of its operations applied.
+    static Pipeline degrade(const Pipeline& pipeline, const std::vector<Degradation>& degradations) {
+        Pipeline result;
+        result.encoding = pipeline.encoding;
+        result.images = pipeline.images;
+        result.bandHeight = pipeline.bandHeight;
+        for (Operation op : pipeline.operations()) {
+            if (op.type == OperationType::RESIZE && has(degradations, Degradation::NEAREST_RESIZE)) {
+                op.method = ResizeMethod::NEARSET_NEIGHBOR;
+            }
+            result.add(op);
+        }
+        return result;
+    }
+
+    // ----------------------------------------------------------------------------
+    // Minimum size a jpeg input is decoded at.
+    static bool decodeHint(const Pipeline& pipeline,
+                           const Input& input,
+                           const std::vector<Degradation>& degradations,
+                           u32* minWidth,
+                           u32* minHeight) {
+        if (input.format != ImageFormat::JPEG)
+            return false;
+        if (!has(degradations, Degradation::REDUCED_DECODE))
+            return pipeline.decodeHint(minWidth, minHeight);
+
+        // the first resize decides, no matter what is in front of it
+        for (auto& op : pipeline.operations()) {
+            if (op.type != OperationType::RESIZE)
+                continue;
+            if (op.width == 0 || op.height == 0 || op.width >= input.width ||
+                op.height >= input.height)
+                return false;
+
+            *minWidth = (op.width + 1) / 2;
+            *minHeight = (op.height + 1) / 2;
+            return true;
+        }
+        return false;
+    }
+
+    // ----------------------------------------------------------------------------
+    // Size of a DCT scaled decode, the smallest multiple of 1/8 that is big enough.
+    static void decodedSize(const Input& input, u32 minWidth, u32 minHeight, u32* w, u32* h) {
+        *w = input.width;
+        *h = input.height;
+        for (u32 n = 1; n < 8; n++) {
+            const u32 width = (u32)(((u64)input.width * n + 7) / 8);
+            const u32 height = (u32)(((u64)input.height * n + 7) / 8);
+            if (width >= minWidth && height >= minHeight) {
+                *w = width;
+                *h = height;
+                return;
+            }
+        }
+    }
+
+    // ----------------------------------------------------------------------------
+    // Steps of the optimized operations for an image of width x height.
+    static std::vector<Step> steps(const Pipeline& pipeline, u32 width, u32 height) {
+        std::vector<Step> result;
+        for (auto& op : pipeline.plan(width, height, 3)) {
+            const u64 pixels = (u64)width * height;
+            switch (op.type) {
+                case OperationType::RESIZE:
+                    width = op.width;
+                    height = op.height;
+                    result.push_back(Step(op.method == ResizeMethod::NEARSET_NEIGHBOR
+                                              ? Cost::RESIZE_NEAREST
+                                              : Cost::RESIZE_BILINEAR,
+                                          (u64)width * height));
+                    break;
+                case OperationType::CONVOLUTION:
+                    result.push_back(Step(Cost::CONVOLUTION, pixels));
+                    break;
+                case OperationType::GRAYSCALE:
+                case OperationType::INVERT:
+                case OperationType::CONTRAST:
+                case OperationType::POINT:
+                    result.push_back(Step(Cost::POINT, pixels));
+                    break;
+                default:
+                    result.push_back(Step(Cost::COPY, pixels));
+                    break;
+            }
+        }
+        return result;
+    }
+
+    // ----------------------------------------------------------------------------
+    static f64 estimate(const CostModel& costs,
+                        const Pipeline& pipeline,
+                        const Input& input,
+                        ImageFormat output,
+                        const std::vector<Degradation>& degradations) {
+        const bool fastDct = has(degradations, Degradation::FAST_DCT);
+        f64 seconds = 0;
+
+        u32 width = input.width;
+        u32 height = input.height;
+        u32 minWidth = 0, minHeight = 0;
+        if (decodeHint(pipeline, input, degradations, &minWidth, &minHeight)) {
+            decodedSize(input, minWidth, minHeight, &width, &height);
+        }
+        if (input.format == ImageFormat::JPEG) {
+            seconds += costs.estimate(fastDct ? Cost::DECODE_JPEG_FAST : Cost::DECODE_JPEG,
+                                      (u64)width * height);
+        } else {
+            seconds += costs.estimate(Cost::DECODE_PNG, (u64)width * height);
+        }
+
+        u64 pixels = (u64)width * height;
+        for (auto& step : steps(degrade(pipeline, degradations), width, height)) {
+            seconds += costs.estimate(step.first, step.second);
+            if (step.first == Cost::RESIZE_BILINEAR || step.first == Cost::RESIZE_NEAREST) {
+                pixels = step.second;
+            }
+        }
+
+        if (output == ImageFormat::PNG) {
+            const bool fastPng = has(degradations, Degradation::FAST_PNG);
+            seconds += costs.estimate(fastPng ? Cost::ENCODE_PNG_FAST : Cost::ENCODE_PNG, pixels);
+        } else if (output == ImageFormat::JPEG) {
+            seconds += costs.estimate(fastDct ? Cost::ENCODE_JPEG_FAST : Cost::ENCODE_JPEG, pixels);
+        }
+        return seconds;
+    }
+
+    // ----------------------------------------------------------------------------
+    DeadlinePipeline::DeadlinePipeline(const Pipeline& pipeline, f64 budget)
+        : budget(budget), costs(CostModel::shared()), pipeline(pipeline) {}
+
+    // ----------------------------------------------------------------------------
+    DeadlineReport DeadlinePipeline::plan(const char* input, const char* output) const {
+        DeadlineReport report;
+        Input info;
+        if (!probe(input, info))
+            return report;
+
+        const ImageFormat format = outputFormat(this->pipeline, output);
+        report.estimated = estimate(*this->costs, this->pipeline, info, format, {});
+
+        // degradations that don't make it cheaper (e.g. fast_png for jpegs) are skipped
+        for (Degradation degradation : ORDER) {
+            if (report.estimated <= this->budget)
+                break;
+
+            std::vector<Degradation> degradations = report.degradations;
+            degradations.push_back(degradation);
+            const f64 seconds = estimate(*this->costs, this->pipeline, info, format, degradations);
+            if (seconds < report.estimated) {
+                report.degradations = degradations;
+                report.estimated = seconds;
+            }
+        }
+        return report;
+    }
+
+    // ----------------------------------------------------------------------------
+    Image* DeadlinePipeline::run(const char* input, const char* output, const DeadlineReport& plan) {
+        const auto start = Clock::now();
+        const std::vector<Degradation>& degradations = plan.degradations;
+        const bool fastDct = has(degradations, Degradation::FAST_DCT);
+        const ImageFormat format = outputFormat(this->pipeline, output);
+        const Pipeline degraded = degrade(this->pipeline, degradations);
+
+        // decode, decoded images from a cache say nothing about the costs
+        Input info;
+        probe(input, info);
+        Image* image = nullptr;
+        u32 minWidth = 0, minHeight = 0;
+        if (info.format == ImageFormat::JPEG &&
+            (fastDct || has(degradations, Degradation::REDUCED_DECODE))) {
+            JpegTurboReader reader;
+            reader.fastDct = fastDct;
+            if (decodeHint(this->pipeline, info, degradations, &minWidth, &minHeight)) {
+                reader.minWidth = minWidth;
+                reader.minHeight = minHeight;
+            }
+            image = reader.read(input);
+        } else {
+            image = degraded.decode(input);
+        }
+        if (image == nullptr)
+            return nullptr;
+
+        if (!this->pipeline.images) {
+            const Cost cost = info.format == ImageFormat::PNG
+                                  ? Cost::DECODE_PNG
+                                  : (fastDct ? Cost::DECODE_JPEG_FAST : Cost::DECODE_JPEG);
+            this->costs->record(cost, (u64)image->width * image->height, secondsSince(start));
+        }
+
+        try {
+            // operations are fused & run band by band, so their measured time is split up by
+            // their estimated share
+            const auto stepsStart = Clock::now();
+            const std::vector<Step> planned = steps(degraded, image->width, image->height);
+            degraded.execute(image);
+            const f64 measured = secondsSince(stepsStart);
+
+            f64 estimated = 0;
+            for (auto& step : planned) {
+                estimated += this->costs->estimate(step.first, step.second);
+            }
+            for (u64 i = 0; i < planned.size() && estimated > 0; i++) {
+                const Step& step = planned[i];
+                const f64 share = this->costs->estimate(step.first, step.second) / estimated;
+                this->costs->record(step.first, step.second, measured * share);
+            }
+
+            // encode
+            const auto encodeStart = Clock::now();
+            if (format == ImageFormat::PNG) {
+                const bool fastPng = has(degradations, Degradation::FAST_PNG);
+                PngWriter writer;
+                writer.compressionLevel = fastPng ? 1 : -1;
+                writer.write(image, output);
+                this->costs->record(fastPng ? Cost::ENCODE_PNG_FAST : Cost::ENCODE_PNG,
+                                    (u64)image->width * image->height,
+                                    secondsSince(encodeStart));
+            } else if (format == ImageFormat::JPEG) {
+                JpegTurboWriter writer;
+                writer.quality = this->pipeline.encoding.quality;
+                writer.subsampling = this->pipeline.encoding.subsampling;
+                writer.fastDct = fastDct;
+                writer.write(image, output);
+                this->costs->record(fastDct ? Cost::ENCODE_JPEG_FAST : Cost::ENCODE_JPEG,
+                                    (u64)image->width * image->height,
+                                    secondsSince(encodeStart));
+            }
+        } catch (...) {
+            delete image;
+            throw;
+        }
+
+        this->lastReport = plan;
+        this->lastReport.elapsed = secondsSince(start);
+        return image;
+    }
+
+    // ----------------------------------------------------------------------------
+    Image* DeadlinePipeline::execute(const char* path) {
+        return run(path, nullptr, plan(path, nullptr));
+    }
+
+    // ----------------------------------------------------------------------------
+    void DeadlinePipeline::write(const char* input, const char* output) {
+        const auto start = Clock::now();
+        const DeadlineReport report = plan(input, output);
+
+        // full quality results may come from & go to the cache
+        if (report.degradations.empty() && this->pipeline.cache) {
+            this->pipeline.write(input, output);
+            this->lastReport = report;
+            this->lastReport.elapsed = secondsSince(start);
+            return;
+        }
+
+        Image* image = run(input, output, report);
+        if (image == nullptr)
+            throw PixlException("Failed to read image");
+        delete image;
+        this->lastReport.elapsed = secondsSince(start);
+    }
+}
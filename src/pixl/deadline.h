@@ -0,0 +1,141 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef PIXL_DEADLINE_H
+#define PIXL_DEADLINE_H
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "image.h"
+#include "pipeline.h"
+#include "types.h"
+
+namespace pixl {
+
+    // Cheaper variants of the steps of a pipeline, in the order they are picked.
+    enum class Degradation {
+        // pngs are written with the lowest zlib compression level (larger files)
+        FAST_PNG,
+        // jpegs are decoded & encoded with the fast integer DCT
+        FAST_DCT,
+        // bilinear resizes use nearest neighbor instead
+        NEAREST_RESIZE,
+        // jpegs are decoded at about half the size the first resize needs (DCT scaling), the
+        // resize then upscales
+        REDUCED_DECODE,
+    };
+
+    // Name of the degradation, e.g. "fast_dct".
+    const char* degradation_name(Degradation degradation);
+
+    // Steps of a pipeline with their own costs.
+    enum class Cost {
+        DECODE_JPEG,
+        DECODE_JPEG_FAST,
+        DECODE_PNG,
+        RESIZE_BILINEAR,
+        RESIZE_NEAREST,
+        CONVOLUTION,
+        // grayscale, invert, contrast & fused point operations
+        POINT,
+        // flips & alpha channel operations
+        COPY,
+        ENCODE_JPEG,
+        ENCODE_JPEG_FAST,
+        ENCODE_PNG,
+        ENCODE_PNG_FAST,
+        COUNT,
+    };
+
+    // Time per pixel of every step. Starts with rough defaults and learns from measurements
+    // (moving average), so estimates match the machine & its current load. Thread safe.
+    class CostModel {
+    public:
+        CostModel();
+
+        // Estimated seconds the step takes for the given number of pixels. Resizes count the
+        // pixels they write, everything else the pixels it reads.
+        f64 estimate(Cost cost, u64 pixels) const;
+
+        // Adds a measurement.
+        void record(Cost cost, u64 pixels, f64 seconds);
+
+        // Nanoseconds per pixel of the step.
+        f64 get(Cost cost) const;
+        void set(Cost cost, f64 nanosPerPixel);
+
+        // Model shared by all deadline pipelines that don't set their own.
+        static std::shared_ptr<CostModel> shared();
+
+    private:
+        mutable std::mutex mutex;
+        std::array<f64, (u32)Cost::COUNT> nanos;
+    };
+
+    // What a deadline pipeline did (or would do) for an input.
+    struct DeadlineReport {
+        // degradations applied to meet the budget
+        std::vector<Degradation> degradations;
+
+        // estimated & measured seconds
+        f64 estimated = 0;
+        f64 elapsed = 0;
+    };
+
+    // Executes a pipeline within a time budget, degrading the quality of the result instead
+    // of taking longer, e.g. to keep latencies flat under load spikes.
+    //
+    // Before every run the steps (decoding, the optimized operations, encoding) are estimated
+    // with the cost model, using the dimensions read from the header of the input. As long as
+    // the estimate is over the budget, the next degradation that lowers it is applied. The
+    // times measured afterwards update the cost model. Budgets too small to meet still get
+    // the cheapest variant, never an error.
+    class DeadlinePipeline {
+    public:
+        // Budget in seconds
+        DeadlinePipeline(const Pipeline& pipeline, f64 budget);
+
+        // The degradations & estimate for input, written to output (may be nullptr).
+        DeadlineReport plan(const char* input, const char* output) const;
+
+        // Decodes the image at path and executes the pipeline on it. The caller is
+        // responsible for deleting the image. Returns a nullptr if the image can't be read.
+        Image* execute(const char* path);
+
+        // Decodes the image at input, executes the pipeline and encodes the result to output.
+        // Degraded results are never stored in the cache of the pipeline.
+        void write(const char* input, const char* output);
+
+        // Report of the last execute() or write().
+        const DeadlineReport& report() const { return this->lastReport; }
+
+        f64 budget;
+
+        // Defaults to CostModel::shared()
+        std::shared_ptr<CostModel> costs;
+
+    private:
+        Pipeline pipeline;
+        DeadlineReport lastReport;
+
+        Image* run(const char* input, const char* output, const DeadlineReport& plan);
+    };
+}
+
+#endif
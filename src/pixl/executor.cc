@@ -0,0 +1,211 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <algorithm>
+#include <cstring>
+
+#include "executor.h"
+#include "image.h"
+#include "operations.h"
+#include "types.h"
+#include "utils.h"
+
+// Bands are never smaller than this, so per band overhead & halos stay small
+#define MIN_BAND_HEIGHT 4
+
+namespace pixl {
+
+    // ----------------------------------------------------------------------------
+    void BandExecutor::inputRows(const Operation& op,
+                                 i32 inHeight,
+                                 i32 height,
+                                 i32* y0,
+                                 i32* y1) {
+        switch (op.type) {
+            case OperationType::RESIZE:
+                if (op.method == ResizeMethod::NEARSET_NEIGHBOR) {
+                    *y0 = op::resize_nearest_row(*y0, inHeight, height);
+                    *y1 = op::resize_nearest_row(*y1 - 1, inHeight, height) + 1;
+                } else {
+                    // interpolates between two rows
+                    *y0 = op::resize_bilinear_row(*y0, inHeight, height);
+                    *y1 = op::resize_bilinear_row(*y1 - 1, inHeight, height) + 2;
+                }
+                break;
+            case OperationType::FLIP:
+                if (op.orientation == Orientation::VERTICAL) {
+                    const i32 y = *y0;
+                    *y0 = inHeight - *y1;
+                    *y1 = inHeight - y;
+                }
+                break;
+            case OperationType::CONVOLUTION:
+                // the result of a row is computed from it & the two rows below it
+                *y1 += 2;
+                break;
+            default:
+                break;
+        }
+
+        *y0 = std::max(*y0, 0);
+        *y1 = std::min(*y1, inHeight);
+    }
+
+    // ----------------------------------------------------------------------------
+    void BandExecutor::runOperation(const Operation& op, const op::Band& in, const op::Band& out) {
+        switch (op.type) {
+            case OperationType::RESIZE:
+                if (op.method == ResizeMethod::NEARSET_NEIGHBOR) {
+                    op::resize_nearest_rows(in, out);
+                } else {
+                    op::resize_bilinear_rows(in, out);
+                }
+                break;
+            case OperationType::FLIP:
+                if (op.orientation == Orientation::VERTICAL) {
+                    op::flip_vertically_rows(in, out);
+                } else {
+                    op::flip_horizontally_rows(in, out);
+                }
+                break;
+            case OperationType::CONVOLUTION:
+                op::convolution_rows(in, out, op.kernel, op.value);
+                break;
+            case OperationType::GRAYSCALE:
+                op::grayscale_rows(in, out);
+                break;
+            case OperationType::INVERT:
+                op::invert_rows(in, out);
+                break;
+            case OperationType::ADD_ALPHA_CHANNEL:
+                if (in.channels == 3) {
+                    op::add_alpha_channel_rows(in, out, (u8)op.value);
+                } else {
+                    for (i32 y = out.y0; y < out.y1; y++) {
+                        memcpy(out.row(y), in.row(y), out.lineSize);
+                    }
+                }
+                break;
+            case OperationType::REMOVE_ALPHA_CHANNEL:
+                if (in.channels == 4) {
+                    op::remove_alpha_channel_rows(in, out);
+                } else {
+                    for (i32 y = out.y0; y < out.y1; y++) {
+                        memcpy(out.row(y), in.row(y), out.lineSize);
+                    }
+                }
+                break;
+            case OperationType::CONTRAST:
+                op::contrast_rows(in, out, op.value);
+                break;
+            case OperationType::POINT:
+                op::point_rows(in, out, op.before.data(), op.grayscale, op.after.data());
+                break;
+        }
+    }
+
+    // ----------------------------------------------------------------------------
+    BandExecutor::BandExecutor(const std::vector<Operation>& ops, const Image* input)
+        : input(input) {
+        i32 width = input->width;
+        i32 height = input->height;
+        i32 channels = input->channels;
+
+        for (auto& op : ops) {
+            if (op.type == OperationType::RESIZE) {
+                width = op.width;
+                height = op.height;
+            } else if (op.type == OperationType::ADD_ALPHA_CHANNEL && channels == 3) {
+                channels = 4;
+            } else if (op.type == OperationType::REMOVE_ALPHA_CHANNEL && channels == 4) {
+                channels = 3;
+            }
+
+            Stage stage = {op, width, height, channels, std::vector<u8>()};
+            this->stages.push_back(stage);
+        }
+    }
+
+    // ----------------------------------------------------------------------------
+    i32 BandExecutor::width() const {
+        return this->stages.empty() ? this->input->width : this->stages.back().width;
+    }
+
+    // ----------------------------------------------------------------------------
+    i32 BandExecutor::height() const {
+        return this->stages.empty() ? this->input->height : this->stages.back().height;
+    }
+
+    // ----------------------------------------------------------------------------
+    i32 BandExecutor::channels() const {
+        return this->stages.empty() ? this->input->channels : this->stages.back().channels;
+    }
+
+    // ----------------------------------------------------------------------------
+    i32 BandExecutor::bandHeight(u64 bytes) const {
+        // A band of the result needs about as many rows of every stage in front of it,
+        // scaled by the resizes in between.
+        f64 bytesPerRow = (f64)width() * channels();
+        for (auto& stage : this->stages) {
+            const f64 rows = (f64)stage.height / height();
+            bytesPerRow += rows * stage.width * stage.channels;
+        }
+
+        const i32 rows = (i32)(bytes / std::max(bytesPerRow, 1.0));
+        return clamp(rows, std::min(MIN_BAND_HEIGHT, height()), std::max(height(), 1));
+    }
+
+    // ----------------------------------------------------------------------------
+    op::Band BandExecutor::pull(i32 index, i32 y0, i32 y1, const op::Band* target) {
+        if (index < 0) {
+            return op::band(this->input);
+        }
+
+        Stage& stage = this->stages[index];
+        const i32 inHeight = (index > 0) ? this->stages[index - 1].height : this->input->height;
+
+        // fetch the rows this operation depends on
+        i32 in0 = y0, in1 = y1;
+        inputRows(stage.op, inHeight, stage.height, &in0, &in1);
+        const op::Band in = pull(index - 1, in0, in1, nullptr);
+
+        // compute into the target or the band buffer of the stage
+        op::Band out;
+        if (target != nullptr) {
+            out = *target;
+        } else {
+            const u64 lineSize = (u64)stage.width * stage.channels;
+            stage.buffer.resize(lineSize * (y1 - y0));
+            out = op::Band{stage.buffer.data(), stage.width, stage.height, stage.channels,
+                           y0, y1, lineSize};
+        }
+        runOperation(stage.op, in, out);
+
+        return out;
+    }
+
+    // ----------------------------------------------------------------------------
+    void BandExecutor::run(const op::Band& out) {
+        if (this->stages.empty()) {
+            for (i32 y = out.y0; y < out.y1; y++) {
+                memcpy(out.row(y), this->input->getPixel(0, y), out.lineSize);
+            }
+            return;
+        }
+
+        pull((i32)this->stages.size() - 1, out.y0, out.y1, &out);
+    }
+}
@@ -0,0 +1,75 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef PIXL_EXECUTOR_H
+#define PIXL_EXECUTOR_H
+
+#include <vector>
+
+#include "image.h"
+#include "operations.h"
+#include "pipeline.h"
+#include "types.h"
+
+namespace pixl {
+
+    // Executes a chain of operations band by band.
+    //
+    // Rows of the result are computed on demand: every operation declares which rows of its
+    // input it needs for a range of output rows (e.g. two more for the convolution), and pulls
+    // those from the operation in front of it. Only the input and the result are full images,
+    // every operation in between just keeps the band it computed last.
+    class BandExecutor {
+    public:
+        BandExecutor(const std::vector<Operation>& ops, const Image* input);
+
+        // Dimensions of the result.
+        i32 width() const;
+        i32 height() const;
+        i32 channels() const;
+
+        // Number of rows per band so the bands of all operations fit in the given number of
+        // bytes, e.g. the size of the L2 cache.
+        i32 bandHeight(u64 bytes) const;
+
+        // Computes rows [out.y0, out.y1) of the result.
+        void run(const op::Band& out);
+
+        // Rows [*y0, *y1) of the input an operation needs to compute rows [y0, y1) of its
+        // output.
+        static void inputRows(const Operation& op, i32 inHeight, i32 height, i32* y0, i32* y1);
+
+        // Computes the rows of out from in with a single operation.
+        static void runOperation(const Operation& op, const op::Band& in, const op::Band& out);
+
+    private:
+        struct Stage {
+            Operation op;
+            i32 width;
+            i32 height;
+            i32 channels;
+            std::vector<u8> buffer;
+        };
+
+        // Computes rows [y0, y1) of the output of stage 'index' (-1 is the input).
+        op::Band pull(i32 index, i32 y0, i32 y1, const op::Band* target);
+
+        const Image* input;
+        std::vector<Stage> stages;
+    };
+}
+
+#endif
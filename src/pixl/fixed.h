@@ -0,0 +1,78 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef PIXL_FIXED_H
+#define PIXL_FIXED_H
+
+#include <cmath>
+
+#include "types.h"
+
+namespace pixl {
+
+    // Fixed point math for per pixel work: integers with an implied number of fraction bits
+    // (Q format), e.g. 1.5 is 384 in Q8. 16 bit integer lanes are half as wide as floats, so
+    // vectorized kernels handle twice the values per instruction. Only used where the error
+    // of the format keeps 8 bit results within one of the exact value.
+    namespace fixed {
+
+        // Reciprocals of the divisors 1 to 4 (e.g. color channels) in Q16, rounded up so
+        // that divide() is exact.
+        const u32 RECIPROCALS_Q16[5] = {0, 65536, 32768, 21846, 16384};
+
+        // Converts a value to Q format with 'bits' fraction bits, rounded to the nearest
+        // integer & saturated to i16.
+        inline i16 to_q(f32 value, u32 bits) {
+            const f32 scaled = value * (f32)(1 << bits);
+            // also catches NaN
+            if (!(scaled > -32768.0f))
+                return -32768;
+            if (scaled > 32767.0f)
+                return 32767;
+            return (i16)std::floor(scaled + 0.5f);
+        }
+
+        // Product of a & b, one of them in Q format with 'bits' fraction bits, rounded down.
+        inline i32 mul_floor(i32 a, i32 b, u32 bits) {
+            // >> of negative values is an arithmetic shift on all supported compilers
+            return (a * b) >> bits;
+        }
+
+        // Product of a & b, one of them in Q format with 'bits' fraction bits, rounded to the
+        // nearest integer (halves up).
+        inline i32 mul_round(i32 a, i32 b, u32 bits) {
+            return (a * b + (1 << (bits - 1))) >> bits;
+        }
+
+        // a + t * (b - a) for integers a & b and t in Q format, the result is in the same Q
+        // format as t.
+        inline i32 lerp(i32 a, i32 b, i32 t, u32 bits) {
+            return a * (1 << bits) + t * (b - a);
+        }
+
+        // Clamps a value to [0, 255].
+        inline u8 saturate_u8(i32 value) {
+            return (u8)(value < 0 ? 0 : (value > 255 ? 255 : value));
+        }
+
+        // value / divisor rounded down, for divisors 1 to 4 and values below 32768.
+        inline u32 divide(u32 value, u32 divisor) {
+            return (value * RECIPROCALS_Q16[divisor]) >> 16;
+        }
+    }
+}
+
+#endif
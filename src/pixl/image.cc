@@ -19,6 +19,7 @@
 #include <array>
 
 #include "image.h"
+#include "numa.h"
 #include "types.h"
 #include "utils.h"
 #include "operations.h"
@@ -43,18 +44,18 @@ namespace pixl {
           size(height * width * channels),
           lineSize(channels * width) 
     {
-        this->data = (u8*)malloc(this->size);
+        this->data = (u8*)numa_malloc(this->size);
     }
 
     // ----------------------------------------------------------------------------
-    Image::Image(Image* image)
+    Image::Image(const Image* image)
         : width(image->width),
           height(image->height),
           channels(image->channels),
           size(image->size),
           lineSize(image->lineSize) 
     {
-        this->data = (u8*)malloc(image->size);
+        this->data = (u8*)numa_malloc(image->size);
         memcpy(this->data, image->data, image->size);
     }
 
@@ -63,14 +64,20 @@ namespace pixl {
 
     // ----------------------------------------------------------------------------
     Image* Image::resize(u32 width, u32 height, ResizeMethod method) {
-        // malloc new data
-        u8* imageBuffer = (u8*)malloc(sizeof(u8) * width * height * this->channels);
+        // malloc new data, next to the old one
+        u8* imageBuffer = (u8*)numa_malloc(sizeof(u8) * width * height * this->channels,
+                                           numa_node_of(this->data));
 
         // perform operation
-        if (method == ResizeMethod::NEARSET_NEIGHBOR) {
-            op::resize_nearest(this, imageBuffer, width, height);
-        } else if (method == ResizeMethod::BILINEAR) {
-            op::resize_bilinear(this, imageBuffer, width, height);
+        try {
+            if (method == ResizeMethod::NEARSET_NEIGHBOR) {
+                op::resize_nearest(this, imageBuffer, width, height);
+            } else if (method == ResizeMethod::BILINEAR) {
+                op::resize_bilinear(this, imageBuffer, width, height);
+            }
+        } catch (...) {
+            free(imageBuffer);
+            throw;
         }
 
         // update image
@@ -50,7 +50,7 @@ namespace pixl {
         Image(u32 width, u32 height, u32 channels);        
         
         // Image copy constructor. 
-        Image(Image* image);
+        Image(const Image* image);
 
         // Releases all resources accociated with this image.
         ~Image();
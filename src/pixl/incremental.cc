@@ -0,0 +1,221 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+#include "incremental.h"
+#include "errors.h"
+#include "executor.h"
+#include "image.h"
+#include "operations.h"
+#include "threads.h"
+#include "types.h"
+#include "utils.h"
+
+namespace pixl {
+
+    // ----------------------------------------------------------------------------
+    // Range [*a0, *a1) of the 'size' rows or columns of an output that read from [a0, a1) of
+    // the input. reads(a, from, to) sets the input range output row/column a reads from, which
+    // must move further down/right for rows/columns further down/right, so the first and last
+    // one reading from [a0, a1) are found by a binary search.
+    static void dependentRange(i32 size,
+                               const std::function<void(i32, i32*, i32*)>& reads,
+                               i32* a0,
+                               i32* a1) {
+        i32 low = 0, high = size;
+        while (low < high) {
+            const i32 a = (low + high) / 2;
+            i32 from, to;
+            reads(a, &from, &to);
+            if (to <= *a0) {
+                low = a + 1;
+            } else {
+                high = a;
+            }
+        }
+        const i32 first = low;
+
+        high = size;
+        while (low < high) {
+            const i32 a = (low + high) / 2;
+            i32 from, to;
+            reads(a, &from, &to);
+            if (from < *a1) {
+                low = a + 1;
+            } else {
+                high = a;
+            }
+        }
+
+        *a0 = first;
+        *a1 = low;
+    }
+
+    // ----------------------------------------------------------------------------
+    // Rows [*y0, *y1) of the output of an operation that depend on rows [y0, y1) of its input.
+    static void outputRows(const Operation& op, i32 inHeight, i32 height, i32* y0, i32* y1) {
+        if (op.type == OperationType::FLIP && op.orientation == Orientation::VERTICAL) {
+            const i32 y = *y0;
+            *y0 = inHeight - *y1;
+            *y1 = inHeight - y;
+            return;
+        }
+
+        dependentRange(height,
+                       [&](i32 y, i32* from, i32* to) {
+                           *from = y;
+                           *to = y + 1;
+                           BandExecutor::inputRows(op, inHeight, height, from, to);
+                       },
+                       y0,
+                       y1);
+    }
+
+    // ----------------------------------------------------------------------------
+    // Columns [*x0, *x1) of the output of an operation that depend on columns [x0, x1) of its
+    // input.
+    static void outputColumns(const Operation& op, i32 inWidth, i32 width, i32* x0, i32* x1) {
+        switch (op.type) {
+            case OperationType::RESIZE:
+                // columns are mapped like rows (see op::resize_*_rows)
+                dependentRange(width,
+                               [&](i32 x, i32* from, i32* to) {
+                                   if (op.method == ResizeMethod::NEARSET_NEIGHBOR) {
+                                       *from = op::resize_nearest_row(x, inWidth, width);
+                                       *to = *from + 1;
+                                   } else {
+                                       // interpolates between two columns
+                                       *from = op::resize_bilinear_row(x, inWidth, width);
+                                       *to = *from + 2;
+                                   }
+                               },
+                               x0,
+                               x1);
+                break;
+            case OperationType::FLIP:
+                if (op.orientation == Orientation::HORIZONTAL) {
+                    const i32 x = *x0;
+                    *x0 = inWidth - *x1;
+                    *x1 = inWidth - x;
+                }
+                break;
+            case OperationType::CONVOLUTION:
+                // a pixel is computed from it & the two pixels right of it
+                *x0 -= 2;
+                break;
+            default:
+                break;
+        }
+
+        *x0 = std::max(*x0, 0);
+        *x1 = std::min(*x1, width);
+    }
+
+    // ----------------------------------------------------------------------------
+    IncrementalPipeline::IncrementalPipeline(const Pipeline& pipeline) : pipeline(pipeline) {}
+
+    // ----------------------------------------------------------------------------
+    const Image* IncrementalPipeline::result() const {
+        return this->stages.empty() ? nullptr : this->stages.back().get();
+    }
+
+    // ----------------------------------------------------------------------------
+    const Image* IncrementalPipeline::execute(const Image* input) {
+        this->inputWidth = input->width;
+        this->inputHeight = input->height;
+        this->inputChannels = input->channels;
+        this->ops = this->pipeline.plan(input->width, input->height, input->channels);
+        this->stages.clear();
+
+        // stage 0 is a copy of the input, so the result is there even without operations
+        this->stages.push_back(std::unique_ptr<Image>(new Image(input)));
+
+        i32 width = input->width;
+        i32 height = input->height;
+        i32 channels = input->channels;
+        for (auto& op : this->ops) {
+            if (op.type == OperationType::RESIZE) {
+                width = op.width;
+                height = op.height;
+            } else if (op.type == OperationType::ADD_ALPHA_CHANNEL && channels == 3) {
+                channels = 4;
+            } else if (op.type == OperationType::REMOVE_ALPHA_CHANNEL && channels == 4) {
+                channels = 3;
+            }
+            this->stages.push_back(std::unique_ptr<Image>(new Image(width, height, channels)));
+        }
+
+        Rect all;
+        all.width = input->width;
+        all.height = input->height;
+        return update(input, all);
+    }
+
+    // ----------------------------------------------------------------------------
+    const Image* IncrementalPipeline::update(const Image* input, const Rect& dirty, Rect* changed) {
+        if (this->stages.empty())
+            throw PixlException("IncrementalPipeline::execute must be called first");
+        if (input->width != this->inputWidth || input->height != this->inputHeight ||
+            input->channels != this->inputChannels)
+            throw PixlException("The input changed its dimensions");
+
+        i32 x0 = clamp(dirty.x, 0, input->width);
+        i32 x1 = (i32)clamp((i64)dirty.x + dirty.width, (i64)x0, (i64)input->width);
+        i32 y0 = clamp(dirty.y, 0, input->height);
+        i32 y1 = (i32)clamp((i64)dirty.y + dirty.height, (i64)y0, (i64)input->height);
+
+        // copy the changed rows of the input
+        Image* first = this->stages[0].get();
+        for (i32 y = y0; y < y1; y++) {
+            memcpy(first->getPixel(0, y), input->getPixel(0, y), first->lineSize);
+        }
+
+        const i32 tile = (i32)std::max(this->tileHeight, 1u);
+        for (u64 i = 0; i < this->ops.size() && y0 < y1 && x0 < x1; i++) {
+            const Operation& op = this->ops[i];
+            const Image* in = this->stages[i].get();
+            Image* out = this->stages[i + 1].get();
+
+            outputRows(op, in->height, out->height, &y0, &y1);
+            outputColumns(op, in->width, out->width, &x0, &x1);
+
+            // whole tiles
+            y0 = y0 / tile * tile;
+            y1 = std::min((y1 + tile - 1) / tile * tile, (i32)out->height);
+
+            const op::Band from = op::band(in);
+            const op::Band to = op::band(out);
+            parallel_for(y0, y1, tile, [&](i64 a, i64 b) {
+                BandExecutor::runOperation(op, from, to.rows((i32)a, (i32)b));
+            });
+        }
+
+        if (changed != nullptr) {
+            *changed = Rect();
+            if (y0 < y1 && x0 < x1) {
+                changed->x = x0;
+                changed->y = y0;
+                changed->width = x1 - x0;
+                changed->height = y1 - y0;
+            }
+        }
+
+        return result();
+    }
+}
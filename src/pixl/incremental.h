@@ -0,0 +1,76 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef PIXL_INCREMENTAL_H
+#define PIXL_INCREMENTAL_H
+
+#include <memory>
+#include <vector>
+
+#include "image.h"
+#include "pipeline.h"
+#include "types.h"
+
+namespace pixl {
+
+    // A rectangle of pixels.
+    struct Rect {
+        i32 x = 0;
+        i32 y = 0;
+        i32 width = 0;
+        i32 height = 0;
+    };
+
+    // Executes a pipeline and keeps the result of every operation, so after a change of a
+    // small region of the input only the affected part is computed again, e.g. in an editor.
+    //
+    // The dirty region is followed through the operations, growing by what each of them
+    // reads around a pixel (two rows for the convolution, the interpolated neighbors of a
+    // resize) and moving with flips. Results are kept in tiles of whole rows: every
+    // operation only recomputes the tiles its dirty rows fall into. The results are the same
+    // as executing the whole pipeline again.
+    //
+    // All intermediate results stay in memory, which takes about the size of the input per
+    // operation of the optimized pipeline.
+    class IncrementalPipeline {
+    public:
+        IncrementalPipeline(const Pipeline& pipeline);
+
+        // Executes the whole pipeline on the input. The input is not modified.
+        const Image* execute(const Image* input);
+
+        // Updates the result after the pixels of the input within 'dirty' have changed. The
+        // input must have the dimensions of the one passed to execute(). If 'changed' is
+        // given, it's set to the region of the result that may have changed.
+        const Image* update(const Image* input, const Rect& dirty, Rect* changed = nullptr);
+
+        // The current result, nullptr before execute() has been called.
+        const Image* result() const;
+
+        // Number of rows per tile.
+        u32 tileHeight = 64;
+
+    private:
+        Pipeline pipeline;
+        std::vector<Operation> ops;
+        std::vector<std::unique_ptr<Image>> stages;
+        i32 inputWidth = 0;
+        i32 inputHeight = 0;
+        i32 inputChannels = 0;
+    };
+}
+
+#endif
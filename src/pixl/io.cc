@@ -31,6 +31,18 @@ namespace pixl {
         return nullptr;
     }
 
+    // ----------------------------------------------------------------------------
+    Image* read(const char* path, u32 minWidth, u32 minHeight) {
+        if (is_jpg(path)) {
+            JpegTurboReader reader;
+            reader.minWidth = minWidth;
+            reader.minHeight = minHeight;
+            return reader.read(path);
+        }
+
+        return read(path);
+    }
+
     // ----------------------------------------------------------------------------
     void write(Image* image, const char* path, i32 quality) {
         if (is_png(path)) { // png
@@ -48,6 +60,8 @@ namespace pixl {
     // ----------------------------------------------------------------------------
     u8* read_binary(const char* path, u64* length) {
         FILE* file = fopen(path, "rb");
+        if (!file)
+            return nullptr;
 
         // read file size
         fseek(file, 0, SEEK_END);
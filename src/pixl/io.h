@@ -17,6 +17,8 @@
 #ifndef PIXL_IO_H
 #define PIXL_IO_H
 
+#include <vector>
+
 #include "image.h"
 #include "utils.h"
 
@@ -47,6 +49,12 @@ namespace pixl {
     class PngReader : public ImageReader {
     public:
         Image* read(const char* path);
+
+        // Reads the dimensions of the png at path from its header without decoding it.
+        bool readSize(const char* path, u32* width, u32* height);
+
+        // Drops the alpha channel of images that are fully opaque.
+        bool stripOpaqueAlpha = false;
     };
 
     // libpng writer.
@@ -55,21 +63,51 @@ namespace pixl {
     class PngWriter : public ImageWriter {
     public:
         void write(Image* image, const char* path);
+
+        // Writes images that are fully opaque without alpha channel.
+        bool stripOpaqueAlpha = true;
+
+        // zlib compression level from 0 (none) to 9 (smallest), -1 is the default of zlib.
+        i32 compressionLevel = -1;
     };
 
     // libjpegturbo reader.
     //
     // This reader uses the official libpng library to decode png images.
+    //
+    // If minWidth & minHeight are set, the image is decoded at the smallest size that is at
+    // least that big: the exif thumbnail if there is one with the same aspect ratio, otherwise
+    // a DCT scaled version (1/8, 1/4, ...) of the image.
     class JpegTurboReader : public ImageReader {
     public:
         JpegTurboReader();
         ~JpegTurboReader();
         Image* read(const char* path);
 
+        // Decodes a jpeg in memory. Returns a nullptr if decoding failed.
+        Image* decode(const u8* data, u64 length);
+
+        // Reads the dimensions of the jpeg at path without decoding it.
+        bool readSize(const char* path, u32* width, u32* height);
+
+        u32 minWidth = 0;
+        u32 minHeight = 0;
+
+        // Uses the fast integer IDCT, which is less accurate.
+        bool fastDct = false;
+
     private:
         void* turboDecompressor;
     };
 
+    // Chroma subsampling of encoded jpegs.
+    enum class ChromaSubsampling {
+        YUV444,
+        YUV422,
+        YUV420,
+        GRAY,
+    };
+
     // libjpegturbo writer
     //
     // This writer uses the libjpegturbo library to encode png images.
@@ -78,12 +116,62 @@ namespace pixl {
         JpegTurboWriter();
         ~JpegTurboWriter();
         void write(Image* image, const char* path);
+
+        // Encodes the image in memory and stores the jpeg in out.
+        void encode(Image* image, std::vector<u8>& out);
+
         i32 quality = 75;
+        ChromaSubsampling subsampling = ChromaSubsampling::YUV444;
+
+        // Uses the fast integer FDCT, which is less accurate.
+        bool fastDct = false;
 
     private:
         void* turboCompressor;
     };
 
+    // libjpegturbo writer with a size or similarity budget.
+    //
+    // Searches for the quality that meets the budget instead of using a fixed one:
+    // - maxBytes: the highest quality whose encoding is no larger than maxBytes.
+    // - minSsim: the lowest quality whose decoded result has at least the given SSIM compared
+    //   to the source.
+    // If both are set, the size budget wins. Trial encodes run in parallel and the search
+    // starts around a guess taken from a small sample of the image.
+    class JpegTargetWriter : public ImageWriter {
+    public:
+        void write(Image* image, const char* path);
+
+        // Encodes the image in memory and stores the jpeg in out.
+        void encode(Image* image, std::vector<u8>& out);
+
+        u64 maxBytes = 0;
+        f32 minSsim = 0;
+        i32 minQuality = 5;
+        i32 maxQuality = 95;
+
+        // The quality picked by the last encode
+        i32 quality = -1;
+    };
+
+    // libjpeg requantizer.
+    //
+    // Lowers the quality of a jpeg without a pixel round-trip: the DCT coefficients are read,
+    // requantized to the tables of the target quality and entropy coded again. This skips
+    // IDCT, color conversion and FDCT, and avoids the generational loss of decoding and
+    // encoding again. Jpegs already at or below the target quality are passed through.
+    class JpegRequantizer {
+    public:
+        // Requantizes the jpeg at input and writes the result to output.
+        void requantize(const char* input, const char* output);
+
+        // Requantizes a jpeg in memory and stores the length of the result in outLength.
+        // The caller is responsible for freeing the returned buffer with free().
+        u8* requantize(const u8* data, u64 length, u64* outLength);
+
+        i32 quality = 75;
+    };
+
 
     // Reads a file in binary mode.
     //
@@ -100,12 +188,35 @@ namespace pixl {
     // This function internally picks an appropriate image decoder.
     Image* read(const char* path);
 
+    // Convenience function for decoding an image that is going to be shrunk to at least
+    // width x height.
+    //
+    // The decoder may take shortcuts as long as the returned image is not smaller than that,
+    // e.g. by using the thumbnail embedded in a jpeg or decoding a DCT scaled version.
+    Image* read(const char* path, u32 minWidth, u32 minHeight);
+
     // Convenience function for encoding an image.
     //
     // This function internally picks an appropriate image encoder.
     // The file extension of the path parameter determines wich image encoder
     // should be used.
     void write(Image* image, const char* path, i32 quality = 75);
+
+    // Estimates the quality (1-100) a jpeg has been encoded with.
+    //
+    // The quantization tables (DQT segments) are parsed directly from the compressed data and
+    // matched against the tables libjpeg would produce for each quality, so nothing gets
+    // decoded. Returns -1 if the data is not a jpeg or has no quantization tables.
+    i32 jpeg_estimate_quality(const u8* data, u64 length);
+
+    // Convenience function for estimating the quality of a jpeg file.
+    i32 jpeg_estimate_quality(const char* path);
+
+    // Finds the thumbnail embedded in the exif data (APP1 segment) of a jpeg.
+    //
+    // Returns a pointer to the compressed thumbnail inside data and stores its length in
+    // thumbLength, or returns a nullptr if there is none.
+    const u8* jpeg_exif_thumbnail(const u8* data, u64 length, u64* thumbLength);
 }
 
 #endif
\ No newline at end of file
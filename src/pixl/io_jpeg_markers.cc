@@ -0,0 +1,300 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+
+#include "io.h"
+#include "types.h"
+
+// Jpeg markers
+#define JPEG_MARKER_SOI 0xD8
+#define JPEG_MARKER_EOI 0xD9
+#define JPEG_MARKER_SOS 0xDA
+#define JPEG_MARKER_DQT 0xDB
+#define JPEG_MARKER_APP1 0xE1
+#define JPEG_MARKER_TEM 0x01
+#define JPEG_MARKER_RST0 0xD0
+#define JPEG_MARKER_RST7 0xD7
+
+// Exif tags
+#define EXIF_TAG_THUMBNAIL_OFFSET 0x0201
+#define EXIF_TAG_THUMBNAIL_LENGTH 0x0202
+
+namespace pixl {
+
+    // Maps the zigzag order of the DQT segment to the natural (row major) order.
+    static const u8 JPEG_NATURAL_ORDER[64] = {
+        0,  1,  8,  16, 9,  2,  3,  10, 17, 24, 32, 25, 18, 11, 4,  5,
+        12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6,  7,  14, 21, 28,
+        35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+        58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+    };
+
+    // Luminance quantization table of the jpeg spec (Annex K), used by IJG at quality 50.
+    static const u16 JPEG_STD_LUMINANCE[64] = {
+        16, 11, 10, 16, 24,  40,  51,  61,  12, 12, 14, 19, 26,  58,  60,  55,
+        14, 13, 16, 24, 40,  57,  69,  56,  14, 17, 22, 29, 51,  87,  80,  62,
+        18, 22, 37, 56, 68,  109, 103, 77,  24, 35, 55, 64, 81,  104, 113, 92,
+        49, 64, 78, 87, 103, 121, 120, 101, 72, 92, 95, 98, 112, 100, 103, 99,
+    };
+
+    // Chrominance quantization table of the jpeg spec (Annex K), used by IJG at quality 50.
+    static const u16 JPEG_STD_CHROMINANCE[64] = {
+        17, 18, 24, 47, 99, 99, 99, 99, 18, 21, 26, 66, 99, 99, 99, 99,
+        24, 26, 56, 99, 99, 99, 99, 99, 47, 66, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+    };
+
+    // Quantization table as found in a DQT segment, stored in natural order.
+    struct QuantTable {
+        u16 values[64];
+        bool baseline = true;
+        bool present = false;
+    };
+
+    // Called for every marker segment with the segment payload (without the length field).
+    // Returns false to stop walking the segments.
+    typedef std::function<bool(u8 marker, const u8* payload, u64 length)> SegmentVisitor;
+
+    // ----------------------------------------------------------------------------
+    // Walks all marker segments in front of the first scan.
+    // Returns false if the data does not look like a jpeg.
+    static bool visitSegments(const u8* data, u64 length, SegmentVisitor visitor) {
+        if (length < 4 || data[0] != 0xFF || data[1] != JPEG_MARKER_SOI)
+            return false;
+
+        u64 pos = 2;
+        while (pos + 4 <= length) {
+            if (data[pos] != 0xFF)
+                return false;
+
+            // skip fill bytes
+            while (pos < length && data[pos] == 0xFF)
+                pos++;
+            if (pos >= length)
+                break;
+
+            const u8 marker = data[pos++];
+            if (marker == JPEG_MARKER_SOS || marker == JPEG_MARKER_EOI)
+                break;
+            if (marker == JPEG_MARKER_TEM ||
+                (marker >= JPEG_MARKER_RST0 && marker <= JPEG_MARKER_RST7)) {
+                continue;
+            }
+
+            // every other marker is followed by a segment with a 2 byte length
+            if (pos + 2 > length)
+                break;
+            const u64 segmentLength = (data[pos] << 8) | data[pos + 1];
+            const u64 segmentEnd = pos + segmentLength;
+            if (segmentLength < 2 || segmentEnd > length)
+                return false;
+
+            if (!visitor(marker, data + pos + 2, segmentLength - 2))
+                break;
+
+            pos = segmentEnd;
+        }
+
+        return true;
+    }
+
+    // ----------------------------------------------------------------------------
+    // Parses all DQT segments in front of the first scan.
+    // Returns false if the data does not look like a jpeg or a table is broken.
+    static bool parseQuantTables(const u8* data, u64 length, QuantTable tables[4]) {
+        bool valid = true;
+        bool jpeg = visitSegments(data, length, [&](u8 marker, const u8* payload, u64 size) {
+            if (marker != JPEG_MARKER_DQT)
+                return true;
+
+            // a DQT segment may contain more than one table
+            u64 p = 0;
+            while (p < size) {
+                const u8 precision = payload[p] >> 4;
+                const u8 id = payload[p] & 0x0F;
+                const u64 tableSize = precision ? 128 : 64;
+                p++;
+                if (id > 3 || p + tableSize > size) {
+                    valid = false;
+                    return false;
+                }
+
+                QuantTable& table = tables[id];
+                for (u32 k = 0; k < 64; k++) {
+                    u16 value = precision ? ((payload[p + 2 * k] << 8) | payload[p + 2 * k + 1])
+                                          : payload[p + k];
+                    table.values[JPEG_NATURAL_ORDER[k]] = value;
+                }
+                table.baseline = (precision == 0);
+                table.present = true;
+                p += tableSize;
+            }
+            return true;
+        });
+
+        return jpeg && valid;
+    }
+
+    // ----------------------------------------------------------------------------
+    // Sums the absolute difference between a table and the IJG table of the given quality.
+    static u64 quantTableError(const QuantTable& table, const u16* basicTable, i32 quality) {
+        // same scaling as jpeg_quality_scaling() & jpeg_add_quant_table() in libjpeg
+        const i64 scale = (quality < 50) ? (5000 / quality) : (200 - quality * 2);
+        const i64 max = table.baseline ? 255 : 32767;
+
+        u64 error = 0;
+        for (u32 i = 0; i < 64; i++) {
+            i64 expected = (basicTable[i] * scale + 50) / 100;
+            expected = std::max((i64)1, std::min(expected, max));
+            error += std::abs(expected - (i64)table.values[i]);
+        }
+        return error;
+    }
+
+    // ----------------------------------------------------------------------------
+    i32 jpeg_estimate_quality(const u8* data, u64 length) {
+        QuantTable tables[4];
+        if (!parseQuantTables(data, length, tables) || !tables[0].present)
+            return -1;
+
+        // Find the IJG quality whose tables are the closest match. Lower qualities saturate
+        // at 255, so on a tie the highest quality wins.
+        i32 bestQuality = -1;
+        u64 bestError = std::numeric_limits<u64>::max();
+        for (i32 quality = 1; quality <= 100; quality++) {
+            u64 error = quantTableError(tables[0], JPEG_STD_LUMINANCE, quality);
+            if (tables[1].present) {
+                error += quantTableError(tables[1], JPEG_STD_CHROMINANCE, quality);
+            }
+
+            if (error <= bestError) {
+                bestError = error;
+                bestQuality = quality;
+            }
+        }
+
+        return bestQuality;
+    }
+
+    // ----------------------------------------------------------------------------
+    i32 jpeg_estimate_quality(const char* path) {
+        u64 length;
+        u8* data = read_binary(path, &length);
+        if (data == nullptr)
+            return -1;
+
+        i32 quality = jpeg_estimate_quality(data, length);
+        delete[] data;
+        return quality;
+    }
+
+    // Reads 16 and 32 bit values of a tiff structure with the given byte order.
+    struct TiffReader {
+        const u8* data;
+        u64 length;
+        bool bigEndian;
+
+        bool u16At(u64 offset, u32* out) const {
+            if (offset + 2 > length)
+                return false;
+            const u8* p = data + offset;
+            *out = bigEndian ? (p[0] << 8) | p[1] : (p[1] << 8) | p[0];
+            return true;
+        }
+
+        bool u32At(u64 offset, u32* out) const {
+            if (offset + 4 > length)
+                return false;
+            const u8* p = data + offset;
+            *out = bigEndian ? ((u32)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]
+                             : ((u32)p[3] << 24) | (p[2] << 16) | (p[1] << 8) | p[0];
+            return true;
+        }
+    };
+
+    // ----------------------------------------------------------------------------
+    // Looks for the thumbnail in IFD1 of a tiff structure, which is where exif keeps it.
+    static bool findTiffThumbnail(const TiffReader& tiff, u64* offset, u64* length) {
+        u32 ifd0, entries, ifd1;
+        if (!tiff.u32At(4, &ifd0) || !tiff.u16At(ifd0, &entries))
+            return false;
+        if (!tiff.u32At(ifd0 + 2 + entries * 12, &ifd1) || ifd1 == 0)
+            return false;
+        if (!tiff.u16At(ifd1, &entries))
+            return false;
+
+        u32 thumbOffset = 0, thumbLength = 0;
+        for (u32 i = 0; i < entries; i++) {
+            const u64 entry = ifd1 + 2 + i * 12;
+            u32 tag;
+            if (!tiff.u16At(entry, &tag))
+                return false;
+            if (tag == EXIF_TAG_THUMBNAIL_OFFSET) {
+                tiff.u32At(entry + 8, &thumbOffset);
+            } else if (tag == EXIF_TAG_THUMBNAIL_LENGTH) {
+                tiff.u32At(entry + 8, &thumbLength);
+            }
+        }
+
+        if (thumbOffset == 0 || thumbLength < 4 || (u64)thumbOffset + thumbLength > tiff.length)
+            return false;
+
+        // must be a jpeg as well
+        const u8* thumb = tiff.data + thumbOffset;
+        if (thumb[0] != 0xFF || thumb[1] != JPEG_MARKER_SOI)
+            return false;
+
+        *offset = thumbOffset;
+        *length = thumbLength;
+        return true;
+    }
+
+    // ----------------------------------------------------------------------------
+    const u8* jpeg_exif_thumbnail(const u8* data, u64 length, u64* thumbLength) {
+        const u8* thumb = nullptr;
+        visitSegments(data, length, [&](u8 marker, const u8* payload, u64 size) {
+            if (marker != JPEG_MARKER_APP1 || size < 14 || memcmp(payload, "Exif\0\0", 6) != 0)
+                return true;
+
+            // the tiff structure follows the exif header
+            TiffReader tiff;
+            tiff.data = payload + 6;
+            tiff.length = size - 6;
+            if (memcmp(tiff.data, "MM\0*", 4) == 0) {
+                tiff.bigEndian = true;
+            } else if (memcmp(tiff.data, "II*\0", 4) == 0) {
+                tiff.bigEndian = false;
+            } else {
+                return true;
+            }
+
+            u64 offset;
+            if (findTiffThumbnail(tiff, &offset, thumbLength)) {
+                thumb = tiff.data + offset;
+                return false;
+            }
+            return true;
+        });
+
+        return thumb;
+    }
+}
@@ -0,0 +1,233 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <vector>
+
+#include "io.h"
+#include "image.h"
+#include "operations.h"
+#include "threads.h"
+#include "types.h"
+
+// Size of the blocks sampled for the initial guess & the distance between them
+#define SAMPLE_BLOCK 16
+#define SAMPLE_CELL 64
+
+// Qualities tried per round of the search. Fixed, so the result doesn't depend on the number
+// of threads.
+#define SEARCH_PROBES 4
+
+// Rough size of a jpeg without any image data (markers, tables)
+#define JPEG_HEADER_SIZE 600
+
+namespace pixl {
+
+    // A single trial encode.
+    struct JpegTrial {
+        std::vector<u8> data;
+        f64 ssim = 1;
+    };
+
+    typedef std::map<i32, JpegTrial> JpegTrials;
+
+    // ----------------------------------------------------------------------------
+    // Encodes the image with all given qualities in parallel. Qualities that have already been
+    // tried are skipped.
+    static void runTrials(Image* image,
+                          const std::vector<i32>& qualities,
+                          bool measureSsim,
+                          JpegTrials& trials) {
+        std::vector<i32> todo;
+        std::vector<JpegTrial*> todoTrials;
+        for (auto q : qualities) {
+            if (trials.find(q) == trials.end()) {
+                todo.push_back(q);
+                todoTrials.push_back(&trials[q]);
+            }
+        }
+
+        parallel_for(0, todo.size(), 1, [&](i64 from, i64 to) {
+            for (i64 i = from; i < to; i++) {
+                JpegTrial* trial = todoTrials[i];
+                JpegTurboWriter writer;
+                writer.quality = todo[i];
+                writer.encode(image, trial->data);
+
+                if (measureSsim) {
+                    JpegTurboReader reader;
+                    Image* decoded = reader.decode(trial->data.data(), trial->data.size());
+                    trial->ssim = decoded ? op::ssim(image, decoded) : -1;
+                    delete decoded;
+                }
+            }
+        });
+    }
+
+    // ----------------------------------------------------------------------------
+    // Finds the highest quality in [lo, hi] that passes, given that all qualities below it
+    // pass as well. Every round tries 'probes' qualities in parallel, the first one around
+    // the guess. Returns lo - 1 if no quality passes.
+    static i32 searchQuality(i32 lo,
+                             i32 hi,
+                             i32 guess,
+                             i32 probes,
+                             std::function<void(const std::vector<i32>&)> evaluate,
+                             std::function<bool(i32)> pass) {
+        i32 lastPass = lo - 1;
+        i32 firstFail = hi + 1;
+
+        // first round: narrow bracket around the guess
+        std::vector<i32> qualities;
+        for (i32 i = 0; i < probes; i++) {
+            qualities.push_back(clamp(guess + (i - probes / 2) * 2, lo, hi));
+        }
+
+        while (!qualities.empty()) {
+            evaluate(qualities);
+            for (auto q : qualities) {
+                if (pass(q)) {
+                    lastPass = std::max(lastPass, q);
+                } else {
+                    firstFail = std::min(firstFail, q);
+                }
+            }
+            // in case of non-monotonic results trust the failures
+            lastPass = std::min(lastPass, firstFail - 1);
+
+            // next round: spread the probes evenly between the two bounds
+            qualities.clear();
+            const i32 gap = firstFail - lastPass;
+            for (i32 i = 1; i <= probes && gap > 1; i++) {
+                i32 q = lastPass + (gap * i) / (probes + 1);
+                if (q > lastPass && q < firstFail &&
+                    std::find(qualities.begin(), qualities.end(), q) == qualities.end()) {
+                    qualities.push_back(q);
+                }
+            }
+        }
+
+        return lastPass;
+    }
+
+    // ----------------------------------------------------------------------------
+    // Creates a mosaic of blocks sampled all over the image. Jpeg compresses blocks more or
+    // less independently, so the mosaic has about the same bits per pixel and SSIM as the
+    // image. Returns a nullptr if the image is too small to be worth it.
+    static Image* sampleMosaic(const Image* image) {
+        const i32 columns = image->width / SAMPLE_CELL;
+        const i32 rows = image->height / SAMPLE_CELL;
+        if (columns < 4 || rows < 4)
+            return nullptr;
+
+        const i32 channels = image->channels;
+        Image* mosaic = new Image(columns * SAMPLE_BLOCK, rows * SAMPLE_BLOCK, channels);
+        const i32 offset = (SAMPLE_CELL - SAMPLE_BLOCK) / 2;
+        for (i32 row = 0; row < rows; row++) {
+            for (i32 column = 0; column < columns; column++) {
+                for (i32 y = 0; y < SAMPLE_BLOCK; y++) {
+                    const u8* src = image->getPixel(column * SAMPLE_CELL + offset,
+                                                    row * SAMPLE_CELL + offset + y);
+                    u8* dst = mosaic->getPixel(column * SAMPLE_BLOCK, row * SAMPLE_BLOCK + y);
+                    memcpy(dst, src, SAMPLE_BLOCK * channels);
+                }
+            }
+        }
+
+        return mosaic;
+    }
+
+    // ----------------------------------------------------------------------------
+    void JpegTargetWriter::encode(Image* image, std::vector<u8>& out) {
+        const i32 lo = clamp(this->minQuality, 1, 100);
+        const i32 hi = clamp(this->maxQuality, lo, 100);
+        const i32 probes = SEARCH_PROBES;
+        const bool sizeBudget = this->maxBytes > 0;
+        const bool ssimBudget = this->minSsim > 0;
+
+        // strip the alpha channel once instead of in every trial
+        Image* img = image;
+        if (image->channels > 3) {
+            img = new Image(image);
+            img->removeAlphaChannel();
+        }
+
+        // initial guesses from a sample of the image
+        i32 sizeGuess = (lo + hi) / 2;
+        i32 ssimGuess = (lo + hi) / 2;
+        Image* mosaic = sampleMosaic(img);
+        if (mosaic != nullptr) {
+            JpegTrials trials;
+            auto evaluate = [&](const std::vector<i32>& qualities) {
+                runTrials(mosaic, qualities, ssimBudget, trials);
+            };
+
+            if (sizeBudget) {
+                const f64 ratio = (f64)mosaic->width * mosaic->height / (img->width * img->height);
+                const f64 budget =
+                    std::max(0.0, (f64)this->maxBytes - JPEG_HEADER_SIZE) * ratio + JPEG_HEADER_SIZE;
+                sizeGuess = searchQuality(lo, hi, sizeGuess, probes, evaluate, [&](i32 q) {
+                    return trials[q].data.size() <= budget;
+                });
+            }
+            if (ssimBudget) {
+                ssimGuess = 1 + searchQuality(lo, hi, ssimGuess, probes, evaluate, [&](i32 q) {
+                    return trials[q].ssim < this->minSsim;
+                });
+            }
+            delete mosaic;
+        }
+
+        // search on the full image
+        JpegTrials trials;
+        auto evaluate = [&](const std::vector<i32>& qualities) {
+            runTrials(img, qualities, ssimBudget, trials);
+        };
+
+        i32 quality = hi;
+        if (ssimBudget) {
+            quality = 1 + searchQuality(lo, hi, ssimGuess, probes, evaluate, [&](i32 q) {
+                return trials[q].ssim < this->minSsim;
+            });
+            quality = std::min(quality, hi);
+        }
+        if (sizeBudget) {
+            i32 largest = searchQuality(lo, hi, sizeGuess, probes, evaluate, [&](i32 q) {
+                return trials[q].data.size() <= this->maxBytes;
+            });
+            // if even the lowest quality is too big, that's the best we can do
+            quality = std::min(quality, std::max(largest, lo));
+        }
+
+        runTrials(img, {quality}, false, trials);
+        out.swap(trials[quality].data);
+        this->quality = quality;
+
+        if (img != image) {
+            delete img;
+        }
+    }
+
+    // ----------------------------------------------------------------------------
+    void JpegTargetWriter::write(Image* image, const char* path) {
+        std::vector<u8> buffer;
+        encode(image, buffer);
+        write_binary(path, buffer.data(), buffer.size());
+    }
+}
@@ -0,0 +1,191 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <csetjmp>
+#include <jpeglib.h>
+
+#include "io.h"
+#include "types.h"
+#include "errors.h"
+
+namespace pixl {
+
+    // libjpeg calls exit() on errors by default, so we jump back and throw instead.
+    struct JpegErrorManager {
+        jpeg_error_mgr pub;
+        jmp_buf jump;
+        char message[JMSG_LENGTH_MAX];
+    };
+
+    // ----------------------------------------------------------------------------
+    static void onJpegError(j_common_ptr cinfo) {
+        auto err = (JpegErrorManager*)cinfo->err;
+        (*cinfo->err->format_message)(cinfo, err->message);
+        longjmp(err->jump, 1);
+    }
+
+    // ----------------------------------------------------------------------------
+    static void onJpegMessage(j_common_ptr) {
+        // swallow warnings
+    }
+
+    // ----------------------------------------------------------------------------
+    // Checks if a saved marker is one libjpeg writes on its own.
+    static bool isGeneratedMarker(j_compress_ptr dst, jpeg_saved_marker_ptr marker) {
+        if (dst->write_JFIF_header && marker->marker == JPEG_APP0 && marker->data_length >= 5 &&
+            memcmp(marker->data, "JFIF", 5) == 0) {
+            return true;
+        }
+        if (dst->write_Adobe_marker && marker->marker == JPEG_APP0 + 14 &&
+            marker->data_length >= 5 && memcmp(marker->data, "Adobe", 5) == 0) {
+            return true;
+        }
+        return false;
+    }
+
+    // ----------------------------------------------------------------------------
+    // Divides all coefficients of a component by the new quantization table, after
+    // multiplying them with the old one.
+    static void requantizeComponent(j_decompress_ptr src,
+                                    jvirt_barray_ptr coefficients,
+                                    jpeg_component_info* component,
+                                    const JQUANT_TBL* oldTable,
+                                    const JQUANT_TBL* newTable) {
+        if (memcmp(oldTable->quantval, newTable->quantval, sizeof(oldTable->quantval)) == 0)
+            return;
+
+        for (JDIMENSION row = 0; row < component->height_in_blocks; row++) {
+            JBLOCKARRAY blocks = (*src->mem->access_virt_barray)(
+                (j_common_ptr)src, coefficients, row, 1, TRUE);
+
+            for (JDIMENSION col = 0; col < component->width_in_blocks; col++) {
+                JCOEFPTR block = blocks[0][col];
+                for (i32 k = 0; k < DCTSIZE2; k++) {
+                    const i32 value = block[k] * oldTable->quantval[k];
+                    const i32 q = newTable->quantval[k];
+                    block[k] = (value >= 0) ? (value + q / 2) / q : -((-value + q / 2) / q);
+                }
+            }
+        }
+    }
+
+    // ----------------------------------------------------------------------------
+    u8* JpegRequantizer::requantize(const u8* data, u64 length, u64* outLength) {
+        // nothing to gain if the jpeg already is at or below the target quality
+        i32 sourceQuality = jpeg_estimate_quality(data, length);
+        if (sourceQuality != -1 && sourceQuality <= this->quality) {
+            u8* copy = (u8*)malloc(length);
+            memcpy(copy, data, length);
+            *outLength = length;
+            return copy;
+        }
+
+        jpeg_decompress_struct src;
+        jpeg_compress_struct dst;
+        JpegErrorManager err;
+        src.err = jpeg_std_error(&err.pub);
+        dst.err = &err.pub;
+        err.pub.error_exit = onJpegError;
+        err.pub.output_message = onJpegMessage;
+        jpeg_create_decompress(&src);
+        jpeg_create_compress(&dst);
+
+        unsigned char* buffer = nullptr;
+        unsigned long bufferSize = 0;
+
+        if (setjmp(err.jump)) {
+            jpeg_destroy_compress(&dst);
+            jpeg_destroy_decompress(&src);
+            free(buffer);
+            throw PixlException("Failed to requantize jpeg: " + std::string(err.message));
+        }
+
+        // read coefficients & keep all markers (exif, icc profiles, etc.)
+        jpeg_mem_src(&src, data, length);
+        jpeg_save_markers(&src, JPEG_COM, 0xFFFF);
+        for (i32 i = 0; i < 16; i++) {
+            jpeg_save_markers(&src, JPEG_APP0 + i, 0xFFFF);
+        }
+        jpeg_read_header(&src, TRUE);
+        jvirt_barray_ptr* coefficients = jpeg_read_coefficients(&src);
+
+        // Set up the new quantization tables. Coefficients are never quantized finer than
+        // before, that would only add bits without adding quality.
+        jpeg_copy_critical_parameters(&src, &dst);
+        jpeg_set_quality(&dst, this->quality, TRUE);
+        for (i32 i = 0; i < NUM_QUANT_TBLS; i++) {
+            if (src.quant_tbl_ptrs[i] == nullptr || dst.quant_tbl_ptrs[i] == nullptr)
+                continue;
+            for (i32 k = 0; k < DCTSIZE2; k++) {
+                auto& value = dst.quant_tbl_ptrs[i]->quantval[k];
+                value = std::max(value, src.quant_tbl_ptrs[i]->quantval[k]);
+            }
+        }
+        dst.optimize_coding = TRUE;
+
+        // requantize
+        for (i32 ci = 0; ci < src.num_components; ci++) {
+            jpeg_component_info* component = src.comp_info + ci;
+            const JQUANT_TBL* oldTable = component->quant_table;
+            if (oldTable == nullptr) {
+                oldTable = src.quant_tbl_ptrs[component->quant_tbl_no];
+            }
+            const JQUANT_TBL* newTable = dst.quant_tbl_ptrs[dst.comp_info[ci].quant_tbl_no];
+            requantizeComponent(&src, coefficients[ci], component, oldTable, newTable);
+        }
+
+        // entropy code again
+        jpeg_mem_dest(&dst, &buffer, &bufferSize);
+        jpeg_write_coefficients(&dst, coefficients);
+        for (auto marker = src.marker_list; marker != nullptr; marker = marker->next) {
+            if (!isGeneratedMarker(&dst, marker)) {
+                jpeg_write_marker(&dst, marker->marker, marker->data, marker->data_length);
+            }
+        }
+        jpeg_finish_compress(&dst);
+        jpeg_destroy_compress(&dst);
+        jpeg_finish_decompress(&src);
+        jpeg_destroy_decompress(&src);
+
+        *outLength = bufferSize;
+        return buffer;
+    }
+
+    // ----------------------------------------------------------------------------
+    void JpegRequantizer::requantize(const char* input, const char* output) {
+        u64 length;
+        u8* data = read_binary(input, &length);
+        if (data == nullptr)
+            throw PixlException("Failed to read file");
+
+        u64 outLength;
+        u8* out;
+        try {
+            out = requantize(data, length, &outLength);
+        } catch (...) {
+            delete[] data;
+            throw;
+        }
+
+        write_binary(output, out, outLength);
+        free(out);
+        delete[] data;
+    }
+}
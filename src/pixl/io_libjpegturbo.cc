@@ -14,11 +14,15 @@
 // limitations under the License.
 //
 
+#include <cmath>
+#include <vector>
 #include <turbojpeg.h>
 
 #include "io.h"
 #include "types.h"
+#include "context.h"
 #include "image.h"
+#include "numa.h"
 
 namespace pixl {
 
@@ -39,41 +43,116 @@ namespace pixl {
         // read file
         u64 fileSize;
         u8* fileBuffer = read_binary(path, &fileSize);
+        if (fileBuffer == nullptr) {
+            PIXL_ERROR("Error: failed to read " + std::string(path));
+            return nullptr;
+        }
+
+        Image* image = decode(fileBuffer, fileSize);
+        delete[] fileBuffer;
+        return image;
+    }
+
+    // ----------------------------------------------------------------------------
+    bool JpegTurboReader::readSize(const char* path, u32* width, u32* height) {
+        u64 fileSize;
+        u8* fileBuffer = read_binary(path, &fileSize);
+        if (fileBuffer == nullptr)
+            return false;
+
+        int w, h, subsamp;
+        const auto result =
+            tjDecompressHeader2(turboDecompressor, fileBuffer, fileSize, &w, &h, &subsamp);
+        delete[] fileBuffer;
+        if (result == -1)
+            return false;
+
+        *width = w;
+        *height = h;
+        return true;
+    }
+
+    // ----------------------------------------------------------------------------
+    Image* JpegTurboReader::decode(const u8* data, u64 length) {
+        check_cancelled();
 
         // read meta data
         int width, height, subsamp;
-        auto result =
-            tjDecompressHeader2(turboDecompressor, fileBuffer, fileSize, &width, &height, &subsamp);
+        auto result = tjDecompressHeader2(
+            turboDecompressor, (u8*)data, length, &width, &height, &subsamp);
 
         if (result == -1) {
             PIXL_ERROR("Error: " + std::string(tjGetErrorStr()));
-            free(fileBuffer);
             return nullptr;
         }
 
+        // use the exif thumbnail if it is big enough
+        if (this->minWidth > 0 && this->minHeight > 0) {
+            u64 thumbLength;
+            const u8* thumb = jpeg_exif_thumbnail(data, length, &thumbLength);
+            int thumbWidth, thumbHeight, thumbSubsamp;
+            if (thumb != nullptr &&
+                tjDecompressHeader2(turboDecompressor,
+                                    (u8*)thumb,
+                                    thumbLength,
+                                    &thumbWidth,
+                                    &thumbHeight,
+                                    &thumbSubsamp) == 0 &&
+                (u32)thumbWidth >= this->minWidth && (u32)thumbHeight >= this->minHeight) {
+                // thumbnails are sometimes letterboxed to 4:3, those are no good
+                const f32 aspect = width / (f32)height;
+                const f32 thumbAspect = thumbWidth / (f32)thumbHeight;
+                if (std::abs(aspect - thumbAspect) / aspect < 0.02f) {
+                    JpegTurboReader thumbReader;
+                    Image* image = thumbReader.decode(thumb, thumbLength);
+                    if (image != nullptr)
+                        return image;
+                }
+            }
+        }
+
+        // decode at a reduced size (DCT scaling) if that is still big enough
+        if (this->minWidth > 0 && this->minHeight > 0) {
+            int count;
+            tjscalingfactor* factors = tjGetScalingFactors(&count);
+            int scaledWidth = width;
+            int scaledHeight = height;
+            for (int i = 0; i < count; i++) {
+                const tjscalingfactor factor = factors[i];
+                const int w = TJSCALED(width, factor);
+                const int h = TJSCALED(height, factor);
+                if ((u32)w >= this->minWidth && (u32)h >= this->minHeight &&
+                    (u64)w * h < (u64)scaledWidth * scaledHeight) {
+                    scaledWidth = w;
+                    scaledHeight = h;
+                }
+            }
+            width = scaledWidth;
+            height = scaledHeight;
+        }
+
         // create decoded buffer
         int pitch = width * tjPixelSize[TJPF_RGB];
-        u8* data = (u8*)malloc(pitch * height);
+        u8* pixels = (u8*)numa_malloc(pitch * height);
 
         // decode image
         result = tjDecompress2(turboDecompressor,
-                               fileBuffer,
-                               fileSize,
-                               data,
+                               (u8*)data,
+                               length,
+                               pixels,
                                width,
                                pitch,
                                height,
                                TJPF_RGB,
-                               TJFLAG_NOREALLOC);
+                               TJFLAG_NOREALLOC | (this->fastDct ? TJFLAG_FASTDCT : 0));
 
         if (result == -1) {
             PIXL_ERROR("Error: " + std::string(tjGetErrorStr()));
-            free(fileBuffer);
+            free(pixels);
             return nullptr;
         }
 
-        free(fileBuffer);
-        return new Image(width, height, 3, data);
+        return new Image(width, height, 3, pixels);
     }
 
     // ----------------------------------------------------------------------------
@@ -84,6 +163,17 @@ namespace pixl {
 
     // ----------------------------------------------------------------------------
     void JpegTurboWriter::write(Image* image, const char* path) {
+        std::vector<u8> buffer;
+        encode(image, buffer);
+
+        // write to disk
+        write_binary(path, buffer.data(), buffer.size());
+    }
+
+    // ----------------------------------------------------------------------------
+    void JpegTurboWriter::encode(Image* image, std::vector<u8>& out) {
+        check_cancelled();
+
         // create copy of image and remove alpha channel if available
         Image* img = nullptr;
         if(image->channels > 3) {
@@ -95,8 +185,17 @@ namespace pixl {
 
         int pitch = img->width * tjPixelSize[TJPF_RGB];
 
+        int subsampling = TJSAMP_444;
+        if (this->subsampling == ChromaSubsampling::YUV422) {
+            subsampling = TJSAMP_422;
+        } else if (this->subsampling == ChromaSubsampling::YUV420) {
+            subsampling = TJSAMP_420;
+        } else if (this->subsampling == ChromaSubsampling::GRAY) {
+            subsampling = TJSAMP_GRAY;
+        }
+
         // malloc output buffer for the compressed image
-        u64 maxBufferSize = tjBufSize(img->width, img->height, TJSAMP_444);
+        u64 maxBufferSize = tjBufSize(img->width, img->height, subsampling);
         u8* buffer = tjAlloc(maxBufferSize);
         u64 compressedSize;
 
@@ -109,12 +208,11 @@ namespace pixl {
                     TJPF_RGB,
                     &buffer,
                     &compressedSize,
-                    TJSAMP_444,
+                    subsampling,
                     this->quality,
-                    0);
+                    this->fastDct ? TJFLAG_FASTDCT : 0);
 
-        // write to disk
-        write_binary(path, buffer, compressedSize);
+        out.assign(buffer, buffer + compressedSize);
 
         // free buffer allocated by tjAlloc
         tjFree(buffer);
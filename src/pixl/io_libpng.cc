@@ -14,12 +14,18 @@
 // limitations under the License.
 //
 #include <cstdlib>
+#include <algorithm>
+#include <cstring>
+
 #include <png.h>
 
 #include "io.h"
 #include "image.h"
 #include "utils.h"
+#include "context.h"
 #include "errors.h"
+#include "numa.h"
+#include "operations.h"
 
 namespace pixl {
 
@@ -67,25 +73,64 @@ namespace pixl {
         i32 width = png_get_image_width(png_ptr, info_ptr);
         i32 height = png_get_image_height(png_ptr, info_ptr);
         png_byte channels = png_get_channels(png_ptr, info_ptr);
+        const int passes = png_set_interlace_handling(png_ptr);
         png_read_update_info(png_ptr, info_ptr);
 
-        // read file
+        // read file, the progress is created before setjmp so a longjmp doesn't skip it
+        Progress progress((u64)height * passes);
         if (setjmp(png_jmpbuf(png_ptr)))
             throw PixlException("Error during read_image");
 
         png_bytep row_pointers[height];
         u32 rowbytes = png_get_rowbytes(png_ptr, info_ptr);
-        u8* image_data = (u8*)malloc(rowbytes * height);
+        u8* image_data = (u8*)numa_malloc(rowbytes * height);
 
         for (int i = 0; i < height; i++) {
             row_pointers[i] = image_data + i * rowbytes;
         }
 
-        png_read_image(png_ptr, row_pointers);
+        // row by row, to be able to stop in between
+        for (int pass = 0; pass < passes; pass++) {
+            for (int i = 0; i < height; i++) {
+                if (is_cancelled()) {
+                    png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+                    fclose(file);
+                    free(image_data);
+                    throw CancelledException();
+                }
+
+                png_read_row(png_ptr, row_pointers[i], NULL);
+                progress.advance(1);
+            }
+        }
         png_read_end(png_ptr, NULL);
+        png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+        fclose(file);
+
+        Image* image = new Image(width, height, channels, image_data);
+        if (this->stripOpaqueAlpha && op::is_opaque(image)) {
+            op::remove_alpha_channel(image);
+        }
+        return image;
+    }
+
+    // ----------------------------------------------------------------------------
+    bool PngReader::readSize(const char* path, u32* width, u32* height) {
+        FILE* file = fopen(path, "rb");
+        if (!file)
+            return false;
+
+        // signature, then the IHDR chunk: length, type, width & height (big endian)
+        png_byte header[24];
+        const bool valid = fread(header, 1, 24, file) == 24 && !png_sig_cmp(header, 0, 8) &&
+                           memcmp(header + 12, "IHDR", 4) == 0;
         fclose(file);
+        if (!valid)
+            return false;
 
-        return new Image(width, height, channels, image_data);
+        *width = png_get_uint_32(header + 16);
+        *height = png_get_uint_32(header + 20);
+        return true;
     }
 
     // ----------------------------------------------------------------------------
@@ -114,7 +159,12 @@ namespace pixl {
         if (setjmp(png_jmpbuf(png_ptr)))
             throw PixlException("Error during writing header");
 
-        auto color_type = (image->channels == 3) ? PNG_COLOR_TYPE_RGB : PNG_COLOR_TYPE_RGB_ALPHA;
+        // an alpha channel without any transparency is just wasted space
+        const bool stripAlpha =
+            image->channels == 4 && this->stripOpaqueAlpha && op::is_opaque(image);
+
+        auto color_type = (image->channels == 3 || stripAlpha) ? PNG_COLOR_TYPE_RGB
+                                                               : PNG_COLOR_TYPE_RGB_ALPHA;
         png_set_IHDR(png_ptr,
                      info_ptr,
                      image->width,
@@ -124,7 +174,13 @@ namespace pixl {
                      PNG_INTERLACE_NONE,
                      PNG_COMPRESSION_TYPE_DEFAULT,
                      PNG_FILTER_TYPE_DEFAULT);
+        if (this->compressionLevel >= 0) {
+            png_set_compression_level(png_ptr, std::min(this->compressionLevel, 9));
+        }
         png_write_info(png_ptr, info_ptr);
+        if (stripAlpha) {
+            png_set_filler(png_ptr, 0, PNG_FILLER_AFTER);
+        }
 
         // create row pointers
         png_bytep row_pointers[image->height];
@@ -133,10 +189,21 @@ namespace pixl {
             row_pointers[i] = image->data + i * rowbytes;
         }
 
-        // write bytes
+        // write bytes, row by row to be able to stop in between
+        Progress progress(image->height);
         if (setjmp(png_jmpbuf(png_ptr)))
             throw PixlException("Error during writing bytes");
-        png_write_image(png_ptr, row_pointers);
+        for (int i = 0; i < image->height; i++) {
+            if (is_cancelled()) {
+                png_destroy_write_struct(&png_ptr, &info_ptr);
+                fclose(file);
+                remove(path);
+                throw CancelledException();
+            }
+
+            png_write_row(png_ptr, row_pointers[i]);
+            progress.advance(1);
+        }
 
         // end write
         if (setjmp(png_jmpbuf(png_ptr)))
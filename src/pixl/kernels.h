@@ -0,0 +1,99 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef PIXL_KERNELS_H
+#define PIXL_KERNELS_H
+
+#include "cpu.h"
+#include "types.h"
+
+namespace pixl {
+
+    // Inner loops of the operations, compiled once per instruction set (kernels_*.cc). All
+    // variants return the same results to the bit. Rows hold 'pixels' pixels with 'channels'
+    // channels each, an alpha channel (the 4th) is copied. src & dst may be the same row.
+    struct Kernels {
+        void (*invert)(const u8* src, u8* dst, u32 pixels, u32 channels);
+        void (*grayscale)(const u8* src, u8* dst, u32 pixels, u32 channels);
+
+        // The factor is in Q8, see op::contrast_value.
+        void (*contrast)(const u8* src, u8* dst, u32 pixels, u32 channels, i16 factor);
+
+        // Computes 'count' values of a 3x3 convolution from three consecutive input rows,
+        // value i is stored at dst[i] and centered on row1[i + channels].
+        void (*convolution)(const u8* row0,
+                            const u8* row1,
+                            const u8* row2,
+                            u8* dst,
+                            u32 count,
+                            u32 channels,
+                            const f32* kernel,
+                            f32 scale);
+
+        // Copies 3 channel pixels to 4 channel ones with the given alpha value.
+        void (*add_alpha)(const u8* src, u8* dst, u32 pixels, u8 alpha);
+
+        // Copies 4 channel pixels to 3 channel ones. dst may be src, the pixels are compacted.
+        void (*remove_alpha)(const u8* src, u8* dst, u32 pixels);
+
+        // Checks if all alpha values (the last of 2 or 4 channels) of the data are 255.
+        bool (*opaque)(const u8* data, u64 length, u32 channels);
+
+        // Nearest neighbor resize of a row, pixel x is copied from src + columns[x].
+        void (*resize_nearest)(const u8* src,
+                               u8* dst,
+                               const u32* columns,
+                               u32 pixels,
+                               u32 channels);
+
+        // Bilinear resize of a row, see op::resize_bilinear_rows. Pixel x interpolates the
+        // pixels at columns[x] & columns[x] + next of row0 & row1, with weights[x] & weightY in
+        // Q8. 'mid' holds 'length' values, the bytes of an input row.
+        void (*resize_bilinear)(const u8* row0,
+                                const u8* row1,
+                                u8* dst,
+                                u16* mid,
+                                u32 length,
+                                const u32* columns,
+                                const i32* weights,
+                                u32 next,
+                                i32 weightY,
+                                u32 pixels,
+                                u32 channels);
+    };
+
+    // Plain C++ kernels that define the results of all others (kernels_reference.cc).
+    const Kernels* kernels_reference();
+
+    // Kernels of an instruction set, nullptr if they are not compiled in.
+    const Kernels* kernels_sse2();
+    const Kernels* kernels_sse41();
+    const Kernels* kernels_avx2();
+    const Kernels* kernels_avx512();
+
+    // Kernels of an instruction set, nullptr if they are not compiled in or the CPU lacks it.
+    const Kernels* kernels_for(Isa isa);
+
+    // Kernels of cpu_isa(), picked once, or the reference kernels if set_reference_kernels is
+    // on.
+    const Kernels& kernels();
+
+    // The instruction set for a PIXL_CPU value (may be nullptr): the requested one if it's
+    // usable, otherwise the newest usable one below it. Unknown values are ignored.
+    Isa select_isa(const char* requested);
+}
+
+#endif
@@ -0,0 +1,35 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// AVX-512 kernels, the flags are set in CMakeLists.txt.
+
+#include "kernels.h"
+
+#if defined(__AVX512BW__)
+
+#define PIXL_KERNELS_NAMESPACE isa_avx512
+#define PIXL_KERNELS_FUNCTION kernels_avx512
+#include "kernels_impl.h"
+
+#else
+
+namespace pixl {
+
+    // ----------------------------------------------------------------------------
+    const Kernels* kernels_avx512() { return nullptr; }
+}
+
+#endif
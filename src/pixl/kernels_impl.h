@@ -0,0 +1,398 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Body of the kernels_*.cc files, compiled with the flags of an instruction set.
+//
+// PIXL_KERNELS_NAMESPACE must be unique per file: inline functions & templates compiled with
+// different flags must never be merged by the linker, which could otherwise run AVX2 code
+// on an SSE2 machine. For the same reason nothing in here calls inline functions of other
+// headers (std::min, clamp, ...) except simd.h, which is included inside the namespace.
+//
+// Kernels work on LANES values at a time (simd.h) and finish the rest of a row with the same
+// math in plain C++.
+
+#include <cstring>
+
+#include "kernels.h"
+#include "simd.h"
+#include "types.h"
+
+namespace pixl {
+    namespace PIXL_KERNELS_NAMESPACE {
+
+        // Color channels of a pixel, the 4th one is alpha
+        template <u32 C>
+        struct Colors {
+            static const u32 value = C < 3 ? C : 3;
+        };
+
+        // 1 / C in Q16, same as fixed::RECIPROCALS_Q16
+        template <u32 C>
+        struct Reciprocal {
+            static const u32 value = (65536 + C - 1) / C;
+        };
+
+        // ----------------------------------------------------------------------------
+        // LANES bytes that are 'alpha' at the alpha channel of 4 channel pixels and 'color'
+        // everywhere else.
+        static simd::U8 alphaPattern(u32 channels, u8 alpha, u8 color) {
+            u8 pattern[simd::LANES];
+            for (u32 i = 0; i < simd::LANES; i++) {
+                pattern[i] = (channels == 4 && (i & 3) == 3) ? alpha : color;
+            }
+            return simd::load(pattern);
+        }
+
+        // ----------------------------------------------------------------------------
+        static void invert(const u8* src, u8* dst, u32 pixels, u32 channels) {
+            const u64 length = (u64)pixels * channels;
+
+            // x ^ 255 == 255 - x, alpha is xor'ed with 0
+            const simd::U8 mask = alphaPattern(channels, 0, 255);
+            u64 i = 0;
+            for (; i + simd::LANES <= length; i += simd::LANES) {
+                simd::store(dst + i, simd::bit_xor(simd::load(src + i), mask));
+            }
+            for (; i < length; i++) {
+                dst[i] = src[i] ^ ((channels == 4 && (i & 3) == 3) ? 0 : 255);
+            }
+        }
+
+        // ----------------------------------------------------------------------------
+        template <u32 C>
+        static void grayscale(const u8* src, u8* dst, u32 pixels) {
+            for (u32 x = 0; x < pixels; x++) {
+                const u8* in = src + (u64)x * C;
+                u8* out = dst + (u64)x * C;
+
+                // same as fixed::divide
+                u32 sum = 0;
+                for (u32 c = 0; c < Colors<C>::value; c++) {
+                    sum += in[c];
+                }
+                const u8 mean = (u8)((sum * Reciprocal<Colors<C>::value>::value) >> 16);
+
+                if (C == 4) {
+                    out[3] = in[3];
+                }
+                for (u32 c = 0; c < Colors<C>::value; c++) {
+                    out[c] = mean;
+                }
+            }
+        }
+
+        // ----------------------------------------------------------------------------
+        // Same as op::contrast_value, the factor is in Q8.
+        static inline u8 contrastValue(u8 value, i16 factor) {
+            const i32 result = (((i32)value - 128) * factor >> 8) + 128;
+            return (u8)(result < 0 ? 0 : (result > 255 ? 255 : result));
+        }
+
+        // ----------------------------------------------------------------------------
+        static void contrast(const u8* src, u8* dst, u32 pixels, u32 channels, i16 factor) {
+            const u64 length = (u64)pixels * channels;
+            const simd::U8 alpha = alphaPattern(channels, 255, 0);
+            const simd::I16 center = simd::set1_i16(128);
+            const simd::I16 toQ8 = simd::set1_i16(256);
+            const simd::I16 factors = simd::set1_i16(factor);
+
+            // (value - 128) in Q8 fits 16 bits, mulhi then returns the product shifted by 8
+            // bits, rounded down like the tail. Narrowing saturates.
+            u64 i = 0;
+            for (; i + simd::LANES <= length; i += simd::LANES) {
+                const simd::U8 in = simd::load(src + i);
+                const simd::I16 lo = simd::mul(simd::sub(simd::widen_lo(in), center), toQ8);
+                const simd::I16 hi = simd::mul(simd::sub(simd::widen_hi(in), center), toQ8);
+                const simd::U8 result = simd::narrow(simd::add(simd::mulhi(lo, factors), center),
+                                                     simd::add(simd::mulhi(hi, factors), center));
+                simd::store(dst + i, simd::select(alpha, in, result));
+            }
+            for (; i < length; i++) {
+                dst[i] = (channels == 4 && (i & 3) == 3) ? src[i] : contrastValue(src[i], factor);
+            }
+        }
+
+        // ----------------------------------------------------------------------------
+        static void convolution(const u8* row0,
+                                const u8* row1,
+                                const u8* row2,
+                                u8* dst,
+                                u32 count,
+                                u32 channels,
+                                const f32* kernel,
+                                f32 scale) {
+            const u8* rows[3] = {row0, row1, row2};
+            simd::F32 weights[9];
+            for (u32 t = 0; t < 9; t++) {
+                weights[t] = simd::set1_f32(kernel[t]);
+            }
+            const simd::F32 factor = simd::set1_f32(scale);
+            const simd::F32 lower = simd::set1_f32(0.0f);
+            const simd::F32 upper = simd::set1_f32(255.0f);
+
+            u32 i = 0;
+            for (; i + simd::LANES <= count; i += simd::LANES) {
+                // the taps are summed up in the same order as below
+                simd::F32 sums[4];
+                for (u32 t = 0; t < 9; t++) {
+                    const simd::U8 values = simd::load(rows[t / 3] + i + (t % 3) * channels);
+                    const simd::I16 lo = simd::widen_lo(values);
+                    const simd::I16 hi = simd::widen_hi(values);
+                    const simd::F32 quarters[4] = {simd::to_f32_lo(lo), simd::to_f32_hi(lo),
+                                                   simd::to_f32_lo(hi), simd::to_f32_hi(hi)};
+                    for (u32 q = 0; q < 4; q++) {
+                        const simd::F32 product = simd::mul(weights[t], quarters[q]);
+                        sums[q] = t == 0 ? product : simd::add(sums[q], product);
+                    }
+                }
+                for (u32 q = 0; q < 4; q++) {
+                    sums[q] = simd::max(simd::min(simd::mul(sums[q], factor), upper), lower);
+                }
+                simd::store(dst + i, simd::narrow(simd::to_i16(sums[0], sums[1]),
+                                                  simd::to_i16(sums[2], sums[3])));
+            }
+
+            const u32 c1 = channels, c2 = 2 * channels;
+            for (; i < count; i++) {
+                f32 value = kernel[0] * row0[i] + kernel[1] * row0[i + c1] +
+                            kernel[2] * row0[i + c2] + kernel[3] * row1[i] +
+                            kernel[4] * row1[i + c1] + kernel[5] * row1[i + c2] +
+                            kernel[6] * row2[i] + kernel[7] * row2[i + c1] +
+                            kernel[8] * row2[i + c2];
+                value *= scale;
+                value = value > 255.0f ? 255.0f : value;
+                dst[i] = (u8)(value < 0.0f ? 0.0f : value);
+            }
+        }
+
+        // ----------------------------------------------------------------------------
+        static void addAlpha(const u8* src, u8* dst, u32 pixels, u8 alpha) {
+            // 4 pixels per block, the last 4 bytes read belong to the next block
+            static const u8 expand[16] = {0, 1, 2, 0x80, 3, 4, 5, 0x80,
+                                          6, 7, 8, 0x80, 9, 10, 11, 0x80};
+            const u8 alphas[16] = {0, 0, 0, alpha, 0, 0, 0, alpha, 0, 0, 0, alpha, 0, 0, 0, alpha};
+            const simd::Block indices = simd::load_block(expand);
+            const simd::Block alphaBlock = simd::load_block(alphas);
+
+            u32 x = 0;
+            for (; x + 6 <= pixels; x += 4) {
+                const simd::Block in = simd::load_block(src + (u64)x * 3);
+                simd::store_block(dst + (u64)x * 4,
+                                  simd::block_or(simd::shuffle(in, indices), alphaBlock));
+            }
+            for (; x < pixels; x++) {
+                dst[x * 4] = src[x * 3];
+                dst[x * 4 + 1] = src[x * 3 + 1];
+                dst[x * 4 + 2] = src[x * 3 + 2];
+                dst[x * 4 + 3] = alpha;
+            }
+        }
+
+        // ----------------------------------------------------------------------------
+        static void removeAlpha(const u8* src, u8* dst, u32 pixels) {
+            // 4 pixels per block, the last 4 bytes written are overwritten by the next block.
+            // In place, the writes never reach bytes that have not been read yet.
+            static const u8 compact[16] = {0, 1, 2, 4, 5, 6, 8, 9,
+                                           10, 12, 13, 14, 0x80, 0x80, 0x80, 0x80};
+            const simd::Block indices = simd::load_block(compact);
+
+            u32 x = 0;
+            for (; x + 6 <= pixels; x += 4) {
+                const simd::Block in = simd::load_block(src + (u64)x * 4);
+                simd::store_block(dst + (u64)x * 3, simd::shuffle(in, indices));
+            }
+            for (; x < pixels; x++) {
+                dst[x * 3] = src[x * 4];
+                dst[x * 3 + 1] = src[x * 4 + 1];
+                dst[x * 3 + 2] = src[x * 4 + 2];
+            }
+        }
+
+        // ----------------------------------------------------------------------------
+        static bool opaque(const u8* data, u64 length, u32 channels) {
+            // set all color bytes to 255, only opaque pixels end up with 255 in every lane
+            u8 pattern[simd::LANES];
+            for (u32 i = 0; i < simd::LANES; i++) {
+                pattern[i] = (i % channels == channels - 1) ? 0 : 255;
+            }
+            const simd::U8 colors = simd::load(pattern);
+
+            u64 i = 0;
+            for (; i + simd::LANES <= length; i += simd::LANES) {
+                if (!simd::all_set(simd::bit_or(simd::load(data + i), colors)))
+                    return false;
+            }
+            for (i += channels - 1; i < length; i += channels) {
+                if (data[i] != 255)
+                    return false;
+            }
+            return true;
+        }
+
+        // ----------------------------------------------------------------------------
+        // Same as fixed::lerp with a weight in Q8.
+        static inline i32 lerp(i32 a, i32 b, i32 t) {
+            return a * 256 + t * (b - a);
+        }
+
+        // ----------------------------------------------------------------------------
+        template <u32 C>
+        static void resizeNearest(const u8* src, u8* dst, const u32* columns, u32 pixels) {
+            // a gather, which the vectors can't do. Copies of a fixed size are single moves.
+            for (u32 x = 0; x < pixels; x++) {
+                memcpy(dst + (u64)x * C, src + columns[x], C);
+            }
+        }
+
+        // ----------------------------------------------------------------------------
+        // Horizontal step of a bilinear resize, on rows that are already interpolated
+        // vertically (Q8). The result is in Q16 before the shift.
+        template <u32 C>
+        static void resizeColumns(const u16* mid, u8* dst, const u32* columns,
+                                  const i32* weights, u32 next, u32 pixels) {
+            for (u32 x = 0; x < pixels; x++) {
+                const u16* left = mid + columns[x];
+                const u16* right = left + next;
+                u8* pixel = dst + (u64)x * C;
+                for (u32 c = 0; c < C; c++) {
+                    pixel[c] = (u8)(lerp(left[c], right[c], weights[x]) >> 16);
+                }
+            }
+        }
+
+        // ----------------------------------------------------------------------------
+        // Same as op::resize_bilinear_rows. Interpolating vertically first gives the same sum,
+        // the math is exact up to the final shift.
+        static void resizeBilinear(const u8* row0,
+                                   const u8* row1,
+                                   u8* dst,
+                                   u16* mid,
+                                   u32 length,
+                                   const u32* columns,
+                                   const i32* weights,
+                                   u32 next,
+                                   i32 weightY,
+                                   u32 pixels,
+                                   u32 channels) {
+            // strong downscales read only a few of the input values, those are interpolated
+            // right away
+            if (length > 4 * pixels * channels) {
+                for (u32 x = 0; x < pixels; x++) {
+                    const u32 c00 = columns[x];
+                    const u32 c10 = c00 + next;
+                    u8* pixel = dst + (u64)x * channels;
+                    for (u32 i = 0; i < channels; i++) {
+                        const i32 top = lerp(row0[c00 + i], row0[c10 + i], weights[x]);
+                        const i32 bottom = lerp(row1[c00 + i], row1[c10 + i], weights[x]);
+                        pixel[i] = (u8)(lerp(top, bottom, weightY) >> 16);
+                    }
+                }
+                return;
+            }
+
+            // row0 * 256 + weightY * (row1 - row0) is in [0, 65280], wrapping 16 bit math
+            // gets it right
+            const simd::I16 toQ8 = simd::set1_i16(256);
+            const simd::I16 weight = simd::set1_i16((i16)weightY);
+            u32 i = 0;
+            for (; i + simd::LANES <= length; i += simd::LANES) {
+                const simd::U8 top = simd::load(row0 + i);
+                const simd::U8 bottom = simd::load(row1 + i);
+                const simd::I16 topLo = simd::widen_lo(top);
+                const simd::I16 topHi = simd::widen_hi(top);
+                const simd::I16 diffLo = simd::sub(simd::widen_lo(bottom), topLo);
+                const simd::I16 diffHi = simd::sub(simd::widen_hi(bottom), topHi);
+                simd::store_u16(mid + i,
+                                simd::add(simd::mul(topLo, toQ8), simd::mul(diffLo, weight)));
+                simd::store_u16(mid + i + simd::LANES / 2,
+                                simd::add(simd::mul(topHi, toQ8), simd::mul(diffHi, weight)));
+            }
+            for (; i < length; i++) {
+                mid[i] = (u16)lerp(row0[i], row1[i], weightY);
+            }
+
+            switch (channels) {
+                case 1:
+                    resizeColumns<1>(mid, dst, columns, weights, next, pixels);
+                    break;
+                case 2:
+                    resizeColumns<2>(mid, dst, columns, weights, next, pixels);
+                    break;
+                case 3:
+                    resizeColumns<3>(mid, dst, columns, weights, next, pixels);
+                    break;
+                default:
+                    resizeColumns<4>(mid, dst, columns, weights, next, pixels);
+                    break;
+            }
+        }
+
+        // ----------------------------------------------------------------------------
+        static void resizeNearestAny(const u8* src, u8* dst, const u32* columns, u32 pixels,
+                                     u32 channels) {
+            switch (channels) {
+                case 1:
+                    resizeNearest<1>(src, dst, columns, pixels);
+                    break;
+                case 2:
+                    resizeNearest<2>(src, dst, columns, pixels);
+                    break;
+                case 3:
+                    resizeNearest<3>(src, dst, columns, pixels);
+                    break;
+                default:
+                    resizeNearest<4>(src, dst, columns, pixels);
+                    break;
+            }
+        }
+
+        // ----------------------------------------------------------------------------
+        static void grayscaleAny(const u8* src, u8* dst, u32 pixels, u32 channels) {
+            switch (channels) {
+                case 1:
+                    if (src != dst) {
+                        memcpy(dst, src, pixels);
+                    }
+                    break;
+                case 2:
+                    grayscale<2>(src, dst, pixels);
+                    break;
+                case 3:
+                    grayscale<3>(src, dst, pixels);
+                    break;
+                default:
+                    grayscale<4>(src, dst, pixels);
+                    break;
+            }
+        }
+    }
+
+    // ----------------------------------------------------------------------------
+    const Kernels* PIXL_KERNELS_FUNCTION() {
+        static const Kernels table = {
+            PIXL_KERNELS_NAMESPACE::invert,
+            PIXL_KERNELS_NAMESPACE::grayscaleAny,
+            PIXL_KERNELS_NAMESPACE::contrast,
+            PIXL_KERNELS_NAMESPACE::convolution,
+            PIXL_KERNELS_NAMESPACE::addAlpha,
+            PIXL_KERNELS_NAMESPACE::removeAlpha,
+            PIXL_KERNELS_NAMESPACE::opaque,
+            PIXL_KERNELS_NAMESPACE::resizeNearestAny,
+            PIXL_KERNELS_NAMESPACE::resizeBilinear,
+        };
+        return &table;
+    }
+}
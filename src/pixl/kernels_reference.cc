@@ -0,0 +1,176 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Reference kernels: one value at a time in plain C++, written for clarity rather than speed.
+// They define the results all other variants have to match (see set_reference_kernels).
+
+#include <cstring>
+
+#include "fixed.h"
+#include "kernels.h"
+#include "types.h"
+
+namespace pixl {
+    namespace isa_reference {
+
+        // ----------------------------------------------------------------------------
+        static bool isAlpha(u64 index, u32 channels) {
+            return channels == 4 && index % 4 == 3;
+        }
+
+        // ----------------------------------------------------------------------------
+        static u8 clampValue(f32 value) {
+            if (value < 0.0f)
+                return 0;
+            if (value > 255.0f)
+                return 255;
+            return (u8)value;
+        }
+
+        // ----------------------------------------------------------------------------
+        static void invert(const u8* src, u8* dst, u32 pixels, u32 channels) {
+            const u64 length = (u64)pixels * channels;
+            for (u64 i = 0; i < length; i++) {
+                dst[i] = isAlpha(i, channels) ? src[i] : 255 - src[i];
+            }
+        }
+
+        // ----------------------------------------------------------------------------
+        static void grayscale(const u8* src, u8* dst, u32 pixels, u32 channels) {
+            const u32 colors = channels < 3 ? channels : 3;
+            for (u32 x = 0; x < pixels; x++) {
+                const u8* in = src + (u64)x * channels;
+                u8* out = dst + (u64)x * channels;
+
+                f32 mean = 0;
+                for (u32 c = 0; c < colors; c++) {
+                    mean += (f32)in[c];
+                }
+                mean /= colors;
+
+                if (channels == 4) {
+                    out[3] = in[3];
+                }
+                for (u32 c = 0; c < colors; c++) {
+                    out[c] = (u8)mean;
+                }
+            }
+        }
+
+        // ----------------------------------------------------------------------------
+        static void contrast(const u8* src, u8* dst, u32 pixels, u32 channels, i16 factor) {
+            const u64 length = (u64)pixels * channels;
+            for (u64 i = 0; i < length; i++) {
+                dst[i] = isAlpha(i, channels)
+                             ? src[i]
+                             : fixed::saturate_u8(fixed::mul_floor(src[i] - 128, factor, 8) + 128);
+            }
+        }
+
+        // ----------------------------------------------------------------------------
+        static void convolution(const u8* row0,
+                                const u8* row1,
+                                const u8* row2,
+                                u8* dst,
+                                u32 count,
+                                u32 channels,
+                                const f32* kernel,
+                                f32 scale) {
+            const u8* rows[3] = {row0, row1, row2};
+            for (u32 i = 0; i < count; i++) {
+                f32 value = 0;
+                for (u32 t = 0; t < 9; t++) {
+                    value += kernel[t] * rows[t / 3][i + (t % 3) * channels];
+                }
+                dst[i] = clampValue(value * scale);
+            }
+        }
+
+        // ----------------------------------------------------------------------------
+        static void addAlpha(const u8* src, u8* dst, u32 pixels, u8 alpha) {
+            for (u32 x = 0; x < pixels; x++) {
+                memcpy(dst + (u64)x * 4, src + (u64)x * 3, 3);
+                dst[(u64)x * 4 + 3] = alpha;
+            }
+        }
+
+        // ----------------------------------------------------------------------------
+        static void removeAlpha(const u8* src, u8* dst, u32 pixels) {
+            // memmove, in place the pixels overlap
+            for (u32 x = 0; x < pixels; x++) {
+                memmove(dst + (u64)x * 3, src + (u64)x * 4, 3);
+            }
+        }
+
+        // ----------------------------------------------------------------------------
+        static bool opaque(const u8* data, u64 length, u32 channels) {
+            for (u64 i = channels - 1; i < length; i += channels) {
+                if (data[i] != 255)
+                    return false;
+            }
+            return true;
+        }
+
+        // ----------------------------------------------------------------------------
+        static void resizeNearest(const u8* src, u8* dst, const u32* columns, u32 pixels,
+                                  u32 channels) {
+            for (u32 x = 0; x < pixels; x++) {
+                memcpy(dst + (u64)x * channels, src + columns[x], channels);
+            }
+        }
+
+        // ----------------------------------------------------------------------------
+        static void resizeBilinear(const u8* row0,
+                                   const u8* row1,
+                                   u8* dst,
+                                   u16*,
+                                   u32,
+                                   const u32* columns,
+                                   const i32* weights,
+                                   u32 next,
+                                   i32 weightY,
+                                   u32 pixels,
+                                   u32 channels) {
+            for (u32 x = 0; x < pixels; x++) {
+                const u32 c00 = columns[x];
+                const u32 c10 = c00 + next;
+                u8* pixel = dst + (u64)x * channels;
+                for (u32 i = 0; i < channels; i++) {
+                    // Q8 horizontally, Q16 after the vertical step
+                    const i32 top = fixed::lerp(row0[c00 + i], row0[c10 + i], weights[x], 8);
+                    const i32 bottom = fixed::lerp(row1[c00 + i], row1[c10 + i], weights[x], 8);
+                    pixel[i] = (u8)(fixed::lerp(top, bottom, weightY, 8) >> 16);
+                }
+            }
+        }
+    }
+
+    // ----------------------------------------------------------------------------
+    const Kernels* kernels_reference() {
+        static const Kernels table = {
+            isa_reference::invert,
+            isa_reference::grayscale,
+            isa_reference::contrast,
+            isa_reference::convolution,
+            isa_reference::addAlpha,
+            isa_reference::removeAlpha,
+            isa_reference::opaque,
+            isa_reference::resizeNearest,
+            isa_reference::resizeBilinear,
+        };
+        return &table;
+    }
+}
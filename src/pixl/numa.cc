@@ -0,0 +1,233 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "numa.h"
+#include "types.h"
+
+// from linux/mempolicy.h
+#define PIXL_MPOL_PREFERRED 1
+#define PIXL_MPOL_F_NODE 1
+#define PIXL_MPOL_F_ADDR 2
+
+// nodes above are treated like node 0
+#define PIXL_MAX_NODES 64
+
+namespace pixl {
+
+    struct NodeCounters {
+        std::atomic<i32> workers;
+        std::atomic<u64> tasks;
+        std::atomic<u64> remoteTasks;
+        std::atomic<u64> bytes;
+    };
+
+    static NodeCounters counters[PIXL_MAX_NODES];
+
+    // Node id of every CPU
+    static std::vector<u32> cpuNodes;
+
+    static thread_local i32 scopeNode = -1;
+
+    // ----------------------------------------------------------------------------
+    // Parses a list like "0-3,8,10-11".
+    static std::vector<u32> parseList(const std::string& list) {
+        std::vector<u32> result;
+        const char* c = list.c_str();
+        while (*c != '\0' && *c != '\n') {
+            char* end;
+            const u32 from = (u32)strtoul(c, &end, 10);
+            if (end == c)
+                break;
+            u32 to = from;
+            c = end;
+            if (*c == '-') {
+                to = (u32)strtoul(c + 1, &end, 10);
+                c = end;
+            }
+            for (u32 i = from; i <= to; i++) {
+                result.push_back(i);
+            }
+            if (*c == ',') {
+                c++;
+            }
+        }
+        return result;
+    }
+
+    // ----------------------------------------------------------------------------
+    static std::string readLine(const std::string& path) {
+        char buffer[4096] = {0};
+        FILE* file = fopen(path.c_str(), "r");
+        if (file == nullptr)
+            return "";
+        if (fgets(buffer, sizeof(buffer), file) == nullptr) {
+            buffer[0] = '\0';
+        }
+        fclose(file);
+        return buffer;
+    }
+
+    // ----------------------------------------------------------------------------
+    static u32 validNode(u32 node) {
+        return node < PIXL_MAX_NODES ? node : 0;
+    }
+
+    // ----------------------------------------------------------------------------
+    const std::vector<u32>& numa_nodes() {
+        static const std::vector<u32> nodes = []() {
+            std::vector<u32> nodes;
+            for (u32 node : parseList(readLine("/sys/devices/system/node/has_cpu"))) {
+                if (node < PIXL_MAX_NODES) {
+                    nodes.push_back(node);
+                }
+            }
+            if (nodes.empty()) {
+                nodes.push_back(0);
+            }
+
+            for (u32 node : nodes) {
+                for (u32 cpu : numa_cpus(node)) {
+                    if (cpu >= cpuNodes.size()) {
+                        cpuNodes.resize(cpu + 1, 0);
+                    }
+                    cpuNodes[cpu] = node;
+                }
+            }
+            return nodes;
+        }();
+        return nodes;
+    }
+
+    // ----------------------------------------------------------------------------
+    std::vector<u32> numa_cpus(u32 node) {
+        auto cpus = parseList(readLine("/sys/devices/system/node/node" + std::to_string(node) +
+                                       "/cpulist"));
+        if (cpus.empty() && node == 0) {
+            // no NUMA information, all CPUs are on node 0
+            for (u32 i = 0; i < std::max(std::thread::hardware_concurrency(), 1u); i++) {
+                cpus.push_back(i);
+            }
+        }
+        return cpus;
+    }
+
+    // ----------------------------------------------------------------------------
+    u32 numa_current_node() {
+        if (numa_nodes().size() < 2)
+            return 0;
+
+        const int cpu = sched_getcpu();
+        if (cpu < 0 || (u32)cpu >= cpuNodes.size())
+            return 0;
+        return cpuNodes[cpu];
+    }
+
+    // ----------------------------------------------------------------------------
+    i32 numa_node_of(const void* address) {
+        if (numa_nodes().size() < 2)
+            return 0;
+
+        int node = -1;
+        if (syscall(SYS_get_mempolicy, &node, nullptr, 0, address,
+                    PIXL_MPOL_F_NODE | PIXL_MPOL_F_ADDR) != 0)
+            return -1;
+        return node;
+    }
+
+    // ----------------------------------------------------------------------------
+    void numa_place(void* data, u64 size, i32 node) {
+        const u32 target = validNode(node >= 0 ? (u32)node : numa_current_node());
+        counters[target].bytes += size;
+        if (numa_nodes().size() < 2 || data == nullptr)
+            return;
+
+        // only whole pages can be bound
+        const u64 page = (u64)sysconf(_SC_PAGESIZE);
+        const u64 begin = ((u64)data + page - 1) / page * page;
+        const u64 end = ((u64)data + size) / page * page;
+        if (end <= begin)
+            return;
+
+        unsigned long mask = 1ul << target;
+        syscall(SYS_mbind, (void*)begin, end - begin, PIXL_MPOL_PREFERRED, &mask,
+                PIXL_MAX_NODES + 1, 0);
+    }
+
+    // ----------------------------------------------------------------------------
+    void* numa_malloc(u64 size, i32 node) {
+        void* data = malloc(size);
+        numa_place(data, size, node);
+        return data;
+    }
+
+    // ----------------------------------------------------------------------------
+    u32 numa_preferred_node() {
+        return scopeNode >= 0 ? (u32)scopeNode : numa_current_node();
+    }
+
+    // ----------------------------------------------------------------------------
+    NumaScope::NumaScope(i32 node) : previous(scopeNode) {
+        if (node >= 0) {
+            scopeNode = node;
+        }
+    }
+
+    // ----------------------------------------------------------------------------
+    NumaScope::~NumaScope() {
+        scopeNode = this->previous;
+    }
+
+    // ----------------------------------------------------------------------------
+    std::vector<NumaNodeStats> numa_stats() {
+        std::vector<NumaNodeStats> stats;
+        for (u32 node : numa_nodes()) {
+            NumaNodeStats entry;
+            entry.node = node;
+            entry.cpus = (u32)numa_cpus(node).size();
+            entry.workers = (u32)std::max((i32)counters[node].workers, 0);
+            entry.tasks = counters[node].tasks;
+            entry.remoteTasks = counters[node].remoteTasks;
+            entry.bytes = counters[node].bytes;
+            stats.push_back(entry);
+        }
+        return stats;
+    }
+
+    // ----------------------------------------------------------------------------
+    void numa_count_workers(u32 node, i32 count) {
+        counters[validNode(node)].workers += count;
+    }
+
+    // ----------------------------------------------------------------------------
+    void numa_count_task(u32 node, bool remote) {
+        counters[validNode(node)].tasks++;
+        if (remote) {
+            counters[validNode(node)].remoteTasks++;
+        }
+    }
+}
@@ -0,0 +1,88 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef PIXL_NUMA_H
+#define PIXL_NUMA_H
+
+#include <vector>
+
+#include "types.h"
+
+namespace pixl {
+
+    // NUMA support, read from /sys/devices/system/node. On machines with a single node (or
+    // without NUMA support in the kernel) everything is on node 0 and placing memory does
+    // nothing.
+    //
+    // Memory is placed on the node of the thread that allocates it (buffers of decoders &
+    // operations), and the thread pool hands the work on an image to workers on the node the
+    // image lives on.
+
+    // Ids of the nodes that have CPUs.
+    const std::vector<u32>& numa_nodes();
+
+    // CPUs of a node.
+    std::vector<u32> numa_cpus(u32 node);
+
+    // Node of the CPU the calling thread runs on.
+    u32 numa_current_node();
+
+    // Node the memory at address is placed on, -1 if unknown.
+    i32 numa_node_of(const void* address);
+
+    // Asks the kernel to place the pages of a freshly allocated buffer on the given node, -1
+    // picks the one of the calling thread. Only pages that haven't been touched yet move.
+    void numa_place(void* data, u64 size, i32 node = -1);
+
+    // malloc placing the buffer on the given node, -1 picks the one of the calling thread.
+    void* numa_malloc(u64 size, i32 node = -1);
+
+    // Node preferred by work started from the current thread: the one of the current
+    // NumaScope or else the one the thread runs on.
+    u32 numa_preferred_node();
+
+    // Runs work started by the current thread (e.g. by parallel_for) on the workers of a
+    // node while the scope is alive. A negative node keeps the current preference.
+    class NumaScope {
+    public:
+        NumaScope(i32 node);
+        ~NumaScope();
+
+    private:
+        i32 previous;
+    };
+
+    struct NumaNodeStats {
+        u32 node;
+        u32 cpus;
+        // workers of the thread pool
+        u32 workers;
+        // tasks run by those workers, and how many of them were taken from another node
+        u64 tasks;
+        u64 remoteTasks;
+        // memory placed on the node by numa_place
+        u64 bytes;
+    };
+
+    // Counters since the start of the process, one entry per node.
+    std::vector<NumaNodeStats> numa_stats();
+
+    // Used by the thread pool for the stats.
+    void numa_count_workers(u32 node, i32 count);
+    void numa_count_task(u32 node, bool remote);
+}
+
+#endif
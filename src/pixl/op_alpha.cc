@@ -14,8 +14,12 @@
 // limitations under the License.
 //
 
+#include <cstdlib>
+
 #include "operations.h"
 #include "image.h"
+#include "kernels.h"
+#include "numa.h"
 #include "types.h"
 #include "utils.h"
 
@@ -25,44 +29,69 @@ namespace pixl {
         // ----------------------------------------------------------------------------
         void add_alpha_channel(Image* img, u8 defaultValue) {
             if(img->channels != 3) return;
-            img->channels = 4;
-            img->lineSize = img->channels * img->width;
-            img->size = img->lineSize * img->height;
 
-            u8* newData = (u8*)malloc(img->size);
-            for(int i = 1; i <= img->size; i++) {
-                int idx = i - 1;
-                if(i % 4 == 0) {
-                    newData[idx] = defaultValue;
-                } else {
-                    newData[idx] = img->data[idx-i/4];
-                }
+            u8* newData =
+                (u8*)numa_malloc((u64)img->width * img->height * 4, numa_node_of(img->data));
+            const Band in = band(img);
+            try {
+                for_each_band(band(newData, img->width, img->height, 4), [&](const Band& rows) {
+                    add_alpha_channel_rows(in, rows, defaultValue);
+                });
+            } catch (...) {
+                free(newData);
+                throw;
             }
 
+            img->channels = 4;
+            img->lineSize = img->channels * img->width;
+            img->size = img->lineSize * img->height;
             free(img->data);
             img->data = newData;
         }
 
+        // ----------------------------------------------------------------------------
+        void add_alpha_channel_rows(const Band& in, const Band& out, u8 defaultValue) {
+            const Kernels& k = kernels();
+            for (i32 y = out.y0; y < out.y1; y++) {
+                k.add_alpha(in.row(y), out.row(y), out.width, defaultValue);
+            }
+        }
+
         // ----------------------------------------------------------------------------
         void remove_alpha_channel(Image* img) {
             if(img->channels != 4) return;
-            auto oldSize = img->size;
+            const u64 lineSize = img->lineSize;
             img->channels = 3;
             img->lineSize = img->channels * img->width;
             img->size = img->lineSize * img->height;
 
-            u8* newData = (u8*)malloc(img->size);
-            for(int i = 1; i <= oldSize; i++) {
-                int idx = i - 1;
-                if(i % 4 == 0) {
-                    continue;
-                } else {
-                    newData[idx-i/4] = img->data[idx];
-                }
+            // compact in place, the write position never overtakes the read position
+            const Kernels& k = kernels();
+            u8* data = img->data;
+            for (i32 y = 0; y < img->height; y++) {
+                k.remove_alpha(data + y * lineSize, data + y * img->lineSize, img->width);
             }
 
-            free(img->data);
-            img->data = newData;
+            // the old buffer is still valid, just larger than needed, if it can't be shrunk
+            u8* shrunk = (u8*)realloc(data, img->size);
+            if (shrunk != nullptr) {
+                img->data = shrunk;
+            }
+        }
+
+        // ----------------------------------------------------------------------------
+        void remove_alpha_channel_rows(const Band& in, const Band& out) {
+            const Kernels& k = kernels();
+            for (i32 y = out.y0; y < out.y1; y++) {
+                k.remove_alpha(in.row(y), out.row(y), out.width);
+            }
+        }
+
+        // ----------------------------------------------------------------------------
+        bool is_opaque(const Image* img) {
+            if(img->channels != 2 && img->channels != 4) return true;
+
+            return kernels().opaque(img->data, img->size, img->channels);
         }
     }
 }
\ No newline at end of file
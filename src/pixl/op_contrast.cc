@@ -20,6 +20,7 @@
 
 #include "operations.h"
 #include "image.h"
+#include "kernels.h"
 #include "types.h"
 #include "utils.h"
 
@@ -28,14 +29,16 @@ namespace pixl {
 
     // ----------------------------------------------------------------------------
     void op::contrast(Image* img, f32 contrast) {
-        const int channels = std::min(img->channels, 3);
+        const Band b = band(img);
+        for_each_band(b, [&](const Band& rows) { contrast_rows(b, rows, contrast); });
+    }
 
-        for(auto offset = 0; offset < img->size; offset += img->channels) {
-            auto pixel = img->data + offset;
-            for(auto c = 0; c < channels; c++) {
-                f32 n = contrast * (pixel[c] - 128) + 128;            
-                pixel[c] = (u8) clamp(n, 0.0f, 255.0f);
-            }
+    // ----------------------------------------------------------------------------
+    void op::contrast_rows(const Band& in, const Band& out, f32 contrast) {
+        const Kernels& k = kernels();
+        const i16 factor = contrast_factor(contrast);
+        for (i32 y = out.y0; y < out.y1; y++) {
+            k.contrast(in.row(y), out.row(y), out.width, out.channels, factor);
         }
     }
 
@@ -20,6 +20,8 @@
 
 #include "operations.h"
 #include "image.h"
+#include "kernels.h"
+#include "numa.h"
 #include "types.h"
 #include "utils.h"
 
@@ -33,39 +35,44 @@ namespace pixl {
             return;
         }
 
-        const i32 channels = img->channels;
-        
         // create new buffer
-        u8* buffer = (u8*)malloc(img->size);
-        std::memcpy(buffer, img->data, img->size);
-
-        for (i32 y = 1; y < img->height - 1; y++) {
-            const auto yOffset = (y-1) * img->lineSize;
-            for (i32 x = 1; x < img->width - 1; x++) {
-                const auto offset = yOffset + (x-1) * channels;
-
-                // apply kernel
-                auto k0 = img->data + offset;
-                auto k1 = k0 + channels;
-                auto k2 = k1 + channels;
-                auto k3 = k0 + img->lineSize;
-                auto k4 = k3 + channels;
-                auto k5 = k4 + channels;
-                auto k6 = k3 + img->lineSize;
-                auto k7 = k6 + channels;
-                auto k8 = k7 + channels;
-                u8* start = buffer + offset;
-                for (i32 c = 0; c < channels; c++) {
-                    f32 val = kernel[0] * k0[c] + kernel[1] * k1[c] + kernel[2] * k2[c] +
-                              kernel[3] * k3[c] + kernel[4] * k4[c] + kernel[5] * k5[c] +
-                              kernel[6] * k6[c] + kernel[7] * k7[c] + kernel[8] * k8[c];
-                    val *= scale;
-                    start[c] = (u8) std::max(0.0f, std::min(val, 255.0f));
-                }
-            }
+        u8* buffer = (u8*)numa_malloc(img->size, numa_node_of(img->data));
+        const Band in = band(img);
+        try {
+            for_each_band(band(buffer, img->width, img->height, img->channels),
+                          [&](const Band& rows) { convolution_rows(in, rows, kernel, scale); });
+        } catch (...) {
+            free(buffer);
+            throw;
         }
 
         free(img->data);
         img->data = buffer;
     }
+
+    // ----------------------------------------------------------------------------
+    void op::convolution_rows(const Band& in,
+                              const Band& out,
+                              const Kernel kernel,
+                              const f32 scale) {
+        const i32 channels = in.channels;
+        const Kernels& k = kernels();
+
+        for (i32 y = out.y0; y < out.y1; y++) {
+            u8* start = out.row(y);
+
+            // The result of the pixel at x,y is stored at x-1,y-1. The last two rows & columns
+            // keep their values.
+            if (y >= in.height - 2 || in.width < 3) {
+                std::memcpy(start, in.row(y), out.lineSize);
+                continue;
+            }
+            const u64 edge = (in.width - 2) * channels;
+            std::memcpy(start + edge, in.row(y) + edge, out.lineSize - edge);
+
+            // apply kernel
+            k.convolution(in.row(y), in.row(y + 1), in.row(y + 2), start, (u32)edge, channels,
+                          kernel.data(), scale);
+        }
+    }
 }
\ No newline at end of file
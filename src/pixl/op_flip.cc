@@ -14,6 +14,8 @@
 // limitations under the License.
 //
 
+#include <cstring>
+
 #include "operations.h"
 #include "image.h"
 #include "types.h"
@@ -24,29 +26,41 @@ namespace pixl {
 
         // ----------------------------------------------------------------------------
         void flip_vertically(Image* img) {
-            const auto lastLine = (img->height - 1) * img->lineSize;
-            for (i32 column = 0; column < img->width; column++) {
-                u8* start = img->data + (column * img->channels);
-                u8* end = start + lastLine;
-
-                while (start <= end) {
-                    aswap(start, end, img->channels);
-                    start += img->lineSize;
-                    end -= img->lineSize;
+            // swap the upper half with the lower one
+            const Band b = band(img);
+            for_each_band(b.rows(0, img->height / 2), [&](const Band& rows) {
+                for (i32 y = rows.y0; y < rows.y1; y++) {
+                    aswap(b.row(y), b.row(img->height - 1 - y), (i32)b.lineSize);
                 }
+            });
+        }
+
+        // ----------------------------------------------------------------------------
+        void flip_vertically_rows(const Band& in, const Band& out) {
+            for (i32 y = out.y0; y < out.y1; y++) {
+                memcpy(out.row(y), in.row(out.height - 1 - y), out.lineSize);
             }
         }
 
         // ----------------------------------------------------------------------------
         void flip_horizontally(Image* img) {
-            for (i32 line = 0; line < img->height; line++) {
-                u8* start = img->data + (line * img->lineSize);
-                u8* end = start + img->lineSize - img->channels;
+            const Band b = band(img);
+            for_each_band(b, [&](const Band& rows) { flip_horizontally_rows(b, rows); });
+        }
+
+        // ----------------------------------------------------------------------------
+        void flip_horizontally_rows(const Band& in, const Band& out) {
+            for (i32 y = out.y0; y < out.y1; y++) {
+                u8* start = out.row(y);
+                if (in.row(y) != start) {
+                    memcpy(start, in.row(y), out.lineSize);
+                }
+                u8* end = start + out.lineSize - out.channels;
 
                 while (start <= end) {
-                    aswap(start, end, img->channels);
-                    start += img->channels;
-                    end -= img->channels;
+                    aswap(start, end, out.channels);
+                    start += out.channels;
+                    end -= out.channels;
                 }
             }
         }
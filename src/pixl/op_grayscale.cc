@@ -20,6 +20,7 @@
 
 #include "operations.h"
 #include "image.h"
+#include "kernels.h"
 #include "types.h"
 #include "utils.h"
 
@@ -28,20 +29,15 @@ namespace pixl {
 
     // ----------------------------------------------------------------------------
     void op::grayscale(Image* img) {
-        const int channels = std::min(img->channels, 3);
-
-        for(u64 offset = 0; offset < img->size; offset += img->channels) {
-            auto pixel = img->data + offset;
+        const Band b = band(img);
+        for_each_band(b, [&](const Band& rows) { grayscale_rows(b, rows); });
+    }
 
-            // calc mean
-            f32 mean = 0;
-            for (auto c = 0; c < channels; c++) {
-                mean += (f32) pixel[c];
-            }
-            mean /= channels;
-            
-            // set new values
-            memset(pixel, (u8)mean, channels);
+    // ----------------------------------------------------------------------------
+    void op::grayscale_rows(const Band& in, const Band& out) {
+        const Kernels& k = kernels();
+        for (i32 y = out.y0; y < out.y1; y++) {
+            k.grayscale(in.row(y), out.row(y), out.width, out.channels);
         }
     }
 }
\ No newline at end of file
@@ -20,6 +20,7 @@
 
 #include "operations.h"
 #include "image.h"
+#include "kernels.h"
 #include "types.h"
 #include "utils.h"
 
@@ -28,13 +29,15 @@ namespace pixl {
 
     // ----------------------------------------------------------------------------
     void op::invert(Image* img) {
-        const int channels = std::min(img->channels, 3);
+        const Band b = band(img);
+        for_each_band(b, [&](const Band& rows) { invert_rows(b, rows); });
+    }
 
-        for(auto offset = 0; offset < img->size; offset += img->channels) {
-            auto pixel = img->data + offset;
-            for(auto c = 0; c < channels; c++) {
-                pixel[c] = 255 - pixel[c];
-            }
+    // ----------------------------------------------------------------------------
+    void op::invert_rows(const Band& in, const Band& out) {
+        const Kernels& k = kernels();
+        for (i32 y = out.y0; y < out.y1; y++) {
+            k.invert(in.row(y), out.row(y), out.width, out.channels);
         }
     }
 
@@ -0,0 +1,69 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "fixed.h"
+#include "operations.h"
+#include "image.h"
+#include "types.h"
+#include "utils.h"
+
+
+namespace pixl {
+
+    // ----------------------------------------------------------------------------
+    void op::point(Image* img, const u8* before, bool grayscale, const u8* after) {
+        const Band b = band(img);
+        for_each_band(b, [&](const Band& rows) { point_rows(b, rows, before, grayscale, after); });
+    }
+
+    // ----------------------------------------------------------------------------
+    void op::point_rows(const Band& in,
+                        const Band& out,
+                        const u8* before,
+                        bool grayscale,
+                        const u8* after) {
+        const int channels = std::min(in.channels, 3);
+
+        for (i32 y = out.y0; y < out.y1; y++) {
+            const u8* src = in.row(y);
+            u8* dst = out.row(y);
+            if (src != dst) {
+                memcpy(dst, src, out.lineSize);
+            }
+
+            for (u64 offset = 0; offset < out.lineSize; offset += out.channels) {
+                auto pixel = dst + offset;
+
+                if (grayscale) {
+                    // same as op::grayscale
+                    u32 sum = 0;
+                    for (auto c = 0; c < channels; c++) {
+                        sum += before[pixel[c]];
+                    }
+                    memset(pixel, after[fixed::divide(sum, channels)], channels);
+                } else {
+                    for (auto c = 0; c < channels; c++) {
+                        pixel[c] = after[before[pixel[c]]];
+                    }
+                }
+            }
+        }
+    }
+}
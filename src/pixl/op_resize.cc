@@ -13,9 +13,11 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 //
-#include <cstring>
+#include <vector>
 
+#include "fixed.h"
 #include "image.h"
+#include "kernels.h"
 #include "types.h"
 #include "utils.h"
 #include "operations.h"
@@ -24,63 +26,65 @@ namespace pixl {
 
     // ----------------------------------------------------------------------------
     void op::resize_nearest(const Image* image, u8* out, u32 targetWidth, u32 targetHeight) {
-        // Pre-calc some constants
-        const f64 xRatio = image->width / (f64)targetWidth;
-        const f64 yRatio = image->height / (f64)targetHeight;
-        const u32 originalLineSize = image->width * image->channels;
-        const u32 newRowSize = targetWidth * image->channels;
-
-        const auto channels = image->channels;
+        const Band in = band(image);
+        for_each_band(band(out, targetWidth, targetHeight, image->channels),
+                      [&](const Band& rows) { resize_nearest_rows(in, rows); });
+    }
 
-        // Go through each image line
-        i32 newStart, oldStart;
-        i32 scaledOriginalLineSize;
-        for (u32 y = 0; y < targetHeight; y++) {
-            scaledOriginalLineSize = FAST_FLOOR(y * yRatio) * originalLineSize;
+    // ----------------------------------------------------------------------------
+    void op::resize_nearest_rows(const Band& in, const Band& out) {
+        const auto channels = in.channels;
 
-            for (u32 x = 0; x < targetWidth; x++) {
-                // calc start index of old and new pixel data
-                newStart = y * newRowSize + x * channels;
-                oldStart = scaledOriginalLineSize + FAST_FLOOR(x * xRatio) * channels;
+        // offsets of the source pixels, the same for every row. Columns are mapped like rows.
+        std::vector<u32> columns(out.width);
+        for (i32 x = 0; x < out.width; x++) {
+            columns[x] = resize_nearest_row(x, in.width, out.width) * channels;
+        }
 
-                // copy values from the old pixel array to the new one
-                std::memcpy(out + newStart, image->data + oldStart, channels);
-            }
+        // Go through each image line
+        const Kernels& k = kernels();
+        for (i32 y = out.y0; y < out.y1; y++) {
+            const u8* src = in.row(resize_nearest_row(y, in.height, out.height));
+            k.resize_nearest(src, out.row(y), columns.data(), out.width, channels);
         }
     }
 
     // ----------------------------------------------------------------------------
     void op::resize_bilinear(const Image* image, u8* out, u32 targetWidth, u32 targetHeight) {
-        const auto data = image->data;
-        const auto channels = image->channels;
+        const Band in = band(image);
+        for_each_band(band(out, targetWidth, targetHeight, image->channels),
+                      [&](const Band& rows) { resize_bilinear_rows(in, rows); });
+    }
 
-        const u32 newLineSize = targetWidth * channels;
-        const u32 oldLineSize = image->width * channels;
+    // ----------------------------------------------------------------------------
+    void op::resize_bilinear_rows(const Band& in, const Band& out) {
+        const auto channels = in.channels;
+        const u32 targetWidth = out.width;
+        const u32 targetHeight = out.height;
 
-        for (u32 y = 0; y < targetHeight; y++) {
-            u32 oldY = y / (float)(targetHeight) * (image->height - 1);
-            f32 newYScale = (f32)y / targetHeight;
-            u32 currentLineOffset = y * newLineSize;
+        // images that are a single pixel wide or high repeat their edge
+        const u32 nextColumn = in.width > 1 ? channels : 0;
 
-            for (u32 x = 0; x < targetWidth; x++) {
-                u32 oldX = x / (float)(targetWidth) * (image->width - 1);
+        // offsets of the left source pixels & their weights in Q8, the same for every row.
+        // Columns are mapped like rows.
+        std::vector<u32> columns(targetWidth);
+        std::vector<i32> weights(targetWidth);
+        for (u32 x = 0; x < targetWidth; x++) {
+            columns[x] = resize_bilinear_row(x, in.width, targetWidth) * channels;
+            weights[x] = fixed::to_q((f32)x / targetWidth, 8);
+        }
 
-                u32 c00 = (oldX * channels) + (oldY * oldLineSize);
-                u32 c10 = c00 + channels;
-                u32 c01 = c00 + oldLineSize;
-                u32 c11 = c01 + channels;
+        // scratch space of the kernel
+        std::vector<u16> mid((u64)in.width * channels);
+        const Kernels& k = kernels();
 
-                u32 newStart = currentLineOffset + x * channels;
-                f32 newXScale = (f32)x / targetWidth;
-                for (auto i = 0; i < channels; i++) {
-                    out[newStart + i] = blerp(data[c00 + i],
-                                              data[c10 + i],
-                                              data[c01 + i],
-                                              data[c11 + i],
-                                              newXScale,
-                                              newYScale);
-                }
-            }
+        for (i32 y = out.y0; y < out.y1; y++) {
+            const u32 oldY = resize_bilinear_row(y, in.height, targetHeight);
+            const i32 weightY = fixed::to_q((f32)y / targetHeight, 8);
+            const u8* row0 = in.row(oldY);
+            const u8* row1 = in.row(std::min((i32)oldY + 1, in.height - 1));
+            k.resize_bilinear(row0, row1, out.row(y), mid.data(), (u32)mid.size(), columns.data(),
+                              weights.data(), nextColumn, weightY, targetWidth, channels);
         }
     }
-}
\ No newline at end of file
+}
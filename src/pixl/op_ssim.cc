@@ -0,0 +1,102 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <vector>
+
+#include "operations.h"
+#include "image.h"
+#include "types.h"
+#include "utils.h"
+
+// SSIM window size & step
+#define SSIM_WINDOW 8
+#define SSIM_STEP 4
+
+namespace pixl {
+
+    // ----------------------------------------------------------------------------
+    static void luma(const Image* img, std::vector<f32>& out) {
+        out.resize((u64)img->width * img->height);
+        for (u64 i = 0; i < out.size(); i++) {
+            const u8* pixel = img->data + i * img->channels;
+            if (img->channels >= 3) {
+                out[i] = 0.299f * pixel[0] + 0.587f * pixel[1] + 0.114f * pixel[2];
+            } else {
+                out[i] = pixel[0];
+            }
+        }
+    }
+
+    // ----------------------------------------------------------------------------
+    f64 op::ssim(const Image* a, const Image* b) {
+        if (a->width != b->width || a->height != b->height) {
+            PIXL_DEBUG("SSIM needs two images with the same dimensions");
+            return -1;
+        }
+
+        std::vector<f32> la, lb;
+        luma(a, la);
+        luma(b, lb);
+
+        // small images are compared as a single window
+        const i32 window = std::min(SSIM_WINDOW, std::min(a->width, a->height));
+        const f64 c1 = (0.01 * 255) * (0.01 * 255);
+        const f64 c2 = (0.03 * 255) * (0.03 * 255);
+        const f64 n = window * window;
+
+        // Rows of windows are computed in parallel and summed up in order afterwards, so the
+        // result doesn't depend on the number of threads.
+        const i32 windowRows = (a->height >= window) ? (a->height - window) / SSIM_STEP + 1 : 0;
+        std::vector<f64> rowSums(windowRows, 0);
+        parallel_for(0, windowRows, 1, [&](i64 from, i64 to) {
+            for (i64 row = from; row < to; row++) {
+                const i32 y = (i32)row * SSIM_STEP;
+                for (i32 x = 0; x + window <= a->width; x += SSIM_STEP) {
+                    f64 sa = 0, sb = 0, saa = 0, sbb = 0, sab = 0;
+                    for (i32 wy = 0; wy < window; wy++) {
+                        const u64 offset = (u64)(y + wy) * a->width + x;
+                        for (i32 wx = 0; wx < window; wx++) {
+                            const f64 va = la[offset + wx];
+                            const f64 vb = lb[offset + wx];
+                            sa += va;
+                            sb += vb;
+                            saa += va * va;
+                            sbb += vb * vb;
+                            sab += va * vb;
+                        }
+                    }
+
+                    const f64 meanA = sa / n;
+                    const f64 meanB = sb / n;
+                    const f64 varA = saa / n - meanA * meanA;
+                    const f64 varB = sbb / n - meanB * meanB;
+                    const f64 cov = sab / n - meanA * meanB;
+
+                    rowSums[row] += ((2 * meanA * meanB + c1) * (2 * cov + c2)) /
+                                    ((meanA * meanA + meanB * meanB + c1) * (varA + varB + c2));
+                }
+            }
+        });
+
+        const u64 windows = (u64)windowRows * ((a->width - window) / SSIM_STEP + 1);
+        f64 sum = 0;
+        for (auto rowSum : rowSums) {
+            sum += rowSum;
+        }
+
+        return windows ? sum / windows : 1.0;
+    }
+}
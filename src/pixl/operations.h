@@ -17,10 +17,16 @@
 #ifndef PIXL_TRANSFORM_H
 #define PIXL_TRANSFORM_H
 
+#include <functional>
 #include <vector>
 
+#include "context.h"
+#include "fixed.h"
 #include "image.h"
+#include "numa.h"
+#include "threads.h"
 #include "types.h"
+#include "utils.h"
 
 // Performes a floor by casting to an int. Should only be used with values > 0.
 #define FAST_FLOOR(x) ((int)(x))
@@ -28,48 +34,175 @@
 // Linear interpolates x between start and end.
 #define LERP(start, end, x) (start + (end - start) * x)
 
+// Minimum number of bytes a parallel task of an operation works on
+#define PIXL_GRAIN_BYTES (64 * 1024)
+
 namespace pixl {
     namespace op {
 
-        // Bilinear interpolation.
-        inline float blerp(float c00, float c10, float c01, float c11, float x, float y) {
-            return LERP(LERP(c00, c10, x), LERP(c01, c11, x), y);
+        // Rows [y0, y1) of an image that is 'height' rows high. Row y is stored at
+        // data + (y - y0) * lineSize. The *_rows kernels below read from one band and write
+        // rows of another, so a chain of operations can run on a few rows at a time.
+        struct Band {
+            u8* data;
+            i32 width;
+            i32 height;
+            i32 channels;
+            i32 y0;
+            i32 y1;
+            u64 lineSize;
+
+            inline u8* row(i32 y) const { return data + (y - y0) * lineSize; }
+
+            // Rows [from, to) of this band.
+            inline Band rows(i32 from, i32 to) const {
+                Band band = *this;
+                band.data = row(from);
+                band.y0 = from;
+                band.y1 = to;
+                return band;
+            }
+        };
+
+        // Band covering the whole image.
+        inline Band band(const Image* img) {
+            return Band{img->data, img->width, img->height, img->channels, 0, img->height,
+                        img->lineSize};
+        }
+
+        // Band covering a whole image of the given dimensions stored in data.
+        inline Band band(u8* data, i32 width, i32 height, i32 channels) {
+            return Band{data, width, height, channels, 0, height, (u64)width * channels};
+        }
+
+        // Splits the rows of out into bands and runs the kernel on them in parallel, on the
+        // NUMA node of out. Checks for cancellation & reports the progress per band.
+        inline void for_each_band(const Band& out, const std::function<void(const Band&)>& kernel) {
+            NumaScope scope(numa_node_of(out.data));
+            Progress progress(out.y1 - out.y0);
+            const i64 grain = std::max((u64)1, PIXL_GRAIN_BYTES / std::max(out.lineSize, (u64)1));
+            parallel_for(out.y0, out.y1, grain, [&](i64 from, i64 to) {
+                check_cancelled();
+                kernel(out.rows((i32)from, (i32)to));
+                progress.advance(to - from);
+            });
+        }
+
+        // Contrast factor in Q8 as used by the contrast operation, so factors are rounded to
+        // steps of 1/256.
+        inline i16 contrast_factor(f32 contrast) {
+            return fixed::to_q(contrast, 8);
+        }
+
+        // Adjusts the contrast of a single color value.
+        inline u8 contrast_value(u8 value, f32 contrast) {
+            return fixed::saturate_u8(fixed::mul_floor(value - 128, contrast_factor(contrast), 8) +
+                                      128);
+        }
+
+        // Row of the source image that the nearest neighbor resize samples for row y.
+        inline i32 resize_nearest_row(i32 y, i32 height, i32 targetHeight) {
+            return FAST_FLOOR(y * (height / (f64)targetHeight));
+        }
+
+        // First of the two rows of the source image that the bilinear resize interpolates
+        // for row y.
+        inline i32 resize_bilinear_row(i32 y, i32 height, i32 targetHeight) {
+            return (u32)(y / (float)(targetHeight) * (height - 1));
         }
 
         // Flips the image vertically.
         void flip_vertically(Image* img);
 
+        // Flips rows [out.y0, out.y1) vertically. The input band must hold the mirrored rows
+        // and must not be the output band.
+        void flip_vertically_rows(const Band& in, const Band& out);
+
         // Flips the image horizontally.
         void flip_horizontally(Image* img);
 
+        // Flips rows [out.y0, out.y1) horizontally. The output may be the input band.
+        void flip_horizontally_rows(const Band& in, const Band& out);
+
         // Resizes the image using the nearest neighbor method.
         // The original image is not changed. The newly scaled image is stored in
         // the provided 'out' buffer.
         void resize_nearest(const Image* img, u8* out, u32 width, u32 height);
 
+        // Computes rows [out.y0, out.y1) of the nearest neighbor resize. The target dimensions
+        // are the ones of the output band.
+        void resize_nearest_rows(const Band& in, const Band& out);
+
         // Resizes the image using the bilinear method.
         // The original image is not changed. The newly scaled image is stored in
         // the provided 'out' buffer.
         void resize_bilinear(const Image* img, u8* out, u32 width, u32 height);
 
+        // Computes rows [out.y0, out.y1) of the bilinear resize. The target dimensions
+        // are the ones of the output band.
+        void resize_bilinear_rows(const Band& in, const Band& out);
+
         // Grayscales the image while keeping all channels.
         void grayscale(Image* img);
 
+        // Grayscales rows [out.y0, out.y1). The output may be the input band.
+        void grayscale_rows(const Band& in, const Band& out);
+
         // Inverts all color values of the image.
         void invert(Image* img);
 
+        // Inverts rows [out.y0, out.y1). The output may be the input band.
+        void invert_rows(const Band& in, const Band& out);
+
         // Applies a 3x3 convolution matrix to the image.
         void convolution(Image* img, const Kernel kernel, const f32 scale);
 
+        // Computes rows [out.y0, out.y1) of the convolution. Row y needs rows y to y + 2 of
+        // the input, the output must not be the input band.
+        void convolution_rows(const Band& in,
+                              const Band& out,
+                              const Kernel kernel,
+                              const f32 scale);
+
         // Adds an alpha channel to the image if not already there.
         void add_alpha_channel(Image* img, u8 defaultValue);
 
+        // Copies rows [out.y0, out.y1) of a 3 channel band to a 4 channel one.
+        void add_alpha_channel_rows(const Band& in, const Band& out, u8 defaultValue);
+
         // Removes the alphe channel of an image if available.
         void remove_alpha_channel(Image* img);
 
+        // Copies rows [out.y0, out.y1) of a 4 channel band to a 3 channel one.
+        void remove_alpha_channel_rows(const Band& in, const Band& out);
+
+        // Checks if all alpha values of the image are 255.
+        // Images without an alpha channel are always opaque.
+        bool is_opaque(const Image* img);
+
         // Adjusts the contrast of the image
         void contrast(Image* img, f32 contrast);
 
+        // Adjusts the contrast of rows [out.y0, out.y1). The output may be the input band.
+        void contrast_rows(const Band& in, const Band& out, f32 contrast);
+
+        // Applies a fused run of point operations: every color value is mapped by the 'before'
+        // table, then the pixel is grayscaled (optional) and mapped by the 'after' table.
+        void point(Image* img, const u8* before, bool grayscale, const u8* after);
+
+        // Applies a fused run of point operations to rows [out.y0, out.y1). The output may be
+        // the input band.
+        void point_rows(const Band& in,
+                        const Band& out,
+                        const u8* before,
+                        bool grayscale,
+                        const u8* after);
+
+        // Computes the mean structural similarity (SSIM) of the luma of two images with the
+        // same dimensions. Alpha channels are ignored. Returns a value in [-1, 1], where
+        // 1 means the images are identical.
+        f64 ssim(const Image* a, const Image* b);
+
     }
 }
 
@@ -0,0 +1,149 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef PIXL_PIPE_H
+#define PIXL_PIPE_H
+
+#include <algorithm>
+
+#include "fixed.h"
+#include "image.h"
+#include "operations.h"
+#include "types.h"
+
+namespace pixl {
+
+    // Point operations fused at compile time.
+    //
+    //     auto recipe = pixl::pipe(pixl::invert{}, pixl::contrast{1.2f}, pixl::grayscale{});
+    //     recipe(image);
+    //
+    // All stages are applied to a pixel before moving on to the next one, in a single loop
+    // that is specialized on the number of channels, so there is no dispatch per pixel and no
+    // intermediate image. The results are the same as calling the operations one by one.
+    //
+    // A stage is a type with a method 'template <u32 C> void apply(u8* pixel) const' that
+    // updates the color channels of a pixel with C channels.
+
+    // Stage inverting the colors, see Image::invert.
+    struct invert {
+        template <u32 C>
+        inline void apply(u8* pixel) const {
+            for (u32 c = 0; c < std::min(C, 3u); c++) {
+                pixel[c] = 255 - pixel[c];
+            }
+        }
+    };
+
+    // Stage adjusting the contrast, see Image::contrast.
+    struct contrast {
+        contrast(f32 value) {
+            for (u32 i = 0; i < 256; i++) {
+                this->table[i] = op::contrast_value((u8)i, value);
+            }
+        }
+
+        template <u32 C>
+        inline void apply(u8* pixel) const {
+            for (u32 c = 0; c < std::min(C, 3u); c++) {
+                pixel[c] = this->table[pixel[c]];
+            }
+        }
+
+        u8 table[256];
+    };
+
+    // Stage grayscaling the colors, see Image::grayscale.
+    struct grayscale {
+        template <u32 C>
+        inline void apply(u8* pixel) const {
+            const u32 channels = std::min(C, 3u);
+            u32 sum = 0;
+            for (u32 c = 0; c < channels; c++) {
+                sum += pixel[c];
+            }
+            const u8 mean = (u8)fixed::divide(sum, channels);
+            for (u32 c = 0; c < channels; c++) {
+                pixel[c] = mean;
+            }
+        }
+    };
+
+    template <typename... Stages>
+    struct Pipe;
+
+    template <>
+    struct Pipe<> {
+        template <u32 C>
+        inline void apply(u8*) const {}
+    };
+
+    template <typename First, typename... Rest>
+    struct Pipe<First, Rest...> {
+        Pipe(const First& first, const Rest&... rest) : first(first), rest(rest...) {}
+
+        template <u32 C>
+        inline void apply(u8* pixel) const {
+            this->first.template apply<C>(pixel);
+            this->rest.template apply<C>(pixel);
+        }
+
+        // Runs all stages over the rows of out, reading the pixels from in.
+        void rows(const op::Band& in, const op::Band& out) const {
+            switch (out.channels) {
+                case 1: run<1>(in, out); break;
+                case 2: run<2>(in, out); break;
+                case 3: run<3>(in, out); break;
+                case 4: run<4>(in, out); break;
+            }
+        }
+
+        // Runs all stages over the image in place. Returns the image for chaining.
+        Image* operator()(Image* image) const {
+            const op::Band b = op::band(image);
+            op::for_each_band(b, [&](const op::Band& band) { this->rows(b, band); });
+            return image;
+        }
+
+        First first;
+        Pipe<Rest...> rest;
+
+    private:
+        template <u32 C>
+        void run(const op::Band& in, const op::Band& out) const {
+            for (i32 y = out.y0; y < out.y1; y++) {
+                const u8* src = in.row(y);
+                u8* dst = out.row(y);
+                if (src != dst) {
+                    std::copy(src, src + out.lineSize, dst);
+                }
+
+                u8* end = dst + (u64)out.width * C;
+                for (u8* pixel = dst; pixel < end; pixel += C) {
+                    apply<C>(pixel);
+                }
+            }
+        }
+    };
+
+    // Fuses the stages into a single pass.
+    template <typename... Stages>
+    inline Pipe<Stages...> pipe(const Stages&... stages) {
+        return Pipe<Stages...>(stages...);
+    }
+}
+
+#endif
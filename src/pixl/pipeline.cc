@@ -0,0 +1,474 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "pipeline.h"
+#include "executor.h"
+#include "errors.h"
+#include "context.h"
+#include "image.h"
+#include "io.h"
+#include "numa.h"
+#include "operations.h"
+#include "threads.h"
+#include "types.h"
+#include "utils.h"
+
+// Bytes all bands of a pipeline should fit in, about the size of a L2 cache
+#define PIXL_BAND_BYTES (256 * 1024)
+
+namespace pixl {
+
+    // Shape of the image in between two operations.
+    struct Shape {
+        i32 width;
+        i32 height;
+        i32 channels;
+    };
+
+    // ----------------------------------------------------------------------------
+    static bool isPointOperation(const Operation& op) {
+        return op.type == OperationType::GRAYSCALE || op.type == OperationType::INVERT ||
+               op.type == OperationType::CONTRAST || op.type == OperationType::POINT;
+    }
+
+    // ----------------------------------------------------------------------------
+    static bool isAlphaOperation(const Operation& op) {
+        return op.type == OperationType::ADD_ALPHA_CHANNEL ||
+               op.type == OperationType::REMOVE_ALPHA_CHANNEL;
+    }
+
+    // ----------------------------------------------------------------------------
+    // Checks if the operation can be swapped with a preceding or following flip.
+    static bool commutesWithFlip(const Operation& op) {
+        return isPointOperation(op) || isAlphaOperation(op) || op.type == OperationType::FLIP;
+    }
+
+    // ----------------------------------------------------------------------------
+    // Checks if the operation can be moved behind the resize. Nearest neighbor only copies
+    // pixels, so every per pixel operation gives the same result. Bilinear interpolates and
+    // rounds, so nothing is moved across it: even inverting would be off by one.
+    static bool commutesWithResize(const Operation& op, ResizeMethod method) {
+        if (method != ResizeMethod::NEARSET_NEIGHBOR)
+            return false;
+        return isPointOperation(op) || op.type == OperationType::ADD_ALPHA_CHANNEL;
+    }
+
+    // ----------------------------------------------------------------------------
+    static Shape apply(Shape shape, const Operation& op) {
+        if (op.type == OperationType::RESIZE) {
+            shape.width = op.width;
+            shape.height = op.height;
+        } else if (op.type == OperationType::ADD_ALPHA_CHANNEL && shape.channels == 3) {
+            shape.channels = 4;
+        } else if (op.type == OperationType::REMOVE_ALPHA_CHANNEL && shape.channels == 4) {
+            shape.channels = 3;
+        }
+        return shape;
+    }
+
+    // ----------------------------------------------------------------------------
+    // Drops pairs of flips with the same orientation. Anything in between must not care about
+    // the orientation of the image.
+    static void dropFlipPairs(std::vector<Operation>& ops) {
+        for (u64 i = 0; i < ops.size(); i++) {
+            if (ops[i].type != OperationType::FLIP)
+                continue;
+
+            for (u64 j = i + 1; j < ops.size() && commutesWithFlip(ops[j]); j++) {
+                if (ops[j].type == OperationType::FLIP && ops[j].orientation == ops[i].orientation) {
+                    ops.erase(ops.begin() + j);
+                    ops.erase(ops.begin() + i);
+                    i--;
+                    break;
+                }
+            }
+        }
+    }
+
+    // ----------------------------------------------------------------------------
+    // Drops operations that would not change the image.
+    static void dropNoOps(std::vector<Operation>& ops, Shape shape) {
+        std::vector<Operation> result;
+        for (u64 i = 0; i < ops.size(); i++) {
+            const Operation& op = ops[i];
+            bool noOp = false;
+
+            switch (op.type) {
+                case OperationType::RESIZE:
+                    noOp = op.method == ResizeMethod::NEARSET_NEIGHBOR &&
+                           (i32)op.width == shape.width && (i32)op.height == shape.height;
+                    break;
+                case OperationType::CONVOLUTION:
+                    noOp = shape.width < 3 || shape.height < 3;
+                    break;
+                case OperationType::CONTRAST:
+                    noOp = op.value == 1;
+                    break;
+                case OperationType::ADD_ALPHA_CHANNEL:
+                    // directly removed again
+                    noOp = shape.channels != 3 ||
+                           (i + 1 < ops.size() &&
+                            ops[i + 1].type == OperationType::REMOVE_ALPHA_CHANNEL);
+                    if (noOp && shape.channels == 3) {
+                        i++;
+                    }
+                    break;
+                case OperationType::REMOVE_ALPHA_CHANNEL:
+                    noOp = shape.channels != 4;
+                    break;
+                default:
+                    break;
+            }
+
+            if (!noOp) {
+                result.push_back(op);
+                shape = apply(shape, op);
+            }
+        }
+        ops.swap(result);
+    }
+
+    // ----------------------------------------------------------------------------
+    // Moves downscales in front of the operations that commute with them, so those operations
+    // touch fewer pixels.
+    static void hoistDownscales(std::vector<Operation>& ops, Shape shape) {
+        std::vector<Shape> shapes;
+        for (auto& op : ops) {
+            shapes.push_back(shape);
+            shape = apply(shape, op);
+        }
+
+        for (u64 i = 0; i < ops.size(); i++) {
+            if (ops[i].type != OperationType::RESIZE)
+                continue;
+            const ResizeMethod method = ops[i].method;
+            const Shape& in = shapes[i];
+            if ((u64)ops[i].width * ops[i].height >= (u64)in.width * in.height)
+                continue;
+
+            // the operations in front of it don't change the dimensions, so the input shape
+            // stays valid while moving
+            u64 j = i;
+            while (j > 0 && commutesWithResize(ops[j - 1], method)) {
+                std::swap(ops[j - 1], ops[j]);
+                j--;
+            }
+        }
+    }
+
+    // ----------------------------------------------------------------------------
+    // Builds the lookup table of a single point operation.
+    static void lookupTable(const Operation& op, LookupTable& table) {
+        for (i32 v = 0; v < 256; v++) {
+            if (op.type == OperationType::INVERT) {
+                table[v] = 255 - v;
+            } else if (op.type == OperationType::CONTRAST) {
+                table[v] = op::contrast_value(v, op.value);
+            } else {
+                table[v] = v;
+            }
+        }
+    }
+
+    // ----------------------------------------------------------------------------
+    // Merges runs of point operations into a single POINT operation.
+    static void fusePointOperations(std::vector<Operation>& ops) {
+        std::vector<Operation> result;
+        for (u64 i = 0; i < ops.size();) {
+            u64 end = i;
+            while (end < ops.size() && isPointOperation(ops[end])) {
+                end++;
+            }
+            if (end - i < 2) {
+                result.push_back(ops[i]);
+                i++;
+                continue;
+            }
+
+            Operation fused(OperationType::POINT);
+            for (i32 v = 0; v < 256; v++) {
+                fused.before[v] = fused.after[v] = v;
+            }
+            for (; i < end; i++) {
+                const Operation& op = ops[i];
+                if (op.type == OperationType::GRAYSCALE) {
+                    // a second grayscale doesn't change the already gray pixels
+                    fused.grayscale = true;
+                    continue;
+                }
+
+                LookupTable& table = fused.grayscale ? fused.after : fused.before;
+                if (op.type != OperationType::POINT) {
+                    LookupTable lut;
+                    lookupTable(op, lut);
+                    for (i32 v = 0; v < 256; v++) {
+                        table[v] = lut[table[v]];
+                    }
+                    continue;
+                }
+
+                for (i32 v = 0; v < 256; v++) {
+                    table[v] = op.before[table[v]];
+                }
+                fused.grayscale = fused.grayscale || op.grayscale;
+                LookupTable& afterTable = fused.grayscale ? fused.after : fused.before;
+                for (i32 v = 0; v < 256; v++) {
+                    afterTable[v] = op.after[afterTable[v]];
+                }
+            }
+            result.push_back(fused);
+        }
+        ops.swap(result);
+    }
+
+    // ----------------------------------------------------------------------------
+    Pipeline* Pipeline::resize(u32 width, u32 height, ResizeMethod method) {
+        Operation op(OperationType::RESIZE);
+        op.width = width;
+        op.height = height;
+        op.method = method;
+        return add(op);
+    }
+
+    // ----------------------------------------------------------------------------
+    Pipeline* Pipeline::flip(Orientation orientation) {
+        Operation op(OperationType::FLIP);
+        op.orientation = orientation;
+        return add(op);
+    }
+
+    // ----------------------------------------------------------------------------
+    Pipeline* Pipeline::convolution(const Kernel kernel, f32 scale) {
+        Operation op(OperationType::CONVOLUTION);
+        op.kernel = kernel;
+        op.value = scale;
+        return add(op);
+    }
+
+    // ----------------------------------------------------------------------------
+    Pipeline* Pipeline::grayscale() {
+        return add(Operation(OperationType::GRAYSCALE));
+    }
+
+    // ----------------------------------------------------------------------------
+    Pipeline* Pipeline::invert() {
+        return add(Operation(OperationType::INVERT));
+    }
+
+    // ----------------------------------------------------------------------------
+    Pipeline* Pipeline::addAlphaChannel(u8 defaultValue) {
+        Operation op(OperationType::ADD_ALPHA_CHANNEL);
+        op.value = defaultValue;
+        return add(op);
+    }
+
+    // ----------------------------------------------------------------------------
+    Pipeline* Pipeline::removeAlphaChannel() {
+        return add(Operation(OperationType::REMOVE_ALPHA_CHANNEL));
+    }
+
+    // ----------------------------------------------------------------------------
+    Pipeline* Pipeline::contrast(f32 contrast) {
+        Operation op(OperationType::CONTRAST);
+        op.value = contrast;
+        return add(op);
+    }
+
+    // ----------------------------------------------------------------------------
+    Pipeline* Pipeline::add(const Operation& operation) {
+        this->ops.push_back(operation);
+        return this;
+    }
+
+    // ----------------------------------------------------------------------------
+    std::vector<Operation> Pipeline::plan(i32 width, i32 height, i32 channels) const {
+        const Shape shape = {width, height, channels};
+        std::vector<Operation> ops = this->ops;
+
+        dropFlipPairs(ops);
+        dropNoOps(ops, shape);
+        hoistDownscales(ops, shape);
+        fusePointOperations(ops);
+
+        return ops;
+    }
+
+    // ----------------------------------------------------------------------------
+    bool Pipeline::decodeHint(u32* minWidth, u32* minHeight) const {
+        std::vector<Operation> ops = this->ops;
+        dropFlipPairs(ops);
+
+        // Flips & per pixel operations don't care about the size, so the first resize behind
+        // them decides. The decoder only ever shrinks, so a larger target is fine as well.
+        for (auto& op : ops) {
+            if (op.type == OperationType::RESIZE) {
+                *minWidth = op.width;
+                *minHeight = op.height;
+                return op.width > 0 && op.height > 0;
+            }
+            if (!isPointOperation(op) && !isAlphaOperation(op) && op.type != OperationType::FLIP)
+                return false;
+        }
+
+        return false;
+    }
+
+    // ----------------------------------------------------------------------------
+    void Pipeline::execute(Image* image) const {
+        auto ops = plan(image->width, image->height, image->channels);
+        if (ops.empty())
+            return;
+
+        BandExecutor executor(ops, image);
+        const i32 width = executor.width();
+        const i32 height = executor.height();
+        const i32 channels = executor.channels();
+
+        // the result & the work stay on the node of the input
+        const i32 node = numa_node_of(image->data);
+        NumaScope scope(node);
+        u8* data = (u8*)numa_malloc((u64)width * height * channels, node);
+
+        const op::Band result = op::band(data, width, height, channels);
+        const i32 rows = this->bandHeight > 0 ? (i32)this->bandHeight
+                                              : executor.bandHeight(PIXL_BAND_BYTES);
+        // bands are independent, every task needs its own executor for the band buffers
+        Progress progress(height);
+        try {
+            parallel_for(0, height, rows, [&](i64 from, i64 to) {
+                check_cancelled();
+                BandExecutor bandExecutor(ops, image);
+                bandExecutor.run(result.rows((i32)from, (i32)to));
+                progress.advance(to - from);
+            });
+        } catch (...) {
+            free(data);
+            throw;
+        }
+
+        free(image->data);
+        image->data = data;
+        image->width = width;
+        image->height = height;
+        image->channels = channels;
+        image->lineSize = result.lineSize;
+        image->size = result.lineSize * height;
+    }
+
+    // ----------------------------------------------------------------------------
+    Image* Pipeline::execute(const char* path) const {
+        Image* image = decode(path);
+        if (image != nullptr) {
+            execute(image);
+        }
+        return image;
+    }
+
+    // ----------------------------------------------------------------------------
+    Image* Pipeline::decode(const char* path) const {
+        u32 minWidth = 0, minHeight = 0;
+        const bool hint = decodeHint(&minWidth, &minHeight);
+        if (this->images) {
+            // the pipeline works in place, so it needs its own copy
+            auto image = this->images->read(path, minWidth, minHeight);
+            return image ? new Image(image.get()) : nullptr;
+        }
+        return hint ? read(path, minWidth, minHeight) : read(path);
+    }
+
+    // ----------------------------------------------------------------------------
+    std::string Pipeline::cacheKey(const char* input, const char* output) const {
+        // the spec includes the encoder actually used
+        Pipeline resolved = *this;
+        if (resolved.encoding.format == ImageFormat::AUTO) {
+            if (is_png(output)) {
+                resolved.encoding.format = ImageFormat::PNG;
+            } else if (is_jpg(output)) {
+                resolved.encoding.format = ImageFormat::JPEG;
+            } else {
+                return "";
+            }
+        }
+
+        std::string spec;
+        try {
+            spec = resolved.toString();
+        } catch (PixlException&) {
+            return "";
+        }
+
+        u64 length = 0;
+        u8* data = read_binary(input, &length);
+        if (data == nullptr)
+            return "";
+        const std::string key = DiskCache::key(data, length, spec);
+        delete[] data;
+        return key;
+    }
+
+    // ----------------------------------------------------------------------------
+    void Pipeline::write(const char* input, const char* output) const {
+        std::string key;
+        if (this->cache) {
+            key = cacheKey(input, output);
+            if (!key.empty() && this->cache->fetch(key, output))
+                return;
+        }
+
+        Image* image = execute(input);
+        if (image == nullptr)
+            throw PixlException("Failed to read image");
+
+        try {
+            write(image, output);
+        } catch (...) {
+            delete image;
+            throw;
+        }
+        delete image;
+
+        if (!key.empty()) {
+            this->cache->store(key, output);
+        }
+    }
+
+    // ----------------------------------------------------------------------------
+    void Pipeline::write(Image* image, const char* path) const {
+        ImageFormat format = this->encoding.format;
+        if (format == ImageFormat::AUTO) {
+            if (is_png(path)) {
+                format = ImageFormat::PNG;
+            } else if (is_jpg(path)) {
+                format = ImageFormat::JPEG;
+            } else {
+                throw PixlException("Unsupported output format: " + std::string(path));
+            }
+        }
+
+        if (format == ImageFormat::PNG) {
+            PngWriter writer;
+            writer.write(image, path);
+        } else {
+            JpegTurboWriter writer;
+            writer.quality = this->encoding.quality;
+            writer.subsampling = this->encoding.subsampling;
+            writer.write(image, path);
+        }
+    }
+}
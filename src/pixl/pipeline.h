@@ -0,0 +1,188 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef PIXL_PIPELINE_H
+#define PIXL_PIPELINE_H
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cache.h"
+#include "image.h"
+#include "io.h"
+#include "types.h"
+
+namespace pixl {
+
+    enum class OperationType {
+        RESIZE,
+        FLIP,
+        CONVOLUTION,
+        GRAYSCALE,
+        INVERT,
+        ADD_ALPHA_CHANNEL,
+        REMOVE_ALPHA_CHANNEL,
+        CONTRAST,
+        // Fused run of point operations. Only created by the optimizer.
+        POINT,
+    };
+
+    typedef std::array<u8, 256> LookupTable;
+
+    // A single operation of a pipeline, together with its parameters.
+    struct Operation {
+        Operation(OperationType type) : type(type) {}
+
+        OperationType type;
+
+        // RESIZE
+        u32 width = 0;
+        u32 height = 0;
+        ResizeMethod method = ResizeMethod::BILINEAR;
+
+        // FLIP
+        Orientation orientation = Orientation::HORIZONTAL;
+
+        // CONVOLUTION
+        Kernel kernel = Kernel();
+
+        // CONVOLUTION: scale, CONTRAST: contrast, ADD_ALPHA_CHANNEL: default value
+        f32 value = 0;
+
+        // POINT: color values are mapped by 'before', then grayscaled (optional) and then
+        // mapped by 'after'.
+        LookupTable before;
+        bool grayscale = false;
+        LookupTable after;
+    };
+
+    enum class ImageFormat {
+        // picked by the file extension
+        AUTO,
+        PNG,
+        JPEG,
+    };
+
+    // How the result of a pipeline is encoded.
+    struct Encoding {
+        ImageFormat format = ImageFormat::AUTO;
+        i32 quality = 75;
+        ChromaSubsampling subsampling = ChromaSubsampling::YUV444;
+    };
+
+    // A chain of operations that is executed as a whole later on.
+    //
+    // The methods mirror the ones of Image, but instead of touching any pixels they only
+    // record the operation. Right before execution, when the dimensions of the input are
+    // known, the chain is optimized:
+    // - operations without effect are dropped, e.g. two horizontal flips
+    // - downscales are moved in front of point operations, so those touch fewer pixels.
+    //   Only nearest neighbor is moved, bilinear rounds and wouldn't give the same result.
+    // - runs of point operations (grayscale, invert, contrast) are fused into a single pass
+    // - if the chain starts with a downscale, jpegs are decoded at a reduced size (DCT
+    //   scaling or exif thumbnail)
+    //
+    // The optimized chain is then executed band by band (see BandExecutor), so no full size
+    // image is created in between two operations.
+    class Pipeline {
+    public:
+        // Parses a pipeline spec, throws a PixlException if it's invalid.
+        //
+        // A spec is a list of operations separated by '|', each with its arguments separated
+        // by ':'. An encoder (jpeg or png) may be the last element.
+        //     resize:WIDTHxHEIGHT[:nearest|bilinear]    (default: bilinear)
+        //     flip[:horizontal|vertical]                (default: horizontal)
+        //     convolution:K0,K1,...,K8[:SCALE]          (default: 1)
+        //     grayscale
+        //     invert
+        //     contrast:CONTRAST
+        //     add_alpha[:VALUE]                         (default: 255)
+        //     remove_alpha
+        //     jpeg[:q=QUALITY][:444|422|420|gray]       (default: q=75, 444)
+        //     png
+        // e.g. "resize:512x384|contrast:1.2|jpeg:q=82:420"
+        static Pipeline parse(const std::string& spec);
+
+        // The spec of the pipeline with all defaults spelled out. Pipelines with the same
+        // operations have the same spec.
+        std::string toString() const;
+
+        Pipeline* resize(u32 width, u32 height, ResizeMethod method = ResizeMethod::BILINEAR);
+        Pipeline* flip(Orientation orientation = Orientation::HORIZONTAL);
+        Pipeline* convolution(const Kernel kernel, f32 scale = 1);
+        Pipeline* grayscale();
+        Pipeline* invert();
+        Pipeline* addAlphaChannel(u8 defaultValue = 255);
+        Pipeline* removeAlphaChannel();
+        Pipeline* contrast(f32 contrast);
+
+        // Appends an operation.
+        Pipeline* add(const Operation& operation);
+
+        // Executes the pipeline on the image.
+        void execute(Image* image) const;
+
+        // Decodes the image at path and executes the pipeline on it.
+        // The caller is responsible for deleting the image.
+        Image* execute(const char* path) const;
+
+        // Decodes the image at path, at a reduced size if the pipeline starts with a downscale.
+        // With an image cache, decoded images are copied from there.
+        // Returns a nullptr if the image can't be read.
+        Image* decode(const char* path) const;
+
+        // Decodes the image at input, executes the pipeline and encodes the result to output.
+        // With a cache, results of earlier calls are copied instead.
+        void write(const char* input, const char* output) const;
+
+        // Encodes the image to path as specified by 'encoding'.
+        void write(Image* image, const char* path) const;
+
+        // The operations in the order they have been recorded.
+        const std::vector<Operation>& operations() const { return this->ops; }
+
+        // The optimized operations for an input image with the given dimensions.
+        std::vector<Operation> plan(i32 width, i32 height, i32 channels) const;
+
+        // Key of the result of write(input, output) in the cache. Empty if the input can't be
+        // read or the pipeline can't be written as a spec.
+        std::string cacheKey(const char* input, const char* output) const;
+
+        // How results are encoded by write().
+        Encoding encoding;
+
+        // Results of write(input, output) are looked up in & added to the cache, if set.
+        // Copies of the pipeline share the cache.
+        std::shared_ptr<DiskCache> cache;
+
+        // Decoded inputs are looked up in & added to the image cache, if set. Several pipelines
+        // reading the same images (e.g. different variants) may share one.
+        std::shared_ptr<ImageCache> images;
+
+        // Number of rows computed at once. 0 picks a height so all bands fit in the L2 cache.
+        u32 bandHeight = 0;
+
+        // Minimum size the input can be decoded at, or false if it's needed at full size.
+        bool decodeHint(u32* minWidth, u32* minHeight) const;
+
+    private:
+        std::vector<Operation> ops;
+    };
+}
+
+#endif
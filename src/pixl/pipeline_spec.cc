@@ -0,0 +1,294 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "pipeline.h"
+#include "errors.h"
+#include "types.h"
+#include "utils.h"
+
+namespace pixl {
+
+    // ----------------------------------------------------------------------------
+    static PixlException specError(const std::string& stage, const std::string& message) {
+        return PixlException("Invalid pipeline stage '" + stage + "': " + message);
+    }
+
+    // ----------------------------------------------------------------------------
+    static f32 parseFloat(const std::string& stage, const std::string& value) {
+        char* end = nullptr;
+        errno = 0;
+        const f32 result = std::strtof(value.c_str(), &end);
+        // also rejects nan & inf, which strtof accepts
+        if (value.empty() || *end != '\0' || errno != 0 || !std::isfinite(result))
+            throw specError(stage, "'" + value + "' is not a number");
+        return result;
+    }
+
+    // ----------------------------------------------------------------------------
+    static u32 parseInt(const std::string& stage, const std::string& value, u32 max) {
+        char* end = nullptr;
+        errno = 0;
+        const long result = std::strtol(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0' || errno != 0 || result < 0 || result > (long)max)
+            throw specError(stage, "'" + value + "' is not a number in [0, " +
+                                   std::to_string(max) + "]");
+        return (u32)result;
+    }
+
+    // ----------------------------------------------------------------------------
+    static void expectArgs(const std::string& stage,
+                           const std::vector<std::string>& args,
+                           size_t min,
+                           size_t max) {
+        if (args.size() - 1 < min || args.size() - 1 > max) {
+            std::string expected = std::to_string(min);
+            if (max != min) {
+                expected += " to " + std::to_string(max);
+            }
+            throw specError(stage, "expected " + expected + " argument(s)");
+        }
+    }
+
+    // ----------------------------------------------------------------------------
+    // Shortest representation that parses back to the same value.
+    static std::string formatFloat(f32 value) {
+        char buffer[32];
+        for (int precision = 6; precision <= 9; precision++) {
+            snprintf(buffer, sizeof(buffer), "%.*g", precision, value);
+            if (std::strtof(buffer, nullptr) == value)
+                break;
+        }
+        return buffer;
+    }
+
+    // ----------------------------------------------------------------------------
+    static void parseEncoder(const std::string& stage,
+                             const std::vector<std::string>& args,
+                             Encoding& encoding) {
+        if (args[0] == "png") {
+            expectArgs(stage, args, 0, 0);
+            encoding.format = ImageFormat::PNG;
+            return;
+        }
+
+        expectArgs(stage, args, 0, 2);
+        encoding.format = ImageFormat::JPEG;
+        for (size_t i = 1; i < args.size(); i++) {
+            const std::string& arg = args[i];
+            if (str_starts_with(arg, "q=")) {
+                encoding.quality = (i32)parseInt(stage, arg.substr(2), 100);
+                if (encoding.quality < 1)
+                    throw specError(stage, "quality must be in [1, 100]");
+            } else if (arg == "444") {
+                encoding.subsampling = ChromaSubsampling::YUV444;
+            } else if (arg == "422") {
+                encoding.subsampling = ChromaSubsampling::YUV422;
+            } else if (arg == "420") {
+                encoding.subsampling = ChromaSubsampling::YUV420;
+            } else if (arg == "gray") {
+                encoding.subsampling = ChromaSubsampling::GRAY;
+            } else {
+                throw specError(stage, "unknown jpeg option '" + arg + "'");
+            }
+        }
+    }
+
+    // ----------------------------------------------------------------------------
+    static Operation parseOperation(const std::string& stage,
+                                    const std::vector<std::string>& args) {
+        const std::string& name = args[0];
+
+        if (name == "resize") {
+            expectArgs(stage, args, 1, 2);
+            Operation op(OperationType::RESIZE);
+            const size_t x = args[1].find('x');
+            if (x == std::string::npos)
+                throw specError(stage, "size must be WIDTHxHEIGHT");
+            op.width = parseInt(stage, args[1].substr(0, x), 65535);
+            op.height = parseInt(stage, args[1].substr(x + 1), 65535);
+            if (op.width == 0 || op.height == 0)
+                throw specError(stage, "size must not be 0");
+
+            if (args.size() > 2) {
+                if (args[2] == "nearest") {
+                    op.method = ResizeMethod::NEARSET_NEIGHBOR;
+                } else if (args[2] == "bilinear") {
+                    op.method = ResizeMethod::BILINEAR;
+                } else {
+                    throw specError(stage, "unknown resize method '" + args[2] + "'");
+                }
+            }
+            return op;
+        }
+
+        if (name == "flip") {
+            expectArgs(stage, args, 0, 1);
+            Operation op(OperationType::FLIP);
+            if (args.size() > 1) {
+                if (args[1] == "horizontal" || args[1] == "h") {
+                    op.orientation = Orientation::HORIZONTAL;
+                } else if (args[1] == "vertical" || args[1] == "v") {
+                    op.orientation = Orientation::VERTICAL;
+                } else {
+                    throw specError(stage, "unknown orientation '" + args[1] + "'");
+                }
+            }
+            return op;
+        }
+
+        if (name == "convolution") {
+            expectArgs(stage, args, 1, 2);
+            Operation op(OperationType::CONVOLUTION);
+            std::vector<std::string> values;
+            str_split(args[1], ',', values);
+            if (values.size() != op.kernel.size())
+                throw specError(stage, "the kernel must have 9 values");
+            for (size_t i = 0; i < values.size(); i++) {
+                op.kernel[i] = parseFloat(stage, values[i]);
+            }
+            op.value = args.size() > 2 ? parseFloat(stage, args[2]) : 1;
+            return op;
+        }
+
+        if (name == "grayscale" || name == "invert" || name == "remove_alpha") {
+            expectArgs(stage, args, 0, 0);
+            if (name == "grayscale")
+                return Operation(OperationType::GRAYSCALE);
+            if (name == "invert")
+                return Operation(OperationType::INVERT);
+            return Operation(OperationType::REMOVE_ALPHA_CHANNEL);
+        }
+
+        if (name == "contrast") {
+            expectArgs(stage, args, 1, 1);
+            Operation op(OperationType::CONTRAST);
+            op.value = parseFloat(stage, args[1]);
+            return op;
+        }
+
+        if (name == "add_alpha") {
+            expectArgs(stage, args, 0, 1);
+            Operation op(OperationType::ADD_ALPHA_CHANNEL);
+            op.value = args.size() > 1 ? parseInt(stage, args[1], 255) : 255;
+            return op;
+        }
+
+        throw specError(stage, "unknown operation '" + name + "'");
+    }
+
+    // ----------------------------------------------------------------------------
+    Pipeline Pipeline::parse(const std::string& spec) {
+        Pipeline pipeline;
+
+        std::vector<std::string> stages;
+        str_split(spec, '|', stages);
+        if (!spec.empty() && spec.back() == '|') {
+            stages.push_back("");
+        }
+
+        for (size_t i = 0; i < stages.size(); i++) {
+            const std::string& stage = stages[i];
+            std::vector<std::string> args;
+            str_split(stage, ':', args);
+            if (args.empty() || args[0].empty())
+                throw specError(stage, "empty operation");
+            if (stage.back() == ':')
+                throw specError(stage, "empty argument");
+
+            if (args[0] == "jpeg" || args[0] == "png") {
+                if (i != stages.size() - 1)
+                    throw specError(stage, "the encoder must be the last stage");
+                parseEncoder(stage, args, pipeline.encoding);
+            } else {
+                pipeline.add(parseOperation(stage, args));
+            }
+        }
+
+        return pipeline;
+    }
+
+    // ----------------------------------------------------------------------------
+    std::string Pipeline::toString() const {
+        std::stringstream ss;
+        for (size_t i = 0; i < this->ops.size(); i++) {
+            const Operation& op = this->ops[i];
+            if (i > 0) {
+                ss << "|";
+            }
+
+            switch (op.type) {
+                case OperationType::RESIZE:
+                    ss << "resize:" << op.width << "x" << op.height << ":"
+                       << (op.method == ResizeMethod::NEARSET_NEIGHBOR ? "nearest" : "bilinear");
+                    break;
+                case OperationType::FLIP:
+                    ss << "flip:"
+                       << (op.orientation == Orientation::VERTICAL ? "vertical" : "horizontal");
+                    break;
+                case OperationType::CONVOLUTION:
+                    ss << "convolution:";
+                    for (size_t k = 0; k < op.kernel.size(); k++) {
+                        ss << (k > 0 ? "," : "") << formatFloat(op.kernel[k]);
+                    }
+                    ss << ":" << formatFloat(op.value);
+                    break;
+                case OperationType::GRAYSCALE:
+                    ss << "grayscale";
+                    break;
+                case OperationType::INVERT:
+                    ss << "invert";
+                    break;
+                case OperationType::ADD_ALPHA_CHANNEL:
+                    ss << "add_alpha:" << (u32)op.value;
+                    break;
+                case OperationType::REMOVE_ALPHA_CHANNEL:
+                    ss << "remove_alpha";
+                    break;
+                case OperationType::CONTRAST:
+                    ss << "contrast:" << formatFloat(op.value);
+                    break;
+                case OperationType::POINT:
+                    throw PixlException("Lookup tables can't be written as a spec");
+            }
+        }
+
+        const Encoding& encoding = this->encoding;
+        if (encoding.format != ImageFormat::AUTO) {
+            ss << (this->ops.empty() ? "" : "|");
+        }
+        if (encoding.format == ImageFormat::PNG) {
+            ss << "png";
+        } else if (encoding.format == ImageFormat::JPEG) {
+            ss << "jpeg:q=" << encoding.quality << ":";
+            switch (encoding.subsampling) {
+                case ChromaSubsampling::YUV444: ss << "444"; break;
+                case ChromaSubsampling::YUV422: ss << "422"; break;
+                case ChromaSubsampling::YUV420: ss << "420"; break;
+                case ChromaSubsampling::GRAY: ss << "gray"; break;
+            }
+        }
+
+        return ss.str();
+    }
+}
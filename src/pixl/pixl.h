@@ -22,8 +22,22 @@
 #ifdef __cplusplus
 #include "types.h"
 #include "errors.h"
+#include "fixed.h"
 #include "image.h"
 #include "io.h"
+#include "pipeline.h"
+#include "pipe.h"
+#include "incremental.h"
+#include "preview.h"
+#include "deadline.h"
+#include "batch.h"
+#include "async.h"
+#include "cache.h"
+#include "threads.h"
+#include "cpu.h"
+#include "verify.h"
+#include "context.h"
+#include "numa.h"
 #endif
 
 // ----------------------------------------------------------------------------
@@ -47,8 +61,15 @@ struct CPixlImage {
 typedef struct CPixlImage CPixlImage;
 
 CPixlImage* pixl_load_image(const char* path);
+CPixlImage* pixl_load_image_for_size(const char* path,
+                                     unsigned int min_width,
+                                     unsigned int min_height);
 void pixl_destroy_image(CPixlImage* image);
 void pixl_save_image(CPixlImage* image, const char* path, int quality);
+int pixl_save_image_budget(CPixlImage* image,
+                           const char* path,
+                           unsigned long max_bytes,
+                           float min_ssim);
 
 void pixl_resize(CPixlImage* image, unsigned int width, unsigned int height, int method);
 void pixl_flip(CPixlImage* image, int orientation);
@@ -59,6 +80,33 @@ void pixl_add_alpha_channel(CPixlImage* image, unsigned char default_value);
 void pixl_remove_alpha_channel(CPixlImage* image);
 void pixl_contrast(CPixlImage* image, float contrast);
 
+int pixl_jpeg_quality(const char* path);
+void pixl_jpeg_requantize(const char* input, const char* output, int quality);
+
+void pixl_set_threads(unsigned int threads);
+void pixl_set_thread_pinning(int pin);
+
+// Pipelines are described by a spec, see pixl::Pipeline::parse.
+struct CPixlPipeline {
+    void* __handle;
+};
+typedef struct CPixlPipeline CPixlPipeline;
+
+// Returns NULL if the spec is invalid, pixl_last_error() tells why.
+CPixlPipeline* pixl_pipeline_parse(const char* spec);
+void pixl_pipeline_destroy(CPixlPipeline* pipeline);
+// Executes the pipeline on the image. Returns 0 on success, -1 on error.
+int pixl_pipeline_execute(CPixlPipeline* pipeline, CPixlImage* image);
+// Reads input, executes the pipeline and writes output. Returns 0 on success, -1 on error.
+int pixl_pipeline_run(CPixlPipeline* pipeline, const char* input, const char* output);
+// Caches results of pixl_pipeline_run in directory. Returns 0 on success, -1 on error.
+int pixl_pipeline_set_cache(CPixlPipeline* pipeline,
+                            const char* directory,
+                            unsigned long max_bytes);
+
+// Message of the last error of the calling thread.
+const char* pixl_last_error(void);
+
 #ifdef __cplusplus
 }
 #endif
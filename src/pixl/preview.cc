@@ -0,0 +1,116 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <algorithm>
+#include <cmath>
+
+#include "preview.h"
+#include "errors.h"
+#include "image.h"
+#include "io.h"
+#include "types.h"
+
+namespace pixl {
+
+    // ----------------------------------------------------------------------------
+    static u32 scaled(u32 size, f32 scale) {
+        return std::max((u32)std::lround(size * scale), 1u);
+    }
+
+    // ----------------------------------------------------------------------------
+    // Downscales the image in place to fit into maxWidth x maxHeight, keeping the aspect ratio.
+    static void fit(Image* image, u32 maxWidth, u32 maxHeight) {
+        const f32 scale = std::min({1.0f, (f32)maxWidth / image->width,
+                                    (f32)maxHeight / image->height});
+        if (scale < 1) {
+            image->resize(scaled(image->width, scale), scaled(image->height, scale));
+        }
+    }
+
+    // ----------------------------------------------------------------------------
+    Preview::Preview(const Image* input, u32 maxWidth, u32 maxHeight) : input(input) {
+        this->proxyImage.reset(new Image(input));
+        fit(this->proxyImage.get(), maxWidth, maxHeight);
+        this->scaleXValue = (f32)this->proxyImage->width / input->width;
+        this->scaleYValue = (f32)this->proxyImage->height / input->height;
+    }
+
+    // ----------------------------------------------------------------------------
+    Preview::Preview(const char* path, u32 maxWidth, u32 maxHeight) : path(path) {
+        // the decoder may only reduce the size as far as the proxy allows
+        this->proxyImage.reset(read(path, maxWidth, maxHeight));
+        if (!this->proxyImage)
+            throw PixlException("Failed to read image");
+
+        // the full size, without decoding it again
+        u32 width = this->proxyImage->width;
+        u32 height = this->proxyImage->height;
+        if (is_jpg(path)) {
+            JpegTurboReader reader;
+            reader.readSize(path, &width, &height);
+        }
+
+        fit(this->proxyImage.get(), maxWidth, maxHeight);
+        this->scaleXValue = (f32)this->proxyImage->width / width;
+        this->scaleYValue = (f32)this->proxyImage->height / height;
+    }
+
+    // ----------------------------------------------------------------------------
+    Pipeline Preview::adapt(const Pipeline& pipeline, f32 scaleX, f32 scaleY) {
+        Pipeline adapted;
+        adapted.encoding = pipeline.encoding;
+        adapted.bandHeight = pipeline.bandHeight;
+
+        for (Operation op : pipeline.operations()) {
+            if (op.type == OperationType::RESIZE) {
+                op.width = scaled(op.width, scaleX);
+                op.height = scaled(op.height, scaleY);
+            } else if (op.type == OperationType::CONVOLUTION) {
+                // blend with the identity, so the kernel does less per proxy pixel
+                const f32 strength = std::min(1.0f, (scaleX + scaleY) / 2);
+                for (u32 i = 0; i < op.kernel.size(); i++) {
+                    op.kernel[i] *= strength * op.value;
+                }
+                op.kernel[4] += 1 - strength;
+                op.value = 1;
+            }
+            adapted.add(op);
+        }
+
+        return adapted;
+    }
+
+    // ----------------------------------------------------------------------------
+    Image* Preview::render(const Pipeline& pipeline) const {
+        Image* image = new Image(this->proxyImage.get());
+        adapt(pipeline, this->scaleXValue, this->scaleYValue).execute(image);
+        return image;
+    }
+
+    // ----------------------------------------------------------------------------
+    Image* Preview::commit(const Pipeline& pipeline) const {
+        if (this->input != nullptr) {
+            Image* image = new Image(this->input);
+            pipeline.execute(image);
+            return image;
+        }
+
+        Image* image = pipeline.execute(this->path.c_str());
+        if (image == nullptr)
+            throw PixlException("Failed to read image");
+        return image;
+    }
+}
@@ -0,0 +1,71 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef PIXL_PREVIEW_H
+#define PIXL_PREVIEW_H
+
+#include <memory>
+#include <string>
+
+#include "image.h"
+#include "pipeline.h"
+#include "types.h"
+
+namespace pixl {
+
+    // Fast previews of pipelines on a downscaled proxy of the input, e.g. while tuning
+    // parameters, and the full resolution result once they are final.
+    //
+    // The proxy is created once and reused by every render(). Pipelines are adapted to the
+    // proxy: resizes target the scaled size and convolutions are weakened by the scale,
+    // because their 3x3 kernel covers a larger part of the image on the proxy. The preview
+    // is thus close to a downscaled full resolution result, but not exactly the same.
+    class Preview {
+    public:
+        // Proxy of an image that fits into maxWidth x maxHeight. The input must stay alive
+        // as long as the preview is used.
+        Preview(const Image* input, u32 maxWidth, u32 maxHeight);
+
+        // Proxy of the image at path, decoded at a reduced size where possible.
+        // Throws a PixlException if the image can't be read.
+        Preview(const char* path, u32 maxWidth, u32 maxHeight);
+
+        // Executes the pipeline on the proxy. The caller is responsible for deleting the image.
+        Image* render(const Pipeline& pipeline) const;
+
+        // Executes the pipeline on the full resolution input. The caller is responsible for
+        // deleting the image.
+        Image* commit(const Pipeline& pipeline) const;
+
+        // The pipeline as it's executed on a proxy that is scaleX/scaleY of the input.
+        static Pipeline adapt(const Pipeline& pipeline, f32 scaleX, f32 scaleY);
+
+        const Image* proxy() const { return this->proxyImage.get(); }
+
+        // Size of the proxy relative to the input.
+        f32 scaleX() const { return this->scaleXValue; }
+        f32 scaleY() const { return this->scaleYValue; }
+
+    private:
+        const Image* input = nullptr;
+        std::string path;
+        std::unique_ptr<Image> proxyImage;
+        f32 scaleXValue = 1;
+        f32 scaleYValue = 1;
+    };
+}
+
+#endif
@@ -0,0 +1,527 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Portable vectors for the kernels, so a kernel is written once and compiled for every
+// instruction set (see kernels_impl.h).
+//
+// The backend follows the flags of the including file: AVX-512BW (64 lanes of u8), AVX2 (32
+// lanes), SSE2 with the SSSE3/SSE4.1 instructions where available, NEON on AArch64 (16 lanes
+// each) and plain C++ arrays everywhere else. All backends return the same results to the
+// bit. The types only wrap the native registers and everything is inline, so the compiler
+// sees the same intrinsics it would for hand written code.
+//
+// Like kernels_impl.h, this must be included inside a namespace that is unique per set of
+// compiler flags: PIXL_KERNELS_NAMESPACE.
+//
+// Vectors:
+//     U8     LANES   x u8
+//     I16    LANES/2 x i16
+//     F32    LANES/4 x f32
+//     Block  16      x u8, for shuffles across the bytes of pixels
+//
+// Lanes are always in memory order, e.g. widen_lo() returns the first half of the u8 lanes.
+// I16 arithmetic wraps around, store_u16() keeps the bits.
+
+#ifndef PIXL_KERNELS_NAMESPACE
+#error "simd.h needs PIXL_KERNELS_NAMESPACE"
+#endif
+
+#if defined(__AVX512BW__)
+#define PIXL_SIMD_AVX512
+#include <immintrin.h>
+#elif defined(__AVX2__)
+#define PIXL_SIMD_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#define PIXL_SIMD_SSE2
+#include <emmintrin.h>
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define PIXL_SIMD_NEON
+#include <arm_neon.h>
+#else
+#define PIXL_SIMD_SCALAR
+#endif
+
+#include "types.h"
+
+namespace pixl {
+    namespace PIXL_KERNELS_NAMESPACE {
+        namespace simd {
+
+#if defined(PIXL_SIMD_AVX512)
+
+            static const char* const BACKEND = "avx512";
+            static const u32 LANES = 64;
+
+            struct U8 { __m512i v; };
+            struct I16 { __m512i v; };
+            struct F32 { __m512 v; };
+            struct Block { __m128i v; };
+
+            // packs work per 128 bit lane, this restores the order of the 64 bit halves
+            inline __m512i unpackLanes(__m512i a) {
+                return _mm512_permutexvar_epi64(_mm512_setr_epi64(0, 2, 4, 6, 1, 3, 5, 7), a);
+            }
+
+            inline U8 load(const u8* p) { return {_mm512_loadu_si512((const void*)p)}; }
+            inline void store(u8* p, U8 a) { _mm512_storeu_si512((void*)p, a.v); }
+            inline void store_u16(u16* p, I16 a) { _mm512_storeu_si512((void*)p, a.v); }
+            inline U8 set1(u8 value) { return {_mm512_set1_epi8((char)value)}; }
+            inline I16 set1_i16(i16 value) { return {_mm512_set1_epi16(value)}; }
+            inline F32 set1_f32(f32 value) { return {_mm512_set1_ps(value)}; }
+
+            inline U8 adds(U8 a, U8 b) { return {_mm512_adds_epu8(a.v, b.v)}; }
+            inline U8 subs(U8 a, U8 b) { return {_mm512_subs_epu8(a.v, b.v)}; }
+            inline U8 bit_and(U8 a, U8 b) { return {_mm512_and_si512(a.v, b.v)}; }
+            inline U8 bit_or(U8 a, U8 b) { return {_mm512_or_si512(a.v, b.v)}; }
+            inline U8 bit_xor(U8 a, U8 b) { return {_mm512_xor_si512(a.v, b.v)}; }
+            inline U8 select(U8 mask, U8 a, U8 b) {
+                // the top bit of each byte, like blendv
+                return {_mm512_mask_blend_epi8(_mm512_movepi8_mask(mask.v), b.v, a.v)};
+            }
+            inline bool all_set(U8 a) {
+                return _mm512_cmpeq_epi8_mask(a.v, _mm512_set1_epi8(-1)) == ~(__mmask64)0;
+            }
+
+            inline I16 widen_lo(U8 a) {
+                return {_mm512_cvtepu8_epi16(_mm512_castsi512_si256(a.v))};
+            }
+            inline I16 widen_hi(U8 a) {
+                return {_mm512_cvtepu8_epi16(_mm512_extracti64x4_epi64(a.v, 1))};
+            }
+            inline U8 narrow(I16 lo, I16 hi) {
+                return {unpackLanes(_mm512_packus_epi16(lo.v, hi.v))};
+            }
+
+            inline I16 add(I16 a, I16 b) { return {_mm512_add_epi16(a.v, b.v)}; }
+            inline I16 sub(I16 a, I16 b) { return {_mm512_sub_epi16(a.v, b.v)}; }
+            inline I16 mul(I16 a, I16 b) { return {_mm512_mullo_epi16(a.v, b.v)}; }
+            inline I16 mulhi(I16 a, I16 b) { return {_mm512_mulhi_epi16(a.v, b.v)}; }
+
+            inline F32 to_f32_lo(I16 a) {
+                return {_mm512_cvtepi32_ps(_mm512_cvtepi16_epi32(_mm512_castsi512_si256(a.v)))};
+            }
+            inline F32 to_f32_hi(I16 a) {
+                const __m256i hi = _mm512_extracti64x4_epi64(a.v, 1);
+                return {_mm512_cvtepi32_ps(_mm512_cvtepi16_epi32(hi))};
+            }
+            inline I16 to_i16(F32 lo, F32 hi) {
+                return {unpackLanes(
+                    _mm512_packs_epi32(_mm512_cvttps_epi32(lo.v), _mm512_cvttps_epi32(hi.v)))};
+            }
+
+            inline F32 add(F32 a, F32 b) { return {_mm512_add_ps(a.v, b.v)}; }
+            inline F32 sub(F32 a, F32 b) { return {_mm512_sub_ps(a.v, b.v)}; }
+            inline F32 mul(F32 a, F32 b) { return {_mm512_mul_ps(a.v, b.v)}; }
+            inline F32 min(F32 a, F32 b) { return {_mm512_min_ps(a.v, b.v)}; }
+            inline F32 max(F32 a, F32 b) { return {_mm512_max_ps(a.v, b.v)}; }
+
+            inline Block load_block(const u8* p) { return {_mm_loadu_si128((const __m128i*)p)}; }
+            inline void store_block(u8* p, Block a) { _mm_storeu_si128((__m128i*)p, a.v); }
+            inline Block block_or(Block a, Block b) { return {_mm_or_si128(a.v, b.v)}; }
+            inline Block shuffle(Block a, Block indices) {
+                return {_mm_shuffle_epi8(a.v, indices.v)};
+            }
+
+#elif defined(PIXL_SIMD_AVX2)
+
+            static const char* const BACKEND = "avx2";
+            static const u32 LANES = 32;
+
+            struct U8 { __m256i v; };
+            struct I16 { __m256i v; };
+            struct F32 { __m256 v; };
+            struct Block { __m128i v; };
+
+            inline U8 load(const u8* p) { return {_mm256_loadu_si256((const __m256i*)p)}; }
+            inline void store(u8* p, U8 a) { _mm256_storeu_si256((__m256i*)p, a.v); }
+            inline void store_u16(u16* p, I16 a) { _mm256_storeu_si256((__m256i*)p, a.v); }
+            inline U8 set1(u8 value) { return {_mm256_set1_epi8((char)value)}; }
+            inline I16 set1_i16(i16 value) { return {_mm256_set1_epi16(value)}; }
+            inline F32 set1_f32(f32 value) { return {_mm256_set1_ps(value)}; }
+
+            inline U8 adds(U8 a, U8 b) { return {_mm256_adds_epu8(a.v, b.v)}; }
+            inline U8 subs(U8 a, U8 b) { return {_mm256_subs_epu8(a.v, b.v)}; }
+            inline U8 bit_and(U8 a, U8 b) { return {_mm256_and_si256(a.v, b.v)}; }
+            inline U8 bit_or(U8 a, U8 b) { return {_mm256_or_si256(a.v, b.v)}; }
+            inline U8 bit_xor(U8 a, U8 b) { return {_mm256_xor_si256(a.v, b.v)}; }
+            inline U8 select(U8 mask, U8 a, U8 b) { return {_mm256_blendv_epi8(b.v, a.v, mask.v)}; }
+            inline bool all_set(U8 a) {
+                return _mm256_movemask_epi8(_mm256_cmpeq_epi8(a.v, _mm256_set1_epi8(-1))) == -1;
+            }
+
+            inline I16 widen_lo(U8 a) { return {_mm256_cvtepu8_epi16(_mm256_castsi256_si128(a.v))}; }
+            inline I16 widen_hi(U8 a) {
+                return {_mm256_cvtepu8_epi16(_mm256_extracti128_si256(a.v, 1))};
+            }
+            inline U8 narrow(I16 lo, I16 hi) {
+                // packs work per 128 bit half, the permute restores the order
+                return {_mm256_permute4x64_epi64(_mm256_packus_epi16(lo.v, hi.v), 0xD8)};
+            }
+
+            inline I16 add(I16 a, I16 b) { return {_mm256_add_epi16(a.v, b.v)}; }
+            inline I16 sub(I16 a, I16 b) { return {_mm256_sub_epi16(a.v, b.v)}; }
+            inline I16 mul(I16 a, I16 b) { return {_mm256_mullo_epi16(a.v, b.v)}; }
+            inline I16 mulhi(I16 a, I16 b) { return {_mm256_mulhi_epi16(a.v, b.v)}; }
+
+            inline F32 to_f32_lo(I16 a) {
+                return {_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(a.v)))};
+            }
+            inline F32 to_f32_hi(I16 a) {
+                return {_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(a.v, 1)))};
+            }
+            inline I16 to_i16(F32 lo, F32 hi) {
+                const __m256i packed =
+                    _mm256_packs_epi32(_mm256_cvttps_epi32(lo.v), _mm256_cvttps_epi32(hi.v));
+                return {_mm256_permute4x64_epi64(packed, 0xD8)};
+            }
+
+            inline F32 add(F32 a, F32 b) { return {_mm256_add_ps(a.v, b.v)}; }
+            inline F32 sub(F32 a, F32 b) { return {_mm256_sub_ps(a.v, b.v)}; }
+            inline F32 mul(F32 a, F32 b) { return {_mm256_mul_ps(a.v, b.v)}; }
+            inline F32 min(F32 a, F32 b) { return {_mm256_min_ps(a.v, b.v)}; }
+            inline F32 max(F32 a, F32 b) { return {_mm256_max_ps(a.v, b.v)}; }
+
+            inline Block load_block(const u8* p) { return {_mm_loadu_si128((const __m128i*)p)}; }
+            inline void store_block(u8* p, Block a) { _mm_storeu_si128((__m128i*)p, a.v); }
+            inline Block block_or(Block a, Block b) { return {_mm_or_si128(a.v, b.v)}; }
+            inline Block shuffle(Block a, Block indices) {
+                return {_mm_shuffle_epi8(a.v, indices.v)};
+            }
+
+#elif defined(PIXL_SIMD_SSE2)
+
+#if defined(__SSE4_1__)
+            static const char* const BACKEND = "sse4.1";
+#else
+            static const char* const BACKEND = "sse2";
+#endif
+            static const u32 LANES = 16;
+
+            struct U8 { __m128i v; };
+            struct I16 { __m128i v; };
+            struct F32 { __m128 v; };
+            struct Block { __m128i v; };
+
+            inline U8 load(const u8* p) { return {_mm_loadu_si128((const __m128i*)p)}; }
+            inline void store(u8* p, U8 a) { _mm_storeu_si128((__m128i*)p, a.v); }
+            inline void store_u16(u16* p, I16 a) { _mm_storeu_si128((__m128i*)p, a.v); }
+            inline U8 set1(u8 value) { return {_mm_set1_epi8((char)value)}; }
+            inline I16 set1_i16(i16 value) { return {_mm_set1_epi16(value)}; }
+            inline F32 set1_f32(f32 value) { return {_mm_set1_ps(value)}; }
+
+            inline U8 adds(U8 a, U8 b) { return {_mm_adds_epu8(a.v, b.v)}; }
+            inline U8 subs(U8 a, U8 b) { return {_mm_subs_epu8(a.v, b.v)}; }
+            inline U8 bit_and(U8 a, U8 b) { return {_mm_and_si128(a.v, b.v)}; }
+            inline U8 bit_or(U8 a, U8 b) { return {_mm_or_si128(a.v, b.v)}; }
+            inline U8 bit_xor(U8 a, U8 b) { return {_mm_xor_si128(a.v, b.v)}; }
+            inline U8 select(U8 mask, U8 a, U8 b) {
+#if defined(__SSE4_1__)
+                return {_mm_blendv_epi8(b.v, a.v, mask.v)};
+#else
+                return {_mm_or_si128(_mm_and_si128(mask.v, a.v), _mm_andnot_si128(mask.v, b.v))};
+#endif
+            }
+            inline bool all_set(U8 a) {
+                return _mm_movemask_epi8(_mm_cmpeq_epi8(a.v, _mm_set1_epi8(-1))) == 0xFFFF;
+            }
+
+            inline I16 widen_lo(U8 a) { return {_mm_unpacklo_epi8(a.v, _mm_setzero_si128())}; }
+            inline I16 widen_hi(U8 a) { return {_mm_unpackhi_epi8(a.v, _mm_setzero_si128())}; }
+            inline U8 narrow(I16 lo, I16 hi) { return {_mm_packus_epi16(lo.v, hi.v)}; }
+
+            inline I16 add(I16 a, I16 b) { return {_mm_add_epi16(a.v, b.v)}; }
+            inline I16 sub(I16 a, I16 b) { return {_mm_sub_epi16(a.v, b.v)}; }
+            inline I16 mul(I16 a, I16 b) { return {_mm_mullo_epi16(a.v, b.v)}; }
+            inline I16 mulhi(I16 a, I16 b) { return {_mm_mulhi_epi16(a.v, b.v)}; }
+
+            inline F32 to_f32_lo(I16 a) {
+#if defined(__SSE4_1__)
+                return {_mm_cvtepi32_ps(_mm_cvtepi16_epi32(a.v))};
+#else
+                return {_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(a.v, a.v), 16))};
+#endif
+            }
+            inline F32 to_f32_hi(I16 a) {
+                return {_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(a.v, a.v), 16))};
+            }
+            inline I16 to_i16(F32 lo, F32 hi) {
+                return {_mm_packs_epi32(_mm_cvttps_epi32(lo.v), _mm_cvttps_epi32(hi.v))};
+            }
+
+            inline F32 add(F32 a, F32 b) { return {_mm_add_ps(a.v, b.v)}; }
+            inline F32 sub(F32 a, F32 b) { return {_mm_sub_ps(a.v, b.v)}; }
+            inline F32 mul(F32 a, F32 b) { return {_mm_mul_ps(a.v, b.v)}; }
+            inline F32 min(F32 a, F32 b) { return {_mm_min_ps(a.v, b.v)}; }
+            inline F32 max(F32 a, F32 b) { return {_mm_max_ps(a.v, b.v)}; }
+
+            inline Block load_block(const u8* p) { return {_mm_loadu_si128((const __m128i*)p)}; }
+            inline void store_block(u8* p, Block a) { _mm_storeu_si128((__m128i*)p, a.v); }
+            inline Block block_or(Block a, Block b) { return {_mm_or_si128(a.v, b.v)}; }
+            inline Block shuffle(Block a, Block indices) {
+#if defined(__SSSE3__)
+                return {_mm_shuffle_epi8(a.v, indices.v)};
+#else
+                u8 bytes[16], order[16], result[16];
+                _mm_storeu_si128((__m128i*)bytes, a.v);
+                _mm_storeu_si128((__m128i*)order, indices.v);
+                for (u32 i = 0; i < 16; i++) {
+                    result[i] = (order[i] & 0x80) ? 0 : bytes[order[i] & 15];
+                }
+                return {_mm_loadu_si128((const __m128i*)result)};
+#endif
+            }
+
+#elif defined(PIXL_SIMD_NEON)
+
+            static const char* const BACKEND = "neon";
+            static const u32 LANES = 16;
+
+            struct U8 { uint8x16_t v; };
+            struct I16 { int16x8_t v; };
+            struct F32 { float32x4_t v; };
+            struct Block { uint8x16_t v; };
+
+            inline U8 load(const u8* p) { return {vld1q_u8(p)}; }
+            inline void store(u8* p, U8 a) { vst1q_u8(p, a.v); }
+            inline void store_u16(u16* p, I16 a) { vst1q_u16(p, vreinterpretq_u16_s16(a.v)); }
+            inline U8 set1(u8 value) { return {vdupq_n_u8(value)}; }
+            inline I16 set1_i16(i16 value) { return {vdupq_n_s16(value)}; }
+            inline F32 set1_f32(f32 value) { return {vdupq_n_f32(value)}; }
+
+            inline U8 adds(U8 a, U8 b) { return {vqaddq_u8(a.v, b.v)}; }
+            inline U8 subs(U8 a, U8 b) { return {vqsubq_u8(a.v, b.v)}; }
+            inline U8 bit_and(U8 a, U8 b) { return {vandq_u8(a.v, b.v)}; }
+            inline U8 bit_or(U8 a, U8 b) { return {vorrq_u8(a.v, b.v)}; }
+            inline U8 bit_xor(U8 a, U8 b) { return {veorq_u8(a.v, b.v)}; }
+            inline U8 select(U8 mask, U8 a, U8 b) { return {vbslq_u8(mask.v, a.v, b.v)}; }
+            inline bool all_set(U8 a) { return vminvq_u8(a.v) == 255; }
+
+            inline I16 widen_lo(U8 a) {
+                return {vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(a.v)))};
+            }
+            inline I16 widen_hi(U8 a) {
+                return {vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(a.v)))};
+            }
+            inline U8 narrow(I16 lo, I16 hi) {
+                return {vcombine_u8(vqmovun_s16(lo.v), vqmovun_s16(hi.v))};
+            }
+
+            inline I16 add(I16 a, I16 b) { return {vaddq_s16(a.v, b.v)}; }
+            inline I16 sub(I16 a, I16 b) { return {vsubq_s16(a.v, b.v)}; }
+            inline I16 mul(I16 a, I16 b) { return {vmulq_s16(a.v, b.v)}; }
+            inline I16 mulhi(I16 a, I16 b) {
+                const int32x4_t lo = vmull_s16(vget_low_s16(a.v), vget_low_s16(b.v));
+                const int32x4_t hi = vmull_s16(vget_high_s16(a.v), vget_high_s16(b.v));
+                return {vcombine_s16(vshrn_n_s32(lo, 16), vshrn_n_s32(hi, 16))};
+            }
+
+            inline F32 to_f32_lo(I16 a) { return {vcvtq_f32_s32(vmovl_s16(vget_low_s16(a.v)))}; }
+            inline F32 to_f32_hi(I16 a) { return {vcvtq_f32_s32(vmovl_s16(vget_high_s16(a.v)))}; }
+            inline I16 to_i16(F32 lo, F32 hi) {
+                return {vcombine_s16(vqmovn_s32(vcvtq_s32_f32(lo.v)),
+                                     vqmovn_s32(vcvtq_s32_f32(hi.v)))};
+            }
+
+            inline F32 add(F32 a, F32 b) { return {vaddq_f32(a.v, b.v)}; }
+            inline F32 sub(F32 a, F32 b) { return {vsubq_f32(a.v, b.v)}; }
+            inline F32 mul(F32 a, F32 b) { return {vmulq_f32(a.v, b.v)}; }
+            inline F32 min(F32 a, F32 b) { return {vminq_f32(a.v, b.v)}; }
+            inline F32 max(F32 a, F32 b) { return {vmaxq_f32(a.v, b.v)}; }
+
+            inline Block load_block(const u8* p) { return {vld1q_u8(p)}; }
+            inline void store_block(u8* p, Block a) { vst1q_u8(p, a.v); }
+            inline Block block_or(Block a, Block b) { return {vorrq_u8(a.v, b.v)}; }
+            inline Block shuffle(Block a, Block indices) { return {vqtbl1q_u8(a.v, indices.v)}; }
+
+#else
+
+            static const char* const BACKEND = "scalar";
+            static const u32 LANES = 16;
+
+            struct U8 { u8 v[16]; };
+            struct I16 { i16 v[8]; };
+            struct F32 { f32 v[4]; };
+            struct Block { u8 v[16]; };
+
+            inline U8 load(const u8* p) {
+                U8 r;
+                for (u32 i = 0; i < 16; i++) r.v[i] = p[i];
+                return r;
+            }
+            inline void store(u8* p, U8 a) {
+                for (u32 i = 0; i < 16; i++) p[i] = a.v[i];
+            }
+            inline void store_u16(u16* p, I16 a) {
+                for (u32 i = 0; i < 8; i++) p[i] = (u16)a.v[i];
+            }
+            inline U8 set1(u8 value) {
+                U8 r;
+                for (u32 i = 0; i < 16; i++) r.v[i] = value;
+                return r;
+            }
+            inline I16 set1_i16(i16 value) {
+                I16 r;
+                for (u32 i = 0; i < 8; i++) r.v[i] = value;
+                return r;
+            }
+            inline F32 set1_f32(f32 value) {
+                F32 r;
+                for (u32 i = 0; i < 4; i++) r.v[i] = value;
+                return r;
+            }
+
+            inline U8 adds(U8 a, U8 b) {
+                U8 r;
+                for (u32 i = 0; i < 16; i++) {
+                    const u32 sum = (u32)a.v[i] + b.v[i];
+                    r.v[i] = (u8)(sum > 255 ? 255 : sum);
+                }
+                return r;
+            }
+            inline U8 subs(U8 a, U8 b) {
+                U8 r;
+                for (u32 i = 0; i < 16; i++) r.v[i] = a.v[i] > b.v[i] ? a.v[i] - b.v[i] : 0;
+                return r;
+            }
+            inline U8 bit_and(U8 a, U8 b) {
+                for (u32 i = 0; i < 16; i++) a.v[i] &= b.v[i];
+                return a;
+            }
+            inline U8 bit_or(U8 a, U8 b) {
+                for (u32 i = 0; i < 16; i++) a.v[i] |= b.v[i];
+                return a;
+            }
+            inline U8 bit_xor(U8 a, U8 b) {
+                for (u32 i = 0; i < 16; i++) a.v[i] ^= b.v[i];
+                return a;
+            }
+            inline U8 select(U8 mask, U8 a, U8 b) {
+                for (u32 i = 0; i < 16; i++) a.v[i] = (a.v[i] & mask.v[i]) | (b.v[i] & ~mask.v[i]);
+                return a;
+            }
+            inline bool all_set(U8 a) {
+                u8 all = 255;
+                for (u32 i = 0; i < 16; i++) all &= a.v[i];
+                return all == 255;
+            }
+
+            inline I16 widen_lo(U8 a) {
+                I16 r;
+                for (u32 i = 0; i < 8; i++) r.v[i] = a.v[i];
+                return r;
+            }
+            inline I16 widen_hi(U8 a) {
+                I16 r;
+                for (u32 i = 0; i < 8; i++) r.v[i] = a.v[i + 8];
+                return r;
+            }
+            inline U8 narrow(I16 lo, I16 hi) {
+                U8 r;
+                for (u32 i = 0; i < 16; i++) {
+                    const i16 value = i < 8 ? lo.v[i] : hi.v[i - 8];
+                    r.v[i] = (u8)(value < 0 ? 0 : (value > 255 ? 255 : value));
+                }
+                return r;
+            }
+
+            inline I16 add(I16 a, I16 b) {
+                for (u32 i = 0; i < 8; i++) a.v[i] = (i16)(a.v[i] + b.v[i]);
+                return a;
+            }
+            inline I16 sub(I16 a, I16 b) {
+                for (u32 i = 0; i < 8; i++) a.v[i] = (i16)(a.v[i] - b.v[i]);
+                return a;
+            }
+            inline I16 mul(I16 a, I16 b) {
+                for (u32 i = 0; i < 8; i++) a.v[i] = (i16)(a.v[i] * b.v[i]);
+                return a;
+            }
+            inline I16 mulhi(I16 a, I16 b) {
+                for (u32 i = 0; i < 8; i++) a.v[i] = (i16)(((i32)a.v[i] * b.v[i]) >> 16);
+                return a;
+            }
+
+            inline F32 to_f32_lo(I16 a) {
+                F32 r;
+                for (u32 i = 0; i < 4; i++) r.v[i] = a.v[i];
+                return r;
+            }
+            inline F32 to_f32_hi(I16 a) {
+                F32 r;
+                for (u32 i = 0; i < 4; i++) r.v[i] = a.v[i + 4];
+                return r;
+            }
+            inline I16 to_i16(F32 lo, F32 hi) {
+                I16 r;
+                for (u32 i = 0; i < 8; i++) {
+                    const f32 value = i < 4 ? lo.v[i] : hi.v[i - 4];
+                    r.v[i] = (i16)(value < -32768.0f ? -32768 : (value > 32767.0f ? 32767 : value));
+                }
+                return r;
+            }
+
+            inline F32 add(F32 a, F32 b) {
+                for (u32 i = 0; i < 4; i++) a.v[i] = a.v[i] + b.v[i];
+                return a;
+            }
+            inline F32 sub(F32 a, F32 b) {
+                for (u32 i = 0; i < 4; i++) a.v[i] = a.v[i] - b.v[i];
+                return a;
+            }
+            inline F32 mul(F32 a, F32 b) {
+                for (u32 i = 0; i < 4; i++) a.v[i] = a.v[i] * b.v[i];
+                return a;
+            }
+            inline F32 min(F32 a, F32 b) {
+                for (u32 i = 0; i < 4; i++) a.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i];
+                return a;
+            }
+            inline F32 max(F32 a, F32 b) {
+                for (u32 i = 0; i < 4; i++) a.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i];
+                return a;
+            }
+
+            inline Block load_block(const u8* p) {
+                Block r;
+                for (u32 i = 0; i < 16; i++) r.v[i] = p[i];
+                return r;
+            }
+            inline void store_block(u8* p, Block a) {
+                for (u32 i = 0; i < 16; i++) p[i] = a.v[i];
+            }
+            inline Block block_or(Block a, Block b) {
+                for (u32 i = 0; i < 16; i++) a.v[i] |= b.v[i];
+                return a;
+            }
+            inline Block shuffle(Block a, Block indices) {
+                Block r;
+                for (u32 i = 0; i < 16; i++) {
+                    r.v[i] = (indices.v[i] & 0x80) ? 0 : a.v[indices.v[i] & 15];
+                }
+                return r;
+            }
+
+#endif
+        }
+    }
+}
@@ -0,0 +1,489 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <algorithm>
+#include <exception>
+
+#include <sched.h>
+
+#include "context.h"
+#include "numa.h"
+#include "threads.h"
+#include "types.h"
+
+namespace pixl {
+
+    // Pool & index of the worker running on the current thread
+    static thread_local ThreadPool* currentPool = nullptr;
+    static thread_local u32 currentWorker = 0;
+
+    // Overrides of ThreadScope & PriorityScope
+    static thread_local u32 scopeThreads = 0;
+    static thread_local const Executor* scopeExecutor = nullptr;
+    static thread_local Priority scopePriority = Priority::NORMAL;
+
+    // Global settings
+    static std::mutex globalMutex;
+    static std::unique_ptr<ThreadPool> globalPool;
+    static u32 globalThreads = 0;
+    static bool globalPinning = false;
+    static u32 globalAging = 100;
+    static Executor globalExecutor;
+
+    // ----------------------------------------------------------------------------
+    static u32 hardwareThreads() {
+        return std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    // ----------------------------------------------------------------------------
+    static ThreadPool* pool() {
+        std::lock_guard<std::mutex> lock(globalMutex);
+        if (!globalPool) {
+            // the calling thread always helps out
+            const u32 threads = std::max(hardwareThreads(), globalThreads);
+            globalPool.reset(new ThreadPool(std::max(threads - 1, 1u), globalPinning));
+            globalPool->setAging(globalAging);
+        }
+        return globalPool.get();
+    }
+
+    // ----------------------------------------------------------------------------
+    ThreadPool::ThreadPool(u32 threads, bool pin) : pending(0), next(0), agingMillis(0) {
+        for (auto& count : this->pendingByPriority) {
+            count = 0;
+        }
+        const auto& nodes = numa_nodes();
+        for (u32 i = 0; i < threads; i++) {
+            this->queues.push_back(std::unique_ptr<Queue>(new Queue()));
+            this->queues[i]->node = nodes[i % nodes.size()];
+            numa_count_workers(this->queues[i]->node, 1);
+        }
+        for (u32 i = 0; i < threads; i++) {
+            this->threads.push_back(std::thread(&ThreadPool::work, this, i, pin));
+        }
+    }
+
+    // ----------------------------------------------------------------------------
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->stopping = true;
+        }
+        this->wakeup.notify_all();
+        for (auto& thread : this->threads) {
+            thread.join();
+        }
+        for (auto& queue : this->queues) {
+            numa_count_workers(queue->node, -1);
+        }
+    }
+
+    // ----------------------------------------------------------------------------
+    void ThreadPool::submit(Task task, i32 node, Priority priority) {
+        // workers keep their own tasks, everyone else spreads them (over the workers of the
+        // node, if one is given)
+        u32 index = 0;
+        if (currentPool == this && (node < 0 || this->queues[currentWorker]->node == (u32)node)) {
+            index = currentWorker;
+        } else {
+            index = this->next++ % size();
+            for (u32 i = 0; node >= 0 && i < size(); i++) {
+                if (this->queues[(index + i) % size()]->node == (u32)node) {
+                    index = (index + i) % size();
+                    break;
+                }
+            }
+        }
+
+        // counted first, so it never drops below 0 when the task is taken right away
+        this->pendingByPriority[(u32)priority]++;
+        {
+            std::lock_guard<std::mutex> lock(this->queues[index]->mutex);
+            Entry entry = {std::move(task), Clock::now()};
+            this->queues[index]->tasks[(u32)priority].push_back(std::move(entry));
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->pending++;
+        }
+        this->wakeup.notify_one();
+    }
+
+    // ----------------------------------------------------------------------------
+    bool ThreadPool::preempted(Priority priority) const {
+        for (u32 p = (u32)priority + 1; p < this->pendingByPriority.size(); p++) {
+            if (this->pendingByPriority[p] > 0)
+                return true;
+        }
+        return false;
+    }
+
+    // ----------------------------------------------------------------------------
+    bool ThreadPool::takeFrom(Queue& queue, u32 priority, Task& task, bool newest) {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        auto& tasks = queue.tasks[priority];
+        if (tasks.empty())
+            return false;
+
+        if (newest) {
+            task = std::move(tasks.back().task);
+            tasks.pop_back();
+        } else {
+            task = std::move(tasks.front().task);
+            tasks.pop_front();
+        }
+        this->pendingByPriority[priority]--;
+        this->pending--;
+        return true;
+    }
+
+    // ----------------------------------------------------------------------------
+    bool ThreadPool::takeAged(u32 index, Task& task, bool& remote) {
+        const u32 aging = this->agingMillis;
+        if (aging == 0)
+            return false;
+
+        // the oldest task is at the front of every deque, high priority tasks don't age
+        const auto limit = Clock::now() - std::chrono::milliseconds(aging);
+        for (u32 p = 0; p < (u32)Priority::HIGH; p++) {
+            if (this->pendingByPriority[p] == 0)
+                continue;
+
+            for (u32 i = 0; i < size(); i++) {
+                Queue& queue = *this->queues[(index + i) % size()];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                auto& tasks = queue.tasks[p];
+                if (tasks.empty() || tasks.front().queued > limit)
+                    continue;
+
+                task = std::move(tasks.front().task);
+                tasks.pop_front();
+                this->pendingByPriority[p]--;
+                this->pending--;
+                remote = queue.node != this->queues[index]->node;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // ----------------------------------------------------------------------------
+    bool ThreadPool::take(u32 index, Task& task, bool& remote) {
+        remote = false;
+        if (takeAged(index, task, remote))
+            return true;
+
+        Queue& own = *this->queues[index];
+        for (i32 p = (i32)Priority::HIGH; p >= 0; p--) {
+            if (this->pendingByPriority[p] == 0)
+                continue;
+
+            // newest task of the own queue
+            if (takeFrom(own, p, task, true))
+                return true;
+
+            // oldest task of another queue on the same node
+            for (u32 i = 1; i < size(); i++) {
+                Queue& other = *this->queues[(index + i) % size()];
+                if (other.node == own.node && takeFrom(other, p, task))
+                    return true;
+            }
+
+            // oldest task of any other queue
+            for (u32 i = 1; i < size(); i++) {
+                Queue& other = *this->queues[(index + i) % size()];
+                if (other.node != own.node && takeFrom(other, p, task)) {
+                    remote = true;
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    // ----------------------------------------------------------------------------
+    void ThreadPool::work(u32 index, bool pin) {
+        currentPool = this;
+        currentWorker = index;
+
+        const u32 node = this->queues[index]->node;
+        if (pin) {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            for (u32 cpu : numa_cpus(node)) {
+                if (cpu < CPU_SETSIZE) {
+                    CPU_SET(cpu, &cpus);
+                }
+            }
+            sched_setaffinity(0, sizeof(cpus), &cpus);
+        }
+
+        while (true) {
+            Task task;
+            bool remote;
+            if (take(index, task, remote)) {
+                numa_count_task(node, remote);
+                try {
+                    task();
+                } catch (...) {
+                    // keep the worker alive
+                }
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->wakeup.wait(lock, [this]() { return this->stopping || this->pending > 0; });
+            if (this->stopping && this->pending == 0)
+                return;
+        }
+    }
+
+    // ----------------------------------------------------------------------------
+    void set_threads(u32 threads) {
+        std::lock_guard<std::mutex> lock(globalMutex);
+        globalThreads = threads;
+
+        // grow the pool if needed
+        if (globalPool && globalPool->size() + 1 < threads) {
+            globalPool.reset();
+        }
+    }
+
+    // ----------------------------------------------------------------------------
+    void set_thread_pinning(bool pin) {
+        std::lock_guard<std::mutex> lock(globalMutex);
+        if (globalPinning != pin) {
+            globalPinning = pin;
+            globalPool.reset();
+        }
+    }
+
+    // ----------------------------------------------------------------------------
+    u32 get_threads() {
+        if (scopeThreads > 0)
+            return scopeThreads;
+
+        std::lock_guard<std::mutex> lock(globalMutex);
+        return globalThreads > 0 ? globalThreads : hardwareThreads();
+    }
+
+    // ----------------------------------------------------------------------------
+    void set_priority_aging(u32 milliseconds) {
+        std::lock_guard<std::mutex> lock(globalMutex);
+        globalAging = milliseconds;
+        if (globalPool) {
+            globalPool->setAging(milliseconds);
+        }
+    }
+
+    // ----------------------------------------------------------------------------
+    void set_executor(Executor executor) {
+        std::lock_guard<std::mutex> lock(globalMutex);
+        globalExecutor = executor;
+    }
+
+    // ----------------------------------------------------------------------------
+    ThreadScope::ThreadScope(u32 threads, Executor executor)
+        : executor(executor), previousThreads(scopeThreads), previousExecutor(scopeExecutor) {
+        if (threads > 0) {
+            scopeThreads = threads;
+        }
+        if (this->executor) {
+            scopeExecutor = &this->executor;
+        }
+    }
+
+    // ----------------------------------------------------------------------------
+    ThreadScope::~ThreadScope() {
+        scopeThreads = this->previousThreads;
+        scopeExecutor = this->previousExecutor;
+    }
+
+    // ----------------------------------------------------------------------------
+    PriorityScope::PriorityScope(Priority priority) : previous(scopePriority) {
+        scopePriority = priority;
+    }
+
+    // ----------------------------------------------------------------------------
+    PriorityScope::~PriorityScope() { scopePriority = this->previous; }
+
+    // ----------------------------------------------------------------------------
+    Priority current_priority() { return scopePriority; }
+
+    // ----------------------------------------------------------------------------
+    static Executor currentExecutor() {
+        if (scopeExecutor != nullptr)
+            return *scopeExecutor;
+
+        std::lock_guard<std::mutex> lock(globalMutex);
+        return globalExecutor;
+    }
+
+    // ----------------------------------------------------------------------------
+    // Wraps the task to run with the ThreadScope, PriorityScope & ContextScope settings of the
+    // calling thread.
+    static Task scoped(Task task, u32 threads, const Executor& executor) {
+        const Priority priority = scopePriority;
+        const ExecutionContext* current = current_context();
+        if (current == nullptr) {
+            return [=]() {
+                ThreadScope scope(threads, executor);
+                PriorityScope priorityScope(priority);
+                task();
+            };
+        }
+
+        const ExecutionContext context = *current;
+        return [=]() {
+            ThreadScope scope(threads, executor);
+            PriorityScope priorityScope(priority);
+            ContextScope contextScope(context);
+            task();
+        };
+    }
+
+    // ----------------------------------------------------------------------------
+    void run_async(Task task) {
+        // the task runs with the settings of the calling thread
+        Executor executor = currentExecutor();
+        Task wrapped = scoped(task, scopeThreads, executor);
+
+        if (executor) {
+            executor(wrapped);
+        } else {
+            pool()->submit(wrapped, -1, scopePriority);
+        }
+    }
+
+    // Shared state of a parallel_for. Helpers may start after everything is done, so they
+    // only touch the body once they claimed a range.
+    struct ParallelFor {
+        i64 begin;
+        i64 end;
+        i64 grain;
+        i64 ranges;
+        const std::function<void(i64, i64)>* body;
+
+        std::atomic<i64> next;
+        std::atomic<i64> remaining;
+        std::mutex mutex;
+        std::condition_variable done;
+        std::exception_ptr error;
+
+        // settings of the calling thread, passed on to nested calls
+        u32 threads;
+        Executor executor;
+        Priority priority;
+        i32 node;
+    };
+
+    static void runRanges(const std::shared_ptr<ParallelFor>& state, bool helper);
+
+    // ----------------------------------------------------------------------------
+    static Task helperTask(const std::shared_ptr<ParallelFor>& state) {
+        return scoped([state]() { runRanges(state, true); }, state->threads, state->executor);
+    }
+
+    // ----------------------------------------------------------------------------
+    static void runRanges(const std::shared_ptr<ParallelFor>& state, bool helper) {
+        while (true) {
+            // helpers on the pool make way for more important tasks & continue later, the
+            // caller never stops
+            if (helper && currentPool != nullptr && !state->executor &&
+                currentPool->preempted(state->priority)) {
+                if (state->next < state->ranges) {
+                    currentPool->submit(helperTask(state), state->node, state->priority);
+                }
+                return;
+            }
+
+            const i64 range = state->next++;
+            if (range >= state->ranges)
+                return;
+
+            const i64 from = state->begin + range * state->grain;
+            const i64 to = std::min(from + state->grain, state->end);
+            try {
+                (*state->body)(from, to);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (!state->error) {
+                    state->error = std::current_exception();
+                }
+            }
+
+            if (--state->remaining == 0) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->done.notify_all();
+            }
+        }
+    }
+
+    // ----------------------------------------------------------------------------
+    void parallel_for(i64 begin, i64 end, i64 grain, const std::function<void(i64, i64)>& body) {
+        if (end <= begin)
+            return;
+
+        grain = std::max(grain, (i64)1);
+        const i64 ranges = (end - begin + grain - 1) / grain;
+        const i64 helpers = std::min((i64)get_threads() - 1, ranges - 1);
+
+        // same ranges as in parallel, just one after the other
+        if (helpers <= 0) {
+            for (i64 from = begin; from < end; from += grain) {
+                body(from, std::min(from + grain, end));
+            }
+            return;
+        }
+
+        auto state = std::make_shared<ParallelFor>();
+        state->begin = begin;
+        state->end = end;
+        state->grain = grain;
+        state->ranges = ranges;
+        state->body = &body;
+        state->next = 0;
+        state->remaining = ranges;
+        state->threads = get_threads();
+        state->executor = currentExecutor();
+        state->priority = scopePriority;
+
+        // helpers run next to the data, which is usually where the caller is
+        state->node = numa_nodes().size() > 1 ? (i32)numa_preferred_node() : -1;
+
+        Task helper = helperTask(state);
+        if (state->executor) {
+            for (i64 i = 0; i < helpers; i++) {
+                state->executor(helper);
+            }
+        } else {
+            ThreadPool* threadPool = pool();
+            for (i64 i = 0; i < helpers; i++) {
+                threadPool->submit(helper, state->node, state->priority);
+            }
+        }
+
+        runRanges(state, false);
+
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->done.wait(lock, [&state]() { return state->remaining == 0; });
+        if (state->error) {
+            std::rethrow_exception(state->error);
+        }
+    }
+}
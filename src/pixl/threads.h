@@ -0,0 +1,177 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef PIXL_THREADS_H
+#define PIXL_THREADS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "types.h"
+
+namespace pixl {
+
+    typedef std::function<void()> Task;
+
+    // Runs a task at some point, e.g. on the thread pool of the application. Used instead of
+    // the internal pool to not start more threads than there are cores.
+    typedef std::function<void(Task)> Executor;
+
+    // Priority classes of tasks, e.g. interactive requests over bulk processing.
+    enum class Priority {
+        LOW,
+        NORMAL,
+        HIGH,
+    };
+
+    // Work stealing thread pool.
+    //
+    // Every worker has its own queue. Tasks submitted by a worker go to the back of its own
+    // queue and are taken from there again (they likely touch the same data), idle workers
+    // steal from the front of the other queues.
+    //
+    // Workers are spread over the NUMA nodes and steal from workers of their own node first.
+    // With pinning, they only run on the CPUs of their node.
+    //
+    // Every queue holds one deque per priority and workers always take the highest priority
+    // they can find, anywhere in the pool. Queued tasks that waited longer than the aging
+    // limit are taken first, oldest priority first, so a steady stream of high priority work
+    // can't starve the rest.
+    class ThreadPool {
+    public:
+        ThreadPool(u32 threads, bool pin = false);
+
+        // Waits for all queued tasks & stops the workers.
+        ~ThreadPool();
+
+        // Queues a task, on a worker of the given NUMA node if there is one. Tasks must not
+        // throw.
+        void submit(Task task, i32 node = -1, Priority priority = Priority::NORMAL);
+
+        // Checks if tasks with a higher priority than the given one are waiting.
+        bool preempted(Priority priority) const;
+
+        // Time after which queued tasks are taken before any others, 0 disables aging.
+        void setAging(u32 milliseconds) { this->agingMillis = milliseconds; }
+
+        u32 size() const { return (u32)this->queues.size(); }
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        struct Entry {
+            Task task;
+            Clock::time_point queued;
+        };
+
+        struct Queue {
+            std::array<std::deque<Entry>, 3> tasks;
+            std::mutex mutex;
+            u32 node = 0;
+        };
+
+        void work(u32 index, bool pin);
+        bool take(u32 index, Task& task, bool& remote);
+        bool takeAged(u32 index, Task& task, bool& remote);
+        bool takeFrom(Queue& queue, u32 priority, Task& task, bool newest = false);
+
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::vector<std::thread> threads;
+        std::mutex mutex;
+        std::condition_variable wakeup;
+        std::atomic<u64> pending;
+        std::array<std::atomic<u64>, 3> pendingByPriority;
+        std::atomic<u32> next;
+        std::atomic<u32> agingMillis;
+        bool stopping = false;
+    };
+
+    // Sets the number of threads operations & codecs may use. 0 means one per core, 1 runs
+    // everything on the calling thread. Must not be called while the library is in use.
+    void set_threads(u32 threads);
+
+    // Number of threads operations & codecs called from the current thread may use.
+    u32 get_threads();
+
+    // Pins the workers of the internal pool to the CPUs of their NUMA node.
+    // Must not be called while the library is in use.
+    void set_thread_pinning(bool pin);
+
+    // Time after which queued tasks of the internal pool are run before tasks with a higher
+    // priority. Defaults to 100 ms, 0 disables aging.
+    void set_priority_aging(u32 milliseconds);
+
+    // Runs the tasks of the library on the given executor instead of the internal pool.
+    // Pass nullptr to go back to the internal pool.
+    void set_executor(Executor executor);
+
+    // Overrides the number of threads (0 keeps the global setting) and the executor for all
+    // calls made by the current thread while the scope is alive.
+    //
+    //     pixl::ThreadScope scope(2);
+    //     image->resize(1024, 768);
+    class ThreadScope {
+    public:
+        ThreadScope(u32 threads, Executor executor = nullptr);
+        ~ThreadScope();
+
+    private:
+        Executor executor;
+        u32 previousThreads;
+        const Executor* previousExecutor;
+    };
+
+    // Sets the priority of all tasks queued by the current thread while the scope is alive.
+    // Executors provided by the caller ignore priorities.
+    //
+    //     pixl::PriorityScope scope(pixl::Priority::HIGH);
+    //     image->resize(128, 128);
+    class PriorityScope {
+    public:
+        PriorityScope(Priority priority);
+        ~PriorityScope();
+
+    private:
+        Priority previous;
+    };
+
+    // Priority of the tasks queued by the current thread.
+    Priority current_priority();
+
+    // Runs the task in the background, on the executor of the current scope, the global one or
+    // the thread pool of the library, in that order. The task keeps the ThreadScope &
+    // PriorityScope settings of the calling thread.
+    void run_async(Task task);
+
+    // Splits [begin, end) into ranges of 'grain' items and calls body(from, to) for each of
+    // them in parallel. The calling thread works on the ranges as well and returns once all
+    // of them are done, so this can be nested. The ranges never depend on the number of
+    // threads, and the first exception thrown by body is rethrown.
+    //
+    // Helpers on the internal pool give way to tasks with a higher priority after every
+    // range: they queue themselves again and continue once the worker is free.
+    void parallel_for(i64 begin, i64 end, i64 grain, const std::function<void(i64, i64)>& body);
+}
+
+#endif
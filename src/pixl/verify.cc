@@ -0,0 +1,162 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+
+#include "cpu.h"
+#include "image.h"
+#include "operations.h"
+#include "pipeline.h"
+#include "threads.h"
+#include "types.h"
+#include "verify.h"
+
+namespace pixl {
+
+    namespace {
+
+        // An operation & the channel counts it's compared with.
+        struct Case {
+            const char* operation;
+            std::vector<u32> channels;
+            std::function<void(Image*)> run;
+        };
+
+        // Restores the kernel setting when the comparison ends, also by an exception.
+        struct RestoreKernels {
+            ~RestoreKernels() { set_reference_kernels(previous); }
+            const bool previous = reference_kernels();
+        };
+
+        // ----------------------------------------------------------------------------
+        Image* randomImage(u32 width, u32 height, u32 channels, u32 seed) {
+            Image* image = new Image(width, height, channels);
+            u32 state = seed;
+            for (u64 i = 0; i < image->size; i++) {
+                state = state * 1103515245 + 12345;
+                image->data[i] = (u8)(state >> 16);
+            }
+            return image;
+        }
+
+        // ----------------------------------------------------------------------------
+        // Runs the operation on a copy of the input, returns the best time in ms and the
+        // result of the last run.
+        f64 measure(const Case& test,
+                    const Image* input,
+                    u32 runs,
+                    std::unique_ptr<Image>& result) {
+            typedef std::chrono::steady_clock Clock;
+            f64 best = 0;
+            for (u32 i = 0; i < runs; i++) {
+                result.reset(new Image(input));
+
+                const Clock::time_point start = Clock::now();
+                test.run(result.get());
+                const f64 ms =
+                    std::chrono::duration<f64, std::milli>(Clock::now() - start).count();
+                best = i == 0 ? ms : std::min(best, ms);
+            }
+            return best;
+        }
+
+        // ----------------------------------------------------------------------------
+        u32 maxDifference(const Image* a, const Image* b) {
+            if (a->width != b->width || a->height != b->height || a->channels != b->channels)
+                return 256;
+
+            u32 difference = 0;
+            for (u64 i = 0; i < a->size; i++) {
+                difference = std::max(difference, (u32)std::abs(a->data[i] - b->data[i]));
+            }
+            return difference;
+        }
+
+        // ----------------------------------------------------------------------------
+        std::vector<Case> cases(u32 width, u32 height) {
+            const Kernel sharpen = {0.1f, -1, 0.3f, -1, 5.5f, -1, 0.2f, -1, 0.7f};
+            const std::vector<u32> all = {1, 2, 3, 4};
+
+            Pipeline points;
+            points.contrast(1.3f)->invert()->grayscale();
+
+            return {
+                {"invert", all, [](Image* image) { image->invert(); }},
+                {"grayscale", all, [](Image* image) { image->grayscale(); }},
+                {"contrast", all, [](Image* image) { image->contrast(1.37f); }},
+                {"convolution", all,
+                 [sharpen](Image* image) { image->convolution(sharpen, 0.5f); }},
+                {"add alpha", {3}, [](Image* image) { image->addAlphaChannel(200); }},
+                {"remove alpha", {4}, [](Image* image) { image->removeAlphaChannel(); }},
+                // the random image with a transparent last pixel, then the same image fully
+                // opaque: both are checked to the end. The results are stored in the first color
+                // values of the first two pixels.
+                {"opaque", {2, 4},
+                 [](Image* image) {
+                     image->data[image->size - 1] = 254;
+                     const bool random = op::is_opaque(image);
+                     for (u64 i = image->channels - 1; i < image->size; i += image->channels) {
+                         image->data[i] = 255;
+                     }
+                     image->data[0] = op::is_opaque(image) ? 255 : 0;
+                     image->data[image->channels] = random ? 255 : 0;
+                 }},
+                {"resize bilinear", all,
+                 [width, height](Image* image) {
+                     image->resize(width * 2 / 3 + 1, height * 3 / 2 + 1);
+                 }},
+                {"resize nearest", all,
+                 [width, height](Image* image) {
+                     image->resize(width / 2 + 1, height * 2 + 1,
+                                   ResizeMethod::NEARSET_NEIGHBOR);
+                 }},
+                {"flip", all,
+                 [](Image* image) { image->flip()->flip(Orientation::VERTICAL); }},
+                {"point", all, [points](Image* image) { points.execute(image); }},
+            };
+        }
+    }
+
+    // ----------------------------------------------------------------------------
+    std::vector<KernelComparison> compare_kernels(u32 width, u32 height, u32 runs, u32 seed) {
+        RestoreKernels restore;
+        ThreadScope threads(1);
+        runs = std::max(runs, 1u);
+
+        std::vector<KernelComparison> comparisons;
+        for (const Case& test : cases(width, height)) {
+            for (u32 channels : test.channels) {
+                std::unique_ptr<Image> input(randomImage(width, height, channels, seed));
+                std::unique_ptr<Image> expected, actual;
+
+                KernelComparison comparison;
+                comparison.operation = test.operation;
+                comparison.channels = channels;
+                set_reference_kernels(true);
+                comparison.referenceMs = measure(test, input.get(), runs, expected);
+                set_reference_kernels(false);
+                comparison.optimizedMs = measure(test, input.get(), runs, actual);
+                comparison.maxDifference = maxDifference(expected.get(), actual.get());
+                comparisons.push_back(comparison);
+            }
+        }
+        return comparisons;
+    }
+}
@@ -0,0 +1,53 @@
+//
+// Copyright (c) 2017. See AUTHORS file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef PIXL_VERIFY_H
+#define PIXL_VERIFY_H
+
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+namespace pixl {
+
+    // Outcome of running an operation once with the reference kernels & once with the
+    // optimized ones of cpu_isa().
+    struct KernelComparison {
+        std::string operation;
+        u32 channels = 0;
+
+        // Largest difference of a single sample of the two results, 256 if their sizes differ.
+        u32 maxDifference = 0;
+
+        // Best time of all runs.
+        f64 referenceMs = 0;
+        f64 optimizedMs = 0;
+
+        f64 speedup() const { return optimizedMs > 0 ? referenceMs / optimizedMs : 0; }
+    };
+
+    // Runs every operation on random images of the given size with 1 to 4 channels (those the
+    // operation supports), with both kinds of kernels, on the calling thread only. Operations
+    // without optimized kernels are compared as well, so new ones are covered right away.
+    //
+    // Switches the kernels with set_reference_kernels, so it must not run while the library
+    // is used elsewhere.
+    std::vector<KernelComparison> compare_kernels(u32 width, u32 height, u32 runs = 1,
+                                                  u32 seed = 42);
+}
+
+#endif
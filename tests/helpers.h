@@ -0,0 +1,20 @@
+#ifndef PIXL_TESTS_HELPERS_H
+#define PIXL_TESTS_HELPERS_H
+
+#include <pixl/image.h>
+
+// Fills the image with a pattern that differs between neighboring values, pixels & rows.
+inline void fillTestPattern(pixl::Image* image) {
+    for (pixl::u64 i = 0; i < image->size; i++) {
+        image->data[i] = (pixl::u8)(i * 7 + i / 13);
+    }
+}
+
+// A new image filled with the test pattern.
+inline pixl::Image* testImage(pixl::u32 width, pixl::u32 height, pixl::u32 channels) {
+    pixl::Image* image = new pixl::Image(width, height, channels);
+    fillTestPattern(image);
+    return image;
+}
+
+#endif
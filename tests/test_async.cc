@@ -0,0 +1,48 @@
+#include <catch.hpp>
+#include <cstring>
+#include <future>
+#include <vector>
+
+#include <pixl/async.h>
+#include <pixl/errors.h>
+#include <pixl/image.h>
+
+TEST_CASE("Reading, processing & writing asynchronously", "[async]") {
+    std::vector<pixl::Image*> images;
+    std::vector<std::future<void>> writes;
+    for (int i = 0; i < 8; i++) {
+        pixl::Image* image = new pixl::Image(40, 30, 3);
+        memset(image->data, i * 20, image->size);
+        images.push_back(image);
+        writes.push_back(pixl::write_async(image, "test_async_" + std::to_string(i) + ".png"));
+    }
+    for (auto& write : writes) {
+        write.get();
+    }
+
+    std::vector<std::future<pixl::Image*>> reads;
+    for (int i = 0; i < 8; i++) {
+        reads.push_back(pixl::read_async("test_async_" + std::to_string(i) + ".png"));
+    }
+
+    pixl::Pipeline pipeline;
+    pipeline.invert()->resize(20, 15);
+    for (int i = 0; i < 8; i++) {
+        pixl::Image* image = pixl::execute_async(pipeline, reads[i].get()).get();
+        REQUIRE(image->width == 20);
+        REQUIRE(image->data[0] == 255 - i * 20);
+        delete image;
+        delete images[i];
+    }
+
+    REQUIRE_THROWS_AS(pixl::read_async("test_async_missing.png").get(),
+                      const pixl::PixlException&);
+}
+
+TEST_CASE("Asynchronous callbacks", "[async]") {
+    std::promise<bool> failed;
+    pixl::read_async("test_async_missing.png", [&](pixl::Image* image, std::exception_ptr error) {
+        failed.set_value(image == nullptr && error != nullptr);
+    });
+    REQUIRE(failed.get_future().get());
+}
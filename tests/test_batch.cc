@@ -0,0 +1,68 @@
+#include <catch.hpp>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <pixl/batch.h>
+#include <pixl/image.h>
+#include <pixl/io.h>
+
+TEST_CASE("Bounded queues block & close", "[batch]") {
+    pixl::BoundedQueue<int> queue(2);
+    REQUIRE(queue.push(1));
+    REQUIRE(queue.push(2));
+
+    int item;
+    REQUIRE(queue.pop(item));
+    REQUIRE(item == 1);
+
+    queue.close();
+    REQUIRE_FALSE(queue.push(3));
+    REQUIRE(queue.pop(item));
+    REQUIRE(item == 2);
+    REQUIRE_FALSE(queue.pop(item));
+}
+
+TEST_CASE("Processing a batch of images", "[batch]") {
+    std::vector<pixl::BatchItem> items;
+    for (int i = 0; i < 12; i++) {
+        pixl::Image image(64 + i, 48, 3);
+        for (pixl::u64 p = 0; p < image.size; p++) {
+            image.data[p] = (pixl::u8)(p * (i + 1));
+        }
+
+        const std::string name = "test_batch_" + std::to_string(i);
+        pixl::write(&image, (name + ".png").c_str());
+        items.push_back({name + ".png", name + (i % 2 ? ".jpg" : ".png")});
+    }
+    items.push_back({"test_batch_missing.png", "test_batch_missing_out.png"});
+    items.push_back({"test_batch_0.png", "test_batch_0.bmp"});
+
+    pixl::Pipeline pipeline;
+    pipeline.resize(32, 24)->grayscale();
+
+    pixl::Batch batch(pipeline);
+    batch.decodeThreads = 2;
+    batch.processThreads = 2;
+    batch.encodeThreads = 3;
+    batch.queueSize = 1;
+    std::atomic<int> done(0);
+    batch.onDone = [&](const pixl::BatchResult&) { done++; };
+
+    auto results = batch.run(items);
+    REQUIRE(results.size() == items.size());
+    REQUIRE(done == (int)items.size());
+
+    for (int i = 0; i < 12; i++) {
+        REQUIRE(results[i].success);
+        REQUIRE(results[i].input == items[i].input);
+
+        pixl::Image* image = pixl::read(items[i].output.c_str());
+        REQUIRE(image != nullptr);
+        REQUIRE(image->width == 32);
+        REQUIRE(image->height == 24);
+        delete image;
+    }
+    REQUIRE_FALSE(results[12].success);
+    REQUIRE_FALSE(results[13].success);
+}
@@ -0,0 +1,219 @@
+#include <catch.hpp>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <pixl/batch.h>
+#include <pixl/cache.h>
+#include <pixl/image.h>
+#include <pixl/io.h>
+#include <pixl/pipeline.h>
+
+static void writeFile(const char* path, pixl::u64 length, pixl::u8 value) {
+    std::vector<pixl::u8> data(length, value);
+    pixl::write_binary(path, data.data(), length);
+}
+
+static void tick() {
+    // file times aren't necessarily updated with a high resolution
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+}
+
+TEST_CASE("Cache keys depend on the input & spec", "[cache]") {
+    const pixl::u8 a[] = "some input";
+    const pixl::u8 b[] = "some inpuT";
+    const std::string key = pixl::DiskCache::key(a, sizeof(a), "invert");
+
+    REQUIRE(key.size() == 32);
+    REQUIRE(key == pixl::DiskCache::key(a, sizeof(a), "invert"));
+    REQUIRE(key != pixl::DiskCache::key(b, sizeof(b), "invert"));
+    REQUIRE(key != pixl::DiskCache::key(a, sizeof(a), "grayscale"));
+    REQUIRE(key != pixl::DiskCache::key(a, sizeof(a) - 1, "invert"));
+}
+
+TEST_CASE("Cache evicts the least recently used entries", "[cache]") {
+    pixl::DiskCache(std::string("test_cache_lru"), 0);
+    pixl::DiskCache cache("test_cache_lru", 250);
+
+    writeFile("test_cache_a", 100, 'a');
+    writeFile("test_cache_b", 100, 'b');
+    writeFile("test_cache_c", 100, 'c');
+    const std::string a(32, 'a'), b(32, 'b'), c(32, 'c');
+
+    cache.store(a, "test_cache_a");
+    tick();
+    cache.store(b, "test_cache_b");
+    tick();
+    REQUIRE(cache.size() == 200);
+    REQUIRE(cache.fetch(a, "test_cache_out"));
+    tick();
+    cache.store(c, "test_cache_c");
+
+    REQUIRE(cache.size() == 200);
+    REQUIRE_FALSE(cache.fetch(b, "test_cache_out"));
+    REQUIRE(cache.fetch(c, "test_cache_out"));
+    REQUIRE(cache.fetch(a, "test_cache_out"));
+    REQUIRE(cache.hits() == 3);
+    REQUIRE(cache.misses() == 1);
+
+    pixl::u64 length = 0;
+    pixl::u8* data = pixl::read_binary("test_cache_out", &length);
+    REQUIRE(length == 100);
+    REQUIRE(data[0] == 'a');
+    delete[] data;
+
+    // entries survive the process
+    pixl::DiskCache reopened("test_cache_lru", 250);
+    REQUIRE(reopened.size() == 200);
+}
+
+TEST_CASE("Storing a key again replaces its entry", "[cache]") {
+    pixl::DiskCache(std::string("test_cache_twice"), 0);
+    pixl::DiskCache cache("test_cache_twice", 1000);
+
+    writeFile("test_cache_small", 100, 's');
+    writeFile("test_cache_large", 300, 'l');
+    const std::string key(32, 'd');
+
+    cache.store(key, "test_cache_small");
+    cache.store(key, "test_cache_small");
+    REQUIRE(cache.size() == 100);
+
+    cache.store(key, "test_cache_large");
+    REQUIRE(cache.size() == 300);
+    cache.store(key, "test_cache_small");
+    REQUIRE(cache.size() == 100);
+}
+
+TEST_CASE("Pipelines reuse cached results", "[cache]") {
+    pixl::Image image(80, 60, 3);
+    for (pixl::u64 i = 0; i < image.size; i++) {
+        image.data[i] = (pixl::u8)(i * 3);
+    }
+    pixl::write(&image, "test_cache_input.png");
+
+    pixl::DiskCache(std::string("test_cache_pipeline"), 0);
+    auto cache = std::make_shared<pixl::DiskCache>("test_cache_pipeline", 1 << 20);
+    auto pipeline = pixl::Pipeline::parse("resize:40x30|invert");
+    pipeline.cache = cache;
+
+    pipeline.write("test_cache_input.png", "test_cache_output.png");
+    REQUIRE(cache->misses() == 1);
+    pipeline.write("test_cache_input.png", "test_cache_output_2.png");
+    REQUIRE(cache->hits() == 1);
+
+    pixl::Image* first = pixl::read("test_cache_output.png");
+    pixl::Image* second = pixl::read("test_cache_output_2.png");
+    REQUIRE(second->width == 40);
+    REQUIRE(memcmp(first->data, second->data, first->size) == 0);
+
+    // a different encoder is a different result
+    pipeline.write("test_cache_input.png", "test_cache_output.jpg");
+    REQUIRE(cache->misses() == 2);
+
+    pixl::Batch batch(pipeline);
+    auto results = batch.run({{"test_cache_input.png", "test_cache_output_3.png"},
+                              {"test_cache_input.png", "test_cache_output_3.jpg"}});
+    REQUIRE(results[0].success);
+    REQUIRE(results[1].success);
+    REQUIRE(cache->hits() == 3);
+
+    delete first;
+    delete second;
+}
+
+TEST_CASE("Decoded images are shared until evicted", "[cache]") {
+    for (int i = 0; i < 3; i++) {
+        pixl::Image image(100, 100, 3);
+        memset(image.data, i * 50, image.size);
+        pixl::write(&image, ("test_cache_image_" + std::to_string(i) + ".png").c_str());
+    }
+
+    // room for two images
+    pixl::ImageCache cache(2 * 100 * 100 * 3, 4);
+    auto first = cache.read("test_cache_image_0.png");
+    REQUIRE(first);
+    REQUIRE(cache.read("test_cache_image_0.png") == first);
+    REQUIRE(cache.hits() == 1);
+    REQUIRE(cache.misses() == 1);
+    REQUIRE_FALSE(cache.read("test_cache_missing.png"));
+
+    cache.read("test_cache_image_1.png");
+    cache.read("test_cache_image_2.png");
+    REQUIRE(cache.size() <= cache.maxBytes);
+    REQUIRE(cache.size() > 0);
+
+    // evicted images stay valid
+    REQUIRE(first->data[0] == 0);
+
+    // a changed file is decoded again
+    tick();
+    pixl::Image changed(50, 50, 3);
+    memset(changed.data, 7, changed.size);
+    pixl::write(&changed, "test_cache_image_2.png");
+    auto reread = cache.read("test_cache_image_2.png");
+    REQUIRE(reread->width == 50);
+
+    cache.clear();
+    REQUIRE(cache.size() == 0);
+}
+
+TEST_CASE("The image cache evicts the least recently used image of all shards", "[cache]") {
+    auto name = [](int i) { return "test_cache_lru_" + std::to_string(i) + ".png"; };
+    for (int i = 0; i < 6; i++) {
+        pixl::Image image(20, 20, 3);
+        memset(image.data, i * 40, image.size);
+        pixl::write(&image, name(i).c_str());
+    }
+
+    // room for four images, spread over many shards
+    pixl::ImageCache cache(4 * 20 * 20 * 3, 16);
+    for (int i = 0; i < 4; i++) {
+        cache.read(name(i).c_str());
+    }
+    // 0 becomes the most recently used, 1 the oldest
+    cache.read(name(0).c_str());
+    REQUIRE(cache.hits() == 1);
+
+    cache.read(name(4).c_str());
+    cache.read(name(5).c_str());
+    REQUIRE(cache.size() == cache.maxBytes);
+
+    // 1 & 2 are gone, all others are still cached
+    for (int i : {0, 3, 4, 5}) {
+        const pixl::u64 hits = cache.hits();
+        cache.read(name(i).c_str());
+        INFO(i);
+        REQUIRE(cache.hits() == hits + 1);
+    }
+    for (int i : {1, 2}) {
+        const pixl::u64 misses = cache.misses();
+        cache.read(name(i).c_str());
+        INFO(i);
+        REQUIRE(cache.misses() == misses + 1);
+    }
+}
+
+TEST_CASE("Pipelines decode through the image cache", "[cache]") {
+    pixl::Image image(64, 48, 3);
+    for (pixl::u64 i = 0; i < image.size; i++) {
+        image.data[i] = (pixl::u8)(i * 11);
+    }
+    pixl::write(&image, "test_cache_decode.png");
+
+    auto pipeline = pixl::Pipeline::parse("resize:32x24|invert");
+    pixl::Image* expected = pipeline.execute("test_cache_decode.png");
+
+    auto images = std::make_shared<pixl::ImageCache>(1 << 20);
+    pipeline.images = images;
+    for (int i = 0; i < 2; i++) {
+        pixl::Image* cached = pipeline.execute("test_cache_decode.png");
+        REQUIRE(memcmp(cached->data, expected->data, expected->size) == 0);
+        delete cached;
+    }
+    REQUIRE(images->hits() == 1);
+
+    delete expected;
+}
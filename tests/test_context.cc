@@ -0,0 +1,110 @@
+#include <catch.hpp>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <pixl/batch.h>
+#include <pixl/context.h>
+#include <pixl/image.h>
+#include <pixl/io.h>
+#include <pixl/pipeline.h>
+#include <pixl/pixl.h>
+#include <pixl/threads.h>
+
+TEST_CASE("Operations report their progress", "[context]") {
+    std::vector<float> reported;
+    pixl::ExecutionContext context;
+    context.onProgress = [&](float progress) { reported.push_back(progress); };
+
+    pixl::Image image(500, 400, 3);
+    {
+        pixl::ThreadScope threads(4);
+        pixl::ContextScope scope(context);
+        image.invert();
+    }
+
+    REQUIRE(reported.size() > 1);
+    REQUIRE(reported.back() == 1.0f);
+    bool increasing = true;
+    for (size_t i = 1; i < reported.size(); i++) {
+        increasing = increasing && reported[i] > reported[i - 1];
+    }
+    REQUIRE(increasing);
+
+    // no context, no calls
+    const size_t calls = reported.size();
+    image.invert();
+    REQUIRE(reported.size() == calls);
+}
+
+TEST_CASE("Cancelled operations stop", "[context]") {
+    pixl::CancellationToken token;
+    pixl::ExecutionContext context;
+    context.token = &token;
+
+    // cancelled half way through
+    std::atomic<int> calls(0);
+    context.onProgress = [&](float progress) {
+        calls++;
+        if (progress >= 0.5f) {
+            token.cancel();
+        }
+    };
+
+    pixl::Image image(1000, 800, 3);
+    pixl::Pipeline pipeline;
+    pipeline.invert()->resize(500, 400)->flip();
+    pipeline.bandHeight = 8;
+    {
+        pixl::ThreadScope threads(2);
+        pixl::ContextScope scope(context);
+        REQUIRE_THROWS_AS(pipeline.execute(&image), const pixl::CancelledException&);
+        REQUIRE_THROWS_AS(image.resize(100, 100), const pixl::CancelledException&);
+        REQUIRE_THROWS_AS(pixl::write(&image, "test_context.png"), const pixl::CancelledException&);
+    }
+
+    // the image is untouched by operations that allocate a new buffer
+    REQUIRE(image.width == 1000);
+    REQUIRE(image.height == 800);
+    REQUIRE(calls < 60);
+}
+
+TEST_CASE("Cancelled batches fail the remaining items", "[context]") {
+    pixl::Image image(64, 64, 3);
+    pixl::write(&image, "test_context.png");
+
+    pixl::CancellationToken token;
+    token.cancel();
+    pixl::ExecutionContext context;
+    context.token = &token;
+
+    pixl::Batch batch((pixl::Pipeline()));
+    std::vector<pixl::BatchResult> results;
+    {
+        pixl::ContextScope scope(context);
+        results = batch.run({{"test_context.png", "test_context_out.png"}});
+    }
+    REQUIRE_FALSE(results[0].success);
+    REQUIRE(results[0].error == "Cancelled");
+}
+
+TEST_CASE("The C API reports cancelled pipelines as errors", "[context]") {
+    pixl::CancellationToken token;
+    token.cancel();
+    pixl::ExecutionContext context;
+    context.token = &token;
+
+    CPixlPipeline* pipeline = pixl_pipeline_parse("invert");
+    REQUIRE(pipeline != nullptr);
+    pixl::Image* image = new pixl::Image(64, 64, 3);
+    CPixlImage cimage = {64, 64, image};
+    {
+        pixl::ContextScope scope(context);
+        REQUIRE(pixl_pipeline_execute(pipeline, &cimage) == -1);
+    }
+    REQUIRE(std::string(pixl_last_error()) == "Cancelled");
+    REQUIRE(pixl_pipeline_execute(pipeline, &cimage) == 0);
+
+    pixl_pipeline_destroy(pipeline);
+    delete image;
+}
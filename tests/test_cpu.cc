@@ -0,0 +1,190 @@
+#include <catch.hpp>
+#include <cstring>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <pixl/cpu.h>
+#include <pixl/image.h>
+#include <pixl/kernels.h>
+#include <pixl/verify.h>
+
+static std::vector<pixl::u8> randomRow(pixl::u64 length, pixl::u32 seed) {
+    std::vector<pixl::u8> row(length);
+    for (auto& value : row) {
+        seed = seed * 1103515245 + 12345;
+        value = (pixl::u8)(seed >> 16);
+    }
+    return row;
+}
+
+TEST_CASE("All instruction sets compute the same results", "[cpu]") {
+    const pixl::Kernels* baseline = pixl::kernels_reference();
+    REQUIRE(pixl::kernels_for(pixl::Isa::SSE2) != nullptr);
+
+    const pixl::f32 kernel[9] = {0.1f, -1, 0.3f, -1, 5.5f, -1, 0.2f, -1, 0.7f};
+    const pixl::u32 pixels = 261;
+    for (pixl::Isa isa : {pixl::Isa::SSE2, pixl::Isa::SSE41, pixl::Isa::AVX2, pixl::Isa::AVX512}) {
+        const pixl::Kernels* k = pixl::kernels_for(isa);
+        if (k == nullptr)
+            continue;
+
+        int wrong = 0;
+        for (pixl::u32 channels = 1; channels <= 4; channels++) {
+            const pixl::u64 length = (pixl::u64)pixels * channels;
+            auto src = randomRow(length, channels);
+            auto row1 = randomRow(length, channels + 10);
+            auto row2 = randomRow(length, channels + 20);
+            std::vector<pixl::u8> expected(length), actual(length);
+
+            baseline->invert(src.data(), expected.data(), pixels, channels);
+            k->invert(src.data(), actual.data(), pixels, channels);
+            wrong += expected != actual;
+
+            baseline->grayscale(src.data(), expected.data(), pixels, channels);
+            k->grayscale(src.data(), actual.data(), pixels, channels);
+            wrong += expected != actual;
+
+            // Q8 factors, including the ones that saturate
+            for (pixl::i16 factor : {351, 0, -200, 32767, -32768}) {
+                baseline->contrast(src.data(), expected.data(), pixels, channels, factor);
+                k->contrast(src.data(), actual.data(), pixels, channels, factor);
+                wrong += expected != actual;
+            }
+
+            const pixl::u32 count = (pixels - 2) * channels;
+            baseline->convolution(src.data(), row1.data(), row2.data(), expected.data(), count,
+                                  channels, kernel, 0.5f);
+            k->convolution(src.data(), row1.data(), row2.data(), actual.data(), count,
+                           channels, kernel, 0.5f);
+            wrong += expected != actual;
+
+            // a downscale that interpolates vertically first, a strong one that doesn't and
+            // an upscale, all with the edge repeated at the end
+            for (pixl::u32 outPixels : {pixels / 2, pixels / 9, pixels * 2}) {
+                std::vector<pixl::u32> columns(outPixels);
+                std::vector<pixl::i32> weights(outPixels);
+                for (pixl::u32 x = 0; x < outPixels; x++) {
+                    columns[x] = (pixl::u32)((pixl::u64)x * (pixels - 1) / outPixels) * channels;
+                    weights[x] = (pixl::i32)(x * 97 % 257);
+                }
+                std::vector<pixl::u16> mid(length);
+                std::vector<pixl::u8> expectedRow(outPixels * channels);
+                std::vector<pixl::u8> actualRow(outPixels * channels);
+
+                baseline->resize_nearest(src.data(), expectedRow.data(), columns.data(), outPixels,
+                                         channels);
+                k->resize_nearest(src.data(), actualRow.data(), columns.data(), outPixels,
+                                  channels);
+                wrong += expectedRow != actualRow;
+
+                for (pixl::i32 weightY : {0, 77, 256}) {
+                    baseline->resize_bilinear(src.data(), row1.data(), expectedRow.data(),
+                                              mid.data(), (pixl::u32)length, columns.data(),
+                                              weights.data(), channels, weightY, outPixels,
+                                              channels);
+                    k->resize_bilinear(src.data(), row1.data(), actualRow.data(), mid.data(),
+                                       (pixl::u32)length, columns.data(), weights.data(),
+                                       channels, weightY, outPixels, channels);
+                    wrong += expectedRow != actualRow;
+                }
+            }
+
+            if (channels == 2 || channels == 4) {
+                auto opaqueRow = src;
+                for (pixl::u64 i = channels - 1; i < length; i += channels) {
+                    opaqueRow[i] = 255;
+                }
+                wrong += !k->opaque(opaqueRow.data(), length, channels);
+                wrong += baseline->opaque(src.data(), length, channels) !=
+                         k->opaque(src.data(), length, channels);
+            }
+        }
+
+        // 4 -> 3 channels, in place as well
+        auto rgba = randomRow((pixl::u64)pixels * 4, 7);
+        std::vector<pixl::u8> expected(pixels * 4), actual(pixels * 4);
+        baseline->add_alpha(rgba.data(), expected.data(), pixels, 99);
+        k->add_alpha(rgba.data(), actual.data(), pixels, 99);
+        wrong += expected != actual;
+
+        baseline->remove_alpha(rgba.data(), expected.data(), pixels);
+        k->remove_alpha(rgba.data(), actual.data(), pixels);
+        expected.resize(pixels * 3);
+        actual.resize(pixels * 3);
+        wrong += expected != actual;
+        k->remove_alpha(rgba.data(), rgba.data(), pixels);
+        rgba.resize(pixels * 3);
+        wrong += rgba != expected;
+
+        INFO(pixl::isa_name(isa));
+        REQUIRE(wrong == 0);
+    }
+}
+
+TEST_CASE("Kernels work in place & keep alpha", "[cpu]") {
+    const pixl::Kernels& k = pixl::kernels();
+    std::vector<pixl::u8> row = {10, 20, 30, 40, 250, 0, 128, 7};
+    k.invert(row.data(), row.data(), 2, 4);
+    REQUIRE(row == std::vector<pixl::u8>({245, 235, 225, 40, 5, 255, 127, 7}));
+
+    k.grayscale(row.data(), row.data(), 2, 4);
+    REQUIRE(row == std::vector<pixl::u8>({235, 235, 235, 40, 129, 129, 129, 7}));
+}
+
+TEST_CASE("PIXL_CPU caps the instruction set", "[cpu]") {
+    REQUIRE(pixl::select_isa(nullptr) == pixl::cpu_supported());
+    REQUIRE(pixl::select_isa("unknown") == pixl::cpu_supported());
+    REQUIRE(pixl::select_isa("sse2") == pixl::Isa::SSE2);
+    REQUIRE(pixl::select_isa("avx512") == pixl::cpu_supported());
+    REQUIRE(pixl::cpu_isa() <= pixl::cpu_supported());
+    REQUIRE(pixl::kernels_for(pixl::cpu_isa()) != nullptr);
+
+    // never above what the machine can run
+    const pixl::Isa avx2 = pixl::select_isa("avx2");
+    REQUIRE(avx2 <= pixl::Isa::AVX2);
+    REQUIRE(pixl::kernels_for(avx2) != nullptr);
+    REQUIRE(std::string(pixl::isa_name(pixl::Isa::SSE41)) == "sse4.1");
+}
+
+TEST_CASE("Reference kernels match the optimized ones for every operation", "[cpu]") {
+    const bool previous = pixl::reference_kernels();
+    std::vector<pixl::KernelComparison> comparisons = pixl::compare_kernels(67, 23, 1, 7);
+    REQUIRE(pixl::reference_kernels() == previous);
+
+    std::map<std::string, std::set<pixl::u32>> channels;
+    for (auto& comparison : comparisons) {
+        INFO(comparison.operation << ", " << comparison.channels << " channels");
+        REQUIRE(comparison.maxDifference == 0);
+        REQUIRE(comparison.speedup() > 0);
+        channels[comparison.operation].insert(comparison.channels);
+    }
+
+    const std::set<pixl::u32> all = {1, 2, 3, 4};
+    for (const char* operation : {"invert", "grayscale", "contrast", "convolution",
+                                  "resize bilinear", "resize nearest", "flip", "point"}) {
+        INFO(operation);
+        REQUIRE(channels[operation] == all);
+    }
+    REQUIRE(channels["add alpha"] == std::set<pixl::u32>({3}));
+    REQUIRE(channels["remove alpha"] == std::set<pixl::u32>({4}));
+    REQUIRE(channels["opaque"] == std::set<pixl::u32>({2, 4}));
+}
+
+TEST_CASE("Operations can be forced onto the reference kernels", "[cpu]") {
+    const bool previous = pixl::reference_kernels();
+    pixl::set_reference_kernels(true);
+    REQUIRE(&pixl::kernels() == pixl::kernels_reference());
+
+    pixl::Image image(3, 1, 4);
+    const pixl::u8 pixels[] = {10, 20, 30, 40, 250, 0, 128, 7, 1, 2, 3, 4};
+    memcpy(image.data, pixels, sizeof(pixels));
+    image.invert();
+    REQUIRE(image.data[0] == 245);
+    REQUIRE(image.data[3] == 40);
+
+    pixl::set_reference_kernels(false);
+    REQUIRE(&pixl::kernels() == pixl::kernels_for(pixl::cpu_isa()));
+    pixl::set_reference_kernels(previous);
+}
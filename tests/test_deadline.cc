@@ -0,0 +1,119 @@
+#include <catch.hpp>
+#include <cstring>
+#include <memory>
+
+#include <pixl/deadline.h>
+#include <pixl/image.h>
+#include <pixl/io.h>
+#include <pixl/pipeline.h>
+
+#include "helpers.h"
+
+static void writeTestImage(const char* path, pixl::u32 width, pixl::u32 height) {
+    pixl::Image image(width, height, 3);
+    fillTestPattern(&image);
+    pixl::write(&image, path);
+}
+
+static bool applied(const pixl::DeadlineReport& report, pixl::Degradation degradation) {
+    for (auto d : report.degradations) {
+        if (d == degradation)
+            return true;
+    }
+    return false;
+}
+
+TEST_CASE("Deadline pipelines meet generous budgets at full quality", "[deadline]") {
+    writeTestImage("test_deadline.png", 200, 150);
+
+    pixl::Pipeline pipeline;
+    pipeline.resize(100, 75)->invert();
+    pixl::DeadlinePipeline deadline(pipeline, 60);
+    deadline.costs = std::make_shared<pixl::CostModel>();
+
+    REQUIRE(deadline.plan("test_deadline.png", "test_deadline_out.png").degradations.empty());
+    deadline.write("test_deadline.png", "test_deadline_out.png");
+    REQUIRE(deadline.report().degradations.empty());
+    REQUIRE(deadline.report().elapsed > 0);
+
+    pixl::Image* result = pixl::read("test_deadline_out.png");
+    pixl::Image* expected = pipeline.execute("test_deadline.png");
+    REQUIRE(result->size == expected->size);
+    REQUIRE(memcmp(result->data, expected->data, expected->size) == 0);
+    delete result;
+    delete expected;
+}
+
+TEST_CASE("Deadline pipelines degrade to meet tight budgets", "[deadline]") {
+    writeTestImage("test_deadline.jpg", 640, 480);
+
+    pixl::Pipeline pipeline;
+    pipeline.contrast(1.2f)->convolution({0, -1, 0, -1, 5, -1, 0, -1, 0})->resize(160, 120);
+    pixl::DeadlinePipeline deadline(pipeline, 1e-9);
+    deadline.costs = std::make_shared<pixl::CostModel>();
+
+    // everything that makes it cheaper, in order
+    auto report = deadline.plan("test_deadline.jpg", "test_deadline_out.png");
+    REQUIRE(report.degradations.size() == 4);
+    REQUIRE(report.degradations[0] == pixl::Degradation::FAST_PNG);
+    REQUIRE(report.degradations[1] == pixl::Degradation::FAST_DCT);
+    REQUIRE(report.degradations[2] == pixl::Degradation::NEAREST_RESIZE);
+    REQUIRE(report.degradations[3] == pixl::Degradation::REDUCED_DECODE);
+
+    // the result still has the requested size
+    pixl::Image* image = deadline.execute("test_deadline.jpg");
+    REQUIRE(image->width == 160);
+    REQUIRE(image->height == 120);
+    REQUIRE(deadline.report().degradations.size() == 3);
+    delete image;
+
+    // png inputs & jpeg outputs can't be degraded as much
+    writeTestImage("test_deadline.png", 640, 480);
+    report = deadline.plan("test_deadline.png", "test_deadline_out.jpg");
+    REQUIRE(applied(report, pixl::Degradation::FAST_DCT));
+    REQUIRE(applied(report, pixl::Degradation::NEAREST_RESIZE));
+    REQUIRE_FALSE(applied(report, pixl::Degradation::FAST_PNG));
+    REQUIRE_FALSE(applied(report, pixl::Degradation::REDUCED_DECODE));
+    deadline.write("test_deadline.png", "test_deadline_out.jpg");
+
+    pixl::JpegTurboReader reader;
+    pixl::u32 width = 0, height = 0;
+    REQUIRE(reader.readSize("test_deadline_out.jpg", &width, &height));
+    REQUIRE(width == 160);
+    REQUIRE(height == 120);
+}
+
+TEST_CASE("Degradations stop once the estimate meets the budget", "[deadline]") {
+    writeTestImage("test_deadline.jpg", 640, 480);
+
+    auto costs = std::make_shared<pixl::CostModel>();
+    pixl::Pipeline pipeline;
+    pipeline.resize(320, 240);
+    pixl::DeadlinePipeline deadline(pipeline, 60);
+    deadline.costs = costs;
+
+    const auto full = deadline.plan("test_deadline.jpg", "test_deadline_out.png");
+    REQUIRE(full.estimated > 0);
+
+    // fast png alone is enough
+    deadline.budget = full.estimated * 0.99;
+    auto report = deadline.plan("test_deadline.jpg", "test_deadline_out.png");
+    REQUIRE(report.degradations.size() == 1);
+    REQUIRE(report.degradations[0] == pixl::Degradation::FAST_PNG);
+    REQUIRE(report.estimated <= deadline.budget);
+}
+
+TEST_CASE("Cost models learn from measurements", "[deadline]") {
+    pixl::CostModel costs;
+    costs.set(pixl::Cost::CONVOLUTION, 10);
+    REQUIRE(costs.estimate(pixl::Cost::CONVOLUTION, 1000000) == Approx(0.01));
+
+    for (int i = 0; i < 50; i++) {
+        costs.record(pixl::Cost::CONVOLUTION, 1000000, 0.02);
+    }
+    REQUIRE(costs.get(pixl::Cost::CONVOLUTION) == Approx(20).epsilon(0.01));
+
+    // measurements of one step don't touch the others
+    REQUIRE(costs.get(pixl::Cost::POINT) == pixl::CostModel().get(pixl::Cost::POINT));
+    REQUIRE(std::string(pixl::degradation_name(pixl::Degradation::FAST_DCT)) == "fast_dct");
+}
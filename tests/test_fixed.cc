@@ -0,0 +1,72 @@
+#include <catch.hpp>
+#include <algorithm>
+#include <cstdlib>
+
+#include <pixl/fixed.h>
+#include <pixl/image.h>
+#include <pixl/operations.h>
+
+#include "helpers.h"
+
+TEST_CASE("Fixed point conversion, products & division", "[fixed]") {
+    REQUIRE(pixl::fixed::to_q(1.5f, 8) == 384);
+    REQUIRE(pixl::fixed::to_q(-0.25f, 8) == -64);
+    REQUIRE(pixl::fixed::to_q(1 / 512.0f, 8) == 1);
+    REQUIRE(pixl::fixed::to_q(1000.0f, 8) == 32767);
+    REQUIRE(pixl::fixed::to_q(-1000.0f, 8) == -32768);
+
+    REQUIRE(pixl::fixed::mul_floor(-3, 128, 8) == -2);
+    REQUIRE(pixl::fixed::mul_round(-3, 128, 8) == -1);
+    REQUIRE(pixl::fixed::mul_round(5, 128, 8) == 3);
+    REQUIRE(pixl::fixed::lerp(10, 20, 128, 8) == 15 * 256);
+    REQUIRE(pixl::fixed::saturate_u8(-5) == 0);
+    REQUIRE(pixl::fixed::saturate_u8(300) == 255);
+
+    int wrong = 0;
+    for (pixl::u32 divisor = 1; divisor <= 4; divisor++) {
+        for (pixl::u32 value = 0; value < 32768; value++) {
+            wrong += pixl::fixed::divide(value, divisor) != value / divisor;
+        }
+    }
+    REQUIRE(wrong == 0);
+}
+
+TEST_CASE("Fixed point results stay within one of float math", "[fixed]") {
+    int maxDifference = 0;
+    for (pixl::f32 contrast : {0.0f, 0.3f, 0.8f, 1.0f, 1.2f, 1.37f, 2.5f, -0.7f}) {
+        for (int value = 0; value < 256; value++) {
+            const pixl::f32 exact = contrast * (value - 128) + 128;
+            const int expected = (int)std::max(0.0f, std::min(255.0f, exact));
+            const int actual = pixl::op::contrast_value((pixl::u8)value, contrast);
+            maxDifference = std::max(maxDifference, std::abs(actual - expected));
+        }
+    }
+    REQUIRE(maxDifference <= 1);
+    REQUIRE(pixl::op::contrast_value(77, 1.0f) == 77);
+
+    // bilinear resize against the same interpolation in floats
+    pixl::Image image(37, 23, 3);
+    fillTestPattern(&image);
+    pixl::Image resized(&image);
+    resized.resize(50, 17);
+
+    maxDifference = 0;
+    for (pixl::i32 y = 0; y < resized.height; y++) {
+        const pixl::u32 y0 = pixl::op::resize_bilinear_row(y, image.height, resized.height);
+        const pixl::u32 y1 = std::min((pixl::i32)y0 + 1, image.height - 1);
+        const pixl::f32 fy = (pixl::f32)y / resized.height;
+        for (pixl::i32 x = 0; x < resized.width; x++) {
+            const pixl::u32 x0 = x / (float)resized.width * (image.width - 1);
+            const pixl::f32 fx = (pixl::f32)x / resized.width;
+            for (pixl::i32 c = 0; c < 3; c++) {
+                auto at = [&](pixl::u32 px, pixl::u32 py) { return image.getPixel(px, py)[c]; };
+                const pixl::f32 top = at(x0, y0) + (at(x0 + 1, y0) - at(x0, y0)) * fx;
+                const pixl::f32 bottom = at(x0, y1) + (at(x0 + 1, y1) - at(x0, y1)) * fx;
+                const int expected = (int)(top + (bottom - top) * fy);
+                const int actual = resized.getPixel(x, y)[c];
+                maxDifference = std::max(maxDifference, std::abs(actual - expected));
+            }
+        }
+    }
+    REQUIRE(maxDifference <= 1);
+}
@@ -0,0 +1,113 @@
+#include <catch.hpp>
+#include <cstring>
+
+#include <pixl/image.h>
+#include <pixl/incremental.h>
+#include <pixl/pipeline.h>
+
+#include "helpers.h"
+
+static void paint(pixl::Image* image, const pixl::Rect& rect, pixl::u8 value) {
+    for (pixl::i32 y = rect.y; y < rect.y + rect.height; y++) {
+        memset(image->getPixel(rect.x, y), value, rect.width * image->channels);
+    }
+}
+
+TEST_CASE("Incremental updates match a full execution", "[incremental]") {
+    const pixl::Kernel sharpen = {0, -1, 0, -1, 5, -1, 0, -1, 0};
+    pixl::Pipeline pipeline;
+    pipeline.convolution(sharpen)->flip(pixl::Orientation::VERTICAL)->resize(250, 170);
+    pipeline.contrast(1.3f)->flip()->addAlphaChannel(200);
+    pipeline.resize(150, 90, pixl::ResizeMethod::NEARSET_NEIGHBOR);
+
+    pixl::Image* input = testImage(300, 200, 3);
+    pixl::IncrementalPipeline incremental(pipeline);
+    incremental.tileHeight = 16;
+    incremental.execute(input);
+
+    pixl::Rect dirty;
+    dirty.x = 40;
+    dirty.y = 120;
+    dirty.width = 20;
+    dirty.height = 10;
+    for (pixl::u8 value : {0, 255, 77}) {
+        paint(input, dirty, value);
+
+        pixl::Rect changed;
+        const pixl::Image* result = incremental.update(input, dirty, &changed);
+        REQUIRE(changed.height > 0);
+        REQUIRE(changed.height < result->height);
+        REQUIRE(changed.width < result->width);
+
+        pixl::Image* expected = new pixl::Image(input);
+        pipeline.execute(expected);
+        REQUIRE(result->width == expected->width);
+        REQUIRE(result->height == expected->height);
+        REQUIRE(result->channels == expected->channels);
+        REQUIRE(memcmp(result->data, expected->data, expected->size) == 0);
+        delete expected;
+
+        dirty.x += 100;
+        dirty.y -= 50;
+    }
+
+    delete input;
+}
+
+TEST_CASE("Changed regions hold every changed pixel", "[incremental]") {
+    for (pixl::ResizeMethod method :
+         {pixl::ResizeMethod::BILINEAR, pixl::ResizeMethod::NEARSET_NEIGHBOR}) {
+        for (pixl::u32 width : {40, 7}) {
+            pixl::Pipeline pipeline;
+            pipeline.resize(width, 30, method);
+
+            pixl::Image* input = testImage(10, 8, 3);
+            pixl::IncrementalPipeline incremental(pipeline);
+            incremental.execute(input);
+            pixl::Image before(incremental.result());
+
+            for (pixl::i32 column = 0; column < input->width; column++) {
+                pixl::Rect dirty;
+                dirty.x = column;
+                dirty.y = 3;
+                dirty.width = 1;
+                dirty.height = 1;
+                paint(input, dirty, (pixl::u8)(before.data[column] + 100));
+
+                pixl::Rect changed;
+                const pixl::Image* result = incremental.update(input, dirty, &changed);
+                int outside = 0;
+                for (pixl::i32 y = 0; y < result->height; y++) {
+                    for (pixl::i32 x = 0; x < result->width; x++) {
+                        const bool inside = x >= changed.x && x < changed.x + changed.width &&
+                                            y >= changed.y && y < changed.y + changed.height;
+                        if (!inside &&
+                            memcmp(result->getPixel(x, y), before.getPixel(x, y), 3) != 0) {
+                            outside++;
+                        }
+                    }
+                }
+                INFO("width " << width << ", column " << column);
+                REQUIRE(outside == 0);
+                memcpy(before.data, result->data, result->size);
+            }
+            delete input;
+        }
+    }
+}
+
+TEST_CASE("Incremental pipelines without operations copy the input", "[incremental]") {
+    pixl::Image* input = testImage(30, 20, 4);
+    pixl::IncrementalPipeline incremental((pixl::Pipeline()));
+    REQUIRE(incremental.result() == nullptr);
+    incremental.execute(input);
+
+    pixl::Rect dirty;
+    dirty.width = 5;
+    dirty.height = 5;
+    paint(input, dirty, 1);
+    const pixl::Image* result = incremental.update(input, dirty);
+    REQUIRE(memcmp(result->data, input->data, input->size) == 0);
+
+    delete input;
+}
@@ -0,0 +1,190 @@
+#include <catch.hpp>
+
+#include <pixl/image.h>
+#include <pixl/io.h>
+#include <pixl/operations.h>
+
+TEST_CASE("Estimating the quality of a jpeg", "[jpeg_estimate_quality]") {
+    pixl::Image image(64, 64, 3);
+    for (pixl::u64 i = 0; i < image.size; i++) {
+        image.data[i] = (pixl::u8)(i * 7);
+    }
+
+    pixl::write(&image, "test_jpeg_quality.jpg", 82);
+    REQUIRE(pixl::jpeg_estimate_quality("test_jpeg_quality.jpg") == 82);
+
+    pixl::write(&image, "test_jpeg_quality.jpg", 35);
+    REQUIRE(pixl::jpeg_estimate_quality("test_jpeg_quality.jpg") == 35);
+
+    pixl::u8 garbage[] = {1, 2, 3, 4, 5, 6};
+    REQUIRE(pixl::jpeg_estimate_quality(garbage, sizeof(garbage)) == -1);
+    REQUIRE(pixl::jpeg_estimate_quality("does_not_exist.jpg") == -1);
+}
+
+TEST_CASE("Requantizing a jpeg", "[JpegRequantizer]") {
+    pixl::Image image(64, 64, 3);
+    for (pixl::u64 i = 0; i < image.size; i++) {
+        image.data[i] = (pixl::u8)(i * 7);
+    }
+    pixl::write(&image, "test_jpeg_requantize.jpg", 95);
+
+    pixl::u64 length;
+    pixl::u8* data = pixl::read_binary("test_jpeg_requantize.jpg", &length);
+
+    pixl::JpegRequantizer requantizer;
+    requantizer.quality = 50;
+    pixl::u64 outLength;
+    pixl::u8* out = requantizer.requantize(data, length, &outLength);
+    REQUIRE(outLength < length);
+    REQUIRE(pixl::jpeg_estimate_quality(out, outLength) == 50);
+
+    // already below the target quality
+    requantizer.quality = 60;
+    pixl::u64 sameLength;
+    pixl::u8* same = requantizer.requantize(out, outLength, &sameLength);
+    REQUIRE(sameLength == outLength);
+
+    free(same);
+    free(out);
+    delete[] data;
+}
+
+TEST_CASE("Encoding a jpeg with a size budget", "[JpegTargetWriter]") {
+    pixl::Image image(64, 64, 3);
+    for (pixl::u64 i = 0; i < image.size; i++) {
+        image.data[i] = (pixl::u8)((i * 7) ^ (i >> 5));
+    }
+
+    pixl::JpegTargetWriter writer;
+    writer.maxBytes = 4000;
+    std::vector<pixl::u8> out;
+    writer.encode(&image, out);
+    REQUIRE(out.size() <= writer.maxBytes);
+
+    // one quality step up must not fit anymore
+    pixl::JpegTurboWriter reference;
+    reference.quality = writer.quality + 1;
+    std::vector<pixl::u8> bigger;
+    reference.encode(&image, bigger);
+    REQUIRE(bigger.size() > writer.maxBytes);
+}
+
+// Smooth gradients with some noise, so the SSIM drops steadily with the quality.
+static pixl::Image* photoLike(pixl::u32 width, pixl::u32 height) {
+    pixl::Image* image = new pixl::Image(width, height, 3);
+    pixl::u32 seed = 1;
+    for (pixl::u32 y = 0; y < height; y++) {
+        for (pixl::u32 x = 0; x < width; x++) {
+            pixl::u8* pixel = image->getPixel(x, y);
+            for (pixl::u32 c = 0; c < 3; c++) {
+                seed = seed * 1103515245 + 12345;
+                pixel[c] = (pixl::u8)((x * (c + 1) + y * 2) / 3 % 200 + (seed >> 16) % 40);
+            }
+        }
+    }
+    return image;
+}
+
+// Decodes a jpeg and compares it to the original.
+static pixl::f64 ssimOf(const pixl::Image* image, const std::vector<pixl::u8>& jpeg) {
+    pixl::JpegTurboReader reader;
+    pixl::Image* decoded = reader.decode(jpeg.data(), jpeg.size());
+    const pixl::f64 ssim = pixl::op::ssim(image, decoded);
+    delete decoded;
+    return ssim;
+}
+
+TEST_CASE("Encoding a jpeg with a minimum SSIM", "[JpegTargetWriter]") {
+    pixl::Image* image = photoLike(64, 64);
+
+    pixl::JpegTargetWriter writer;
+    writer.minSsim = 0.9f;
+    std::vector<pixl::u8> out;
+    writer.encode(image, out);
+    REQUIRE(ssimOf(image, out) >= writer.minSsim);
+    REQUIRE(writer.quality < writer.maxQuality);
+
+    delete image;
+}
+
+TEST_CASE("Encoding a large jpeg starts from a sample of the image", "[JpegTargetWriter]") {
+    // at least 4x4 cells of 64 pixels, so the initial guesses come from a mosaic
+    pixl::Image* image = photoLike(320, 288);
+
+    pixl::JpegTargetWriter writer;
+    writer.minSsim = 0.9f;
+    std::vector<pixl::u8> out;
+    writer.encode(image, out);
+    REQUIRE(ssimOf(image, out) >= writer.minSsim);
+
+    pixl::JpegTargetWriter sized;
+    sized.maxBytes = 20000;
+    sized.encode(image, out);
+    REQUIRE(out.size() <= sized.maxBytes);
+
+    // one quality step up must not fit anymore
+    pixl::JpegTurboWriter reference;
+    reference.quality = sized.quality + 1;
+    std::vector<pixl::u8> bigger;
+    reference.encode(image, bigger);
+    REQUIRE(bigger.size() > sized.maxBytes);
+
+    delete image;
+}
+
+// Creates a jpeg with an exif thumbnail by splicing an APP1 segment behind the SOI marker.
+static std::vector<pixl::u8> jpegWithThumbnail(pixl::u32 width, pixl::u32 height) {
+    pixl::JpegTurboWriter writer;
+    pixl::Image image(width, height, 3);
+    pixl::Image thumb(width / 2, height / 2, 3);
+    std::vector<pixl::u8> main, small;
+    writer.encode(&image, main);
+    writer.encode(&thumb, small);
+
+    // little endian tiff: empty IFD0, IFD1 with thumbnail offset & length
+    std::vector<pixl::u8> tiff = {'I', 'I', '*', 0, 8, 0, 0, 0, 0, 0, 14, 0, 0, 0, 2, 0,
+                                  0x01, 0x02, 4, 0, 1, 0, 0, 0, 44, 0, 0, 0,
+                                  0x02, 0x02, 4, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    tiff[36] = small.size() & 0xFF;
+    tiff[37] = small.size() >> 8;
+    tiff.insert(tiff.end(), small.begin(), small.end());
+
+    std::vector<pixl::u8> app1 = {0xFF, 0xE1, 0, 0, 'E', 'x', 'i', 'f', 0, 0};
+    app1.insert(app1.end(), tiff.begin(), tiff.end());
+    app1[2] = (app1.size() - 2) >> 8;
+    app1[3] = (app1.size() - 2) & 0xFF;
+
+    main.insert(main.begin() + 2, app1.begin(), app1.end());
+    return main;
+}
+
+TEST_CASE("Reading the exif thumbnail of a jpeg", "[jpeg_exif_thumbnail]") {
+    auto jpeg = jpegWithThumbnail(320, 240);
+
+    pixl::u64 thumbLength;
+    REQUIRE(pixl::jpeg_exif_thumbnail(jpeg.data(), jpeg.size(), &thumbLength) != nullptr);
+
+    pixl::JpegTurboReader reader;
+    reader.minWidth = 100;
+    reader.minHeight = 75;
+    pixl::Image* image = reader.decode(jpeg.data(), jpeg.size());
+    REQUIRE(image->width == 160);
+    REQUIRE(image->height == 120);
+    delete image;
+
+    // thumbnail too small, DCT scaled by 5/8 instead
+    reader.minWidth = 200;
+    reader.minHeight = 150;
+    image = reader.decode(jpeg.data(), jpeg.size());
+    REQUIRE(image->width == 200);
+    REQUIRE(image->height == 150);
+    delete image;
+
+    // no scaling factor small enough
+    reader.minWidth = 300;
+    reader.minHeight = 230;
+    image = reader.decode(jpeg.data(), jpeg.size());
+    REQUIRE(image->width == 320);
+    REQUIRE(image->height == 240);
+    delete image;
+}
@@ -0,0 +1,71 @@
+#include <catch.hpp>
+#include <cstring>
+
+#include <pixl/image.h>
+#include <pixl/numa.h>
+#include <pixl/threads.h>
+
+TEST_CASE("NUMA topology & stats", "[numa]") {
+    const auto& nodes = pixl::numa_nodes();
+    REQUIRE(nodes.size() >= 1);
+
+    bool found = false;
+    for (pixl::u32 node : nodes) {
+        REQUIRE(pixl::numa_cpus(node).size() > 0);
+        found = found || node == pixl::numa_current_node();
+    }
+    REQUIRE(found);
+
+    pixl::Image image(400, 300, 3);
+    REQUIRE(pixl::numa_node_of(image.data) >= -1);
+
+    auto before = pixl::numa_stats();
+    REQUIRE(before.size() == nodes.size());
+    {
+        pixl::ThreadScope scope(4);
+        pixl::NumaScope numa(nodes.back());
+        pixl::parallel_for(0, 64, 1, [](pixl::i64, pixl::i64) {});
+    }
+    auto after = pixl::numa_stats();
+
+    pixl::u64 bytes = 0, workers = 0;
+    for (size_t i = 0; i < after.size(); i++) {
+        bytes += after[i].bytes - before[i].bytes;
+        workers += after[i].workers;
+        REQUIRE(after[i].tasks >= before[i].tasks);
+        REQUIRE(after[i].remoteTasks <= after[i].tasks);
+    }
+    REQUIRE(workers > 0);
+    REQUIRE(bytes == 0);
+
+    // buffers of new images are counted
+    pixl::Image other(100, 100, 4);
+    pixl::u64 placed = 0;
+    for (auto& stats : pixl::numa_stats()) {
+        placed += stats.bytes;
+    }
+    REQUIRE(placed >= other.size);
+}
+
+TEST_CASE("Pinned workers compute the same results", "[numa]") {
+    pixl::Image* expected = new pixl::Image(321, 123, 3);
+    for (pixl::u64 i = 0; i < expected->size; i++) {
+        expected->data[i] = (pixl::u8)(i * 13);
+    }
+    pixl::Image* image = new pixl::Image(expected);
+    {
+        pixl::ThreadScope scope(1);
+        expected->resize(200, 100)->invert()->addAlphaChannel();
+    }
+
+    pixl::set_thread_pinning(true);
+    {
+        pixl::ThreadScope scope(4);
+        image->resize(200, 100)->invert()->addAlphaChannel();
+    }
+    pixl::set_thread_pinning(false);
+
+    REQUIRE(memcmp(image->data, expected->data, expected->size) == 0);
+    delete expected;
+    delete image;
+}
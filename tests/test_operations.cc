@@ -0,0 +1,37 @@
+#include <catch.hpp>
+
+#include <pixl/image.h>
+#include <pixl/operations.h>
+
+TEST_CASE("Detecting opaque images", "[is_opaque]") {
+    // odd size, so both the vectorized part and the tail get checked
+    pixl::Image image(37, 5, 4);
+    for (pixl::u64 i = 0; i < image.size; i++) {
+        image.data[i] = (i % 4 == 3) ? 255 : (pixl::u8)i;
+    }
+    REQUIRE(pixl::op::is_opaque(&image));
+
+    image.data[image.size - 1] = 254;
+    REQUIRE_FALSE(pixl::op::is_opaque(&image));
+
+    image.data[image.size - 1] = 255;
+    image.data[3] = 0;
+    REQUIRE_FALSE(pixl::op::is_opaque(&image));
+
+    pixl::Image rgb(4, 4, 3);
+    REQUIRE(pixl::op::is_opaque(&rgb));
+}
+
+TEST_CASE("Removing the alpha channel", "[remove_alpha_channel]") {
+    pixl::Image image(3, 2, 4);
+    for (pixl::u64 i = 0; i < image.size; i++) {
+        image.data[i] = (pixl::u8)i;
+    }
+
+    pixl::op::remove_alpha_channel(&image);
+    REQUIRE(image.channels == 3);
+    REQUIRE(image.size == 18);
+    for (pixl::u64 i = 0; i < image.size; i++) {
+        REQUIRE(image.data[i] == (i / 3) * 4 + i % 3);
+    }
+}
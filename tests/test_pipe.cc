@@ -0,0 +1,46 @@
+#include <catch.hpp>
+#include <cstring>
+
+#include <pixl/image.h>
+#include <pixl/pipe.h>
+
+#include "helpers.h"
+
+// A stage that isn't part of the library
+struct threshold {
+    template <pixl::u32 C>
+    inline void apply(pixl::u8* pixel) const {
+        for (pixl::u32 c = 0; c < std::min(C, 3u); c++) {
+            pixel[c] = pixel[c] < 128 ? 0 : 255;
+        }
+    }
+};
+
+TEST_CASE("Fused pipes match eager execution", "[pipe]") {
+    auto recipe = pixl::pipe(pixl::invert{}, pixl::contrast{1.2f}, pixl::grayscale{},
+                             pixl::contrast{0.8f});
+
+    for (pixl::u32 channels = 1; channels <= 4; channels++) {
+        pixl::Image* eager = testImage(123, 45, channels);
+        pixl::Image* fused = new pixl::Image(eager);
+
+        eager->invert()->contrast(1.2f)->grayscale()->contrast(0.8f);
+        recipe(fused);
+
+        REQUIRE(memcmp(fused->data, eager->data, eager->size) == 0);
+        delete eager;
+        delete fused;
+    }
+}
+
+TEST_CASE("Pipes accept custom stages", "[pipe]") {
+    pixl::Image* image = testImage(16, 16, 3);
+    pixl::pipe(pixl::grayscale{}, threshold{})(image)->invert();
+
+    int other = 0;
+    for (pixl::u64 i = 0; i < image->size; i++) {
+        other += image->data[i] != 0 && image->data[i] != 255;
+    }
+    REQUIRE(other == 0);
+    delete image;
+}
@@ -0,0 +1,123 @@
+#include <catch.hpp>
+#include <cstring>
+
+#include <pixl/image.h>
+#include <pixl/pipeline.h>
+
+#include "helpers.h"
+
+TEST_CASE("Fused point operations match eager execution", "[pipeline]") {
+    pixl::Image* eager = testImage(31, 17, 4);
+    pixl::Image* lazy = new pixl::Image(eager);
+
+    eager->contrast(1.5f)->invert()->grayscale()->contrast(0.7f)->grayscale()->invert();
+
+    pixl::Pipeline pipeline;
+    pipeline.contrast(1.5f)->invert()->grayscale()->contrast(0.7f)->grayscale()->invert();
+    auto plan = pipeline.plan(lazy->width, lazy->height, lazy->channels);
+    REQUIRE(plan.size() == 1);
+    REQUIRE(plan[0].type == pixl::OperationType::POINT);
+
+    pipeline.execute(lazy);
+    REQUIRE(lazy->size == eager->size);
+    REQUIRE(memcmp(lazy->data, eager->data, eager->size) == 0);
+
+    delete eager;
+    delete lazy;
+}
+
+TEST_CASE("Pipeline drops operations without effect", "[pipeline]") {
+    pixl::Pipeline pipeline;
+    pipeline.flip()->invert()->flip(pixl::Orientation::VERTICAL)->flip()->contrast(1);
+    pipeline.addAlphaChannel()->removeAlphaChannel()->removeAlphaChannel();
+
+    auto plan = pipeline.plan(20, 20, 3);
+    REQUIRE(plan.size() == 2);
+    REQUIRE(plan[0].type == pixl::OperationType::INVERT);
+    REQUIRE(plan[1].type == pixl::OperationType::FLIP);
+    REQUIRE(plan[1].orientation == pixl::Orientation::VERTICAL);
+
+    pixl::Image* eager = testImage(20, 20, 3);
+    pixl::Image* lazy = new pixl::Image(eager);
+    eager->flip()->invert()->flip(pixl::Orientation::VERTICAL)->flip();
+    pipeline.execute(lazy);
+    REQUIRE(memcmp(lazy->data, eager->data, eager->size) == 0);
+
+    delete eager;
+    delete lazy;
+}
+
+TEST_CASE("Pipeline moves downscales in front of point operations", "[pipeline]") {
+    pixl::Pipeline pipeline;
+    pipeline.contrast(1.2f)->invert()->resize(10, 5, pixl::ResizeMethod::NEARSET_NEIGHBOR);
+
+    auto plan = pipeline.plan(40, 20, 3);
+    REQUIRE(plan.size() == 2);
+    REQUIRE(plan[0].type == pixl::OperationType::RESIZE);
+    REQUIRE(plan[1].type == pixl::OperationType::POINT);
+
+    pixl::Image* eager = testImage(40, 20, 3);
+    pixl::Image* lazy = new pixl::Image(eager);
+    eager->contrast(1.2f)->invert()->resize(10, 5, pixl::ResizeMethod::NEARSET_NEIGHBOR);
+    pipeline.execute(lazy);
+    REQUIRE(lazy->width == 10);
+    REQUIRE(lazy->height == 5);
+    REQUIRE(memcmp(lazy->data, eager->data, eager->size) == 0);
+
+    // upscales stay where they are
+    pixl::Pipeline upscale;
+    upscale.invert()->resize(80, 40);
+    plan = upscale.plan(40, 20, 3);
+    REQUIRE(plan[0].type == pixl::OperationType::INVERT);
+
+    delete eager;
+    delete lazy;
+}
+
+TEST_CASE("Optimized pipelines give the same bytes as eager execution", "[pipeline]") {
+    for (auto method : {pixl::ResizeMethod::NEARSET_NEIGHBOR, pixl::ResizeMethod::BILINEAR}) {
+        pixl::Image* eager = testImage(41, 23, 3);
+        pixl::Image* lazy = new pixl::Image(eager);
+        eager->contrast(1.4f)->grayscale()->addAlphaChannel()->invert()->resize(13, 7, method);
+
+        pixl::Pipeline pipeline;
+        pipeline.contrast(1.4f)->grayscale()->addAlphaChannel()->invert()->resize(13, 7, method);
+        pipeline.execute(lazy);
+
+        REQUIRE(lazy->width == eager->width);
+        REQUIRE(lazy->height == eager->height);
+        REQUIRE(lazy->channels == eager->channels);
+        REQUIRE(memcmp(lazy->data, eager->data, eager->size) == 0);
+
+        delete eager;
+        delete lazy;
+    }
+}
+
+TEST_CASE("Band execution matches eager execution", "[pipeline]") {
+    const pixl::Kernel sharpen = {0, -1, 0, -1, 5, -1, 0, -1, 0};
+
+    pixl::Image* eager = testImage(45, 37, 3);
+    eager->convolution(sharpen)->flip(pixl::Orientation::VERTICAL)->resize(60, 50);
+    eager->addAlphaChannel(128)->contrast(1.3f)->flip()->convolution(sharpen, 0.5f);
+    eager->resize(21, 13, pixl::ResizeMethod::NEARSET_NEIGHBOR)->removeAlphaChannel();
+
+    pixl::Pipeline pipeline;
+    pipeline.convolution(sharpen)->flip(pixl::Orientation::VERTICAL)->resize(60, 50);
+    pipeline.addAlphaChannel(128)->contrast(1.3f)->flip()->convolution(sharpen, 0.5f);
+    pipeline.resize(21, 13, pixl::ResizeMethod::NEARSET_NEIGHBOR)->removeAlphaChannel();
+
+    for (pixl::u32 rows : {1, 3, 0}) {
+        pixl::Image* lazy = testImage(45, 37, 3);
+        pipeline.bandHeight = rows;
+        pipeline.execute(lazy);
+
+        REQUIRE(lazy->width == eager->width);
+        REQUIRE(lazy->height == eager->height);
+        REQUIRE(lazy->channels == eager->channels);
+        REQUIRE(memcmp(lazy->data, eager->data, eager->size) == 0);
+        delete lazy;
+    }
+
+    delete eager;
+}
@@ -0,0 +1,83 @@
+#include <catch.hpp>
+#include <cstring>
+
+#include <pixl/image.h>
+#include <pixl/io.h>
+#include <pixl/preview.h>
+
+#include "helpers.h"
+
+TEST_CASE("Pipelines are adapted to the proxy", "[preview]") {
+    const pixl::Kernel blur = {1, 2, 1, 2, 4, 2, 1, 2, 1};
+    pixl::Pipeline pipeline;
+    pipeline.resize(800, 600)->convolution(blur, 1 / 16.0f)->invert();
+
+    auto adapted = pixl::Preview::adapt(pipeline, 0.25f, 0.25f);
+    const auto& ops = adapted.operations();
+    REQUIRE(ops.size() == 3);
+    REQUIRE(ops[0].width == 200);
+    REQUIRE(ops[0].height == 150);
+
+    // a quarter of the blur, the kernel still sums up to 1
+    float sum = 0;
+    for (float k : ops[1].kernel) {
+        sum += k;
+    }
+    REQUIRE(sum == Approx(1.0f));
+    REQUIRE(ops[1].kernel[4] == Approx(0.25f * 4 / 16 + 0.75f));
+    REQUIRE(ops[2].type == pixl::OperationType::INVERT);
+
+    // no changes at full scale
+    auto same = pixl::Preview::adapt(pipeline, 1, 1);
+    REQUIRE(same.operations()[0].width == 800);
+    REQUIRE(same.operations()[1].kernel[0] == Approx(1 / 16.0f));
+}
+
+TEST_CASE("Previews render on the proxy & commit at full size", "[preview]") {
+    pixl::Image* input = testImage(1000, 500, 3);
+    pixl::Preview preview(input, 200, 200);
+    REQUIRE(preview.proxy()->width == 200);
+    REQUIRE(preview.proxy()->height == 100);
+    REQUIRE(preview.scaleX() == Approx(0.2f));
+
+    pixl::Pipeline pipeline;
+    pipeline.contrast(1.2f)->resize(500, 250);
+
+    pixl::Image* rendered = preview.render(pipeline);
+    REQUIRE(rendered->width == 100);
+    REQUIRE(rendered->height == 50);
+
+    pixl::Image* committed = preview.commit(pipeline);
+    REQUIRE(committed->width == 500);
+    REQUIRE(committed->height == 250);
+
+    pixl::Image* expected = new pixl::Image(input);
+    pipeline.execute(expected);
+    REQUIRE(memcmp(committed->data, expected->data, expected->size) == 0);
+
+    delete rendered;
+    delete committed;
+    delete expected;
+    delete input;
+}
+
+TEST_CASE("Previews of jpegs are decoded at a reduced size", "[preview]") {
+    pixl::Image* input = testImage(1600, 1200, 3);
+    pixl::write(input, "test_preview.jpg");
+
+    pixl::Preview preview("test_preview.jpg", 300, 300);
+    REQUIRE(preview.proxy()->width == 300);
+    REQUIRE(preview.proxy()->height == 225);
+    REQUIRE(preview.scaleX() == Approx(300 / 1600.0f));
+
+    pixl::Pipeline pipeline;
+    pipeline.resize(800, 600);
+    pixl::Image* rendered = preview.render(pipeline);
+    REQUIRE(rendered->width == 150);
+    pixl::Image* committed = preview.commit(pipeline);
+    REQUIRE(committed->width == 800);
+
+    delete rendered;
+    delete committed;
+    delete input;
+}
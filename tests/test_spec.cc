@@ -0,0 +1,89 @@
+#include <catch.hpp>
+#include <cstring>
+#include <string>
+
+#include <pixl/errors.h>
+#include <pixl/image.h>
+#include <pixl/io.h>
+#include <pixl/pipeline.h>
+
+TEST_CASE("Pipeline specs round trip", "[spec]") {
+    auto pipeline = pixl::Pipeline::parse(
+        "resize:512x384|flip:v|convolution:0,-1,0,-1,5,-1,0,-1,0|contrast:1.2|"
+        "add_alpha|remove_alpha|grayscale|invert|jpeg:q=82:420");
+
+    const std::string canonical =
+        "resize:512x384:bilinear|flip:vertical|convolution:0,-1,0,-1,5,-1,0,-1,0:1|"
+        "contrast:1.2|add_alpha:255|remove_alpha|grayscale|invert|jpeg:q=82:420";
+    REQUIRE(pipeline.toString() == canonical);
+    REQUIRE(pipeline.operations().size() == 8);
+    REQUIRE(pipeline.encoding.format == pixl::ImageFormat::JPEG);
+    REQUIRE(pipeline.encoding.quality == 82);
+    REQUIRE(pipeline.encoding.subsampling == pixl::ChromaSubsampling::YUV420);
+    REQUIRE(pixl::Pipeline::parse(canonical).toString() == canonical);
+
+    // built in code
+    pixl::Pipeline built;
+    built.resize(10, 20, pixl::ResizeMethod::NEARSET_NEIGHBOR)->contrast(0.1f)->flip();
+    REQUIRE(built.toString() == "resize:10x20:nearest|contrast:0.1|flip:horizontal");
+    REQUIRE(pixl::Pipeline::parse(built.toString()).toString() == built.toString());
+
+    REQUIRE(pixl::Pipeline::parse("").toString() == "");
+    REQUIRE(pixl::Pipeline::parse("png").toString() == "png");
+}
+
+TEST_CASE("Invalid pipeline specs throw", "[spec]") {
+    const char* invalid[] = {
+        "resize:512x512:lanczos3",
+        "unsharp:1.0",
+        "resize:512",
+        "resize:0x10",
+        "resize:ax10",
+        "contrast",
+        "contrast:1.2:3",
+        "contrast:nan",
+        "contrast:inf",
+        "contrast:-infinity",
+        "convolution:0,0,0,0,nan,0,0,0,0",
+        "convolution:0,0,0,0,1,0,0,0,0:inf",
+        "convolution:1,2,3",
+        "add_alpha:256",
+        "invert||grayscale",
+        "invert|",
+        "flip:",
+        "jpeg:q=101",
+        "jpeg:q=0",
+        "jpeg:411",
+        "jpeg|invert",
+    };
+
+    for (const char* spec : invalid) {
+        INFO(spec);
+        REQUIRE_THROWS_AS(pixl::Pipeline::parse(spec), const pixl::PixlException&);
+    }
+}
+
+TEST_CASE("Executing a parsed pipeline", "[spec]") {
+    pixl::Image* image = new pixl::Image(64, 48, 3);
+    for (pixl::u64 i = 0; i < image->size; i++) {
+        image->data[i] = (pixl::u8)(i * 5 + i / 7);
+    }
+    pixl::Image* expected = new pixl::Image(image);
+    expected->resize(32, 24)->invert()->flip();
+
+    auto pipeline = pixl::Pipeline::parse("resize:32x24|invert|flip|jpeg:q=90:420");
+    pipeline.execute(image);
+    REQUIRE(image->width == 32);
+    REQUIRE(image->height == 24);
+    REQUIRE(memcmp(image->data, expected->data, expected->size) == 0);
+
+    // the encoder of the spec wins over the file extension
+    pipeline.write(image, "test_spec.png");
+    pixl::Image* jpeg = pixl::JpegTurboReader().read("test_spec.png");
+    REQUIRE(jpeg != nullptr);
+    REQUIRE(jpeg->width == 32);
+
+    delete jpeg;
+    delete image;
+    delete expected;
+}
@@ -0,0 +1,200 @@
+#include <catch.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <pixl/image.h>
+#include <pixl/pipeline.h>
+#include <pixl/threads.h>
+
+static pixl::Image* randomImage(pixl::u32 width, pixl::u32 height, pixl::u32 channels) {
+    pixl::Image* image = new pixl::Image(width, height, channels);
+    pixl::u32 state = 42;
+    for (pixl::u64 i = 0; i < image->size; i++) {
+        state = state * 1103515245 + 12345;
+        image->data[i] = (pixl::u8)(state >> 16);
+    }
+    return image;
+}
+
+static void process(pixl::Image* image) {
+    const pixl::Kernel blur = {1, 2, 1, 2, 4, 2, 1, 2, 1};
+    image->convolution(blur, 1 / 16.0f)->flip(pixl::Orientation::VERTICAL)->flip();
+    image->resize(700, 500)->contrast(1.2f)->invert()->grayscale()->addAlphaChannel();
+    image->resize(301, 199, pixl::ResizeMethod::NEARSET_NEIGHBOR)->removeAlphaChannel();
+}
+
+TEST_CASE("parallel_for visits every item once", "[threads]") {
+    std::vector<std::atomic<int>> visits(10007);
+    for (auto& v : visits) {
+        v = 0;
+    }
+
+    std::atomic<int> largeRanges(0);
+    pixl::ThreadScope scope(4);
+    pixl::parallel_for(0, visits.size(), 100, [&](pixl::i64 from, pixl::i64 to) {
+        if (to - from > 100)
+            largeRanges++;
+        // nested calls run on the same pool
+        pixl::parallel_for(from, to, 10, [&](pixl::i64 a, pixl::i64 b) {
+            for (pixl::i64 i = a; i < b; i++) {
+                visits[i]++;
+            }
+        });
+    });
+
+    int wrong = 0;
+    for (auto& v : visits) {
+        wrong += (v != 1);
+    }
+    REQUIRE(wrong == 0);
+    REQUIRE(largeRanges == 0);
+
+    REQUIRE_THROWS_AS(pixl::parallel_for(0, 100, 1,
+                                         [](pixl::i64 from, pixl::i64) {
+                                             if (from == 50)
+                                                 throw std::runtime_error("fail");
+                                         }),
+                      const std::runtime_error&);
+}
+
+TEST_CASE("Results don't depend on the number of threads", "[threads]") {
+    pixl::Image* single = randomImage(999, 701, 3);
+    pixl::Image* multi = new pixl::Image(single);
+    pixl::Image* pipelined = new pixl::Image(single);
+
+    {
+        pixl::ThreadScope scope(1);
+        process(single);
+    }
+    {
+        pixl::ThreadScope scope(8);
+        process(multi);
+
+        pixl::Pipeline pipeline;
+        const pixl::Kernel blur = {1, 2, 1, 2, 4, 2, 1, 2, 1};
+        pipeline.convolution(blur, 1 / 16.0f)->flip(pixl::Orientation::VERTICAL)->flip();
+        pipeline.resize(700, 500)->contrast(1.2f)->invert()->grayscale()->addAlphaChannel();
+        pipeline.resize(301, 199, pixl::ResizeMethod::NEARSET_NEIGHBOR)->removeAlphaChannel();
+        pipeline.execute(pipelined);
+    }
+
+    REQUIRE(multi->size == single->size);
+    REQUIRE(memcmp(multi->data, single->data, single->size) == 0);
+    REQUIRE(pipelined->size == single->size);
+    REQUIRE(memcmp(pipelined->data, single->data, single->size) == 0);
+
+    delete single;
+    delete multi;
+    delete pipelined;
+}
+
+TEST_CASE("Running on a caller provided executor", "[threads]") {
+    std::atomic<int> tasks(0);
+    std::vector<std::thread> threads;
+    pixl::Executor executor = [&](pixl::Task task) {
+        tasks++;
+        threads.push_back(std::thread(task));
+    };
+
+    pixl::Image* expected = randomImage(640, 480, 4);
+    pixl::Image* image = new pixl::Image(expected);
+    {
+        pixl::ThreadScope scope(1);
+        expected->grayscale()->resize(320, 240);
+    }
+    {
+        pixl::ThreadScope scope(4, executor);
+        image->grayscale()->resize(320, 240);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    REQUIRE(tasks > 0);
+    REQUIRE(memcmp(image->data, expected->data, expected->size) == 0);
+
+    delete expected;
+    delete image;
+}
+
+// Queues the tasks on a pool with a single, busy worker and returns the order they ran in.
+static std::vector<int> runOrder(pixl::u32 aging, pixl::u32 waitMillis) {
+    std::vector<int> order;
+    std::mutex mutex;
+    std::atomic<bool> started(false);
+    std::atomic<bool> release(false);
+    {
+        pixl::ThreadPool pool(1);
+        pool.setAging(aging);
+        pool.submit([&]() {
+            started = true;
+            while (!release) {
+                std::this_thread::yield();
+            }
+        });
+        while (!started) {
+            std::this_thread::yield();
+        }
+
+        auto record = [&](int id) {
+            return [&, id]() {
+                std::lock_guard<std::mutex> lock(mutex);
+                order.push_back(id);
+            };
+        };
+        pool.submit(record(0), -1, pixl::Priority::LOW);
+        pool.submit(record(1), -1, pixl::Priority::NORMAL);
+        std::this_thread::sleep_for(std::chrono::milliseconds(waitMillis));
+        pool.submit(record(2), -1, pixl::Priority::HIGH);
+        REQUIRE(pool.preempted(pixl::Priority::NORMAL));
+        REQUIRE_FALSE(pool.preempted(pixl::Priority::HIGH));
+        release = true;
+    }
+    return order;
+}
+
+TEST_CASE("Higher priorities run first, waiting tasks age", "[threads]") {
+    REQUIRE(runOrder(0, 0) == std::vector<int>({2, 1, 0}));
+
+    // queued long enough to overtake, the oldest priority first
+    REQUIRE(runOrder(10, 50) == std::vector<int>({0, 1, 2}));
+}
+
+TEST_CASE("Low priority bands make way for high priority tasks", "[threads]") {
+    std::vector<std::atomic<int>> visits(2000);
+    for (auto& v : visits) {
+        v = 0;
+    }
+
+    std::atomic<int> urgent(0);
+    {
+        pixl::ThreadScope threads(4);
+        pixl::PriorityScope priority(pixl::Priority::LOW);
+        pixl::parallel_for(0, visits.size(), 10, [&](pixl::i64 from, pixl::i64 to) {
+            if (from % 500 == 0) {
+                pixl::PriorityScope high(pixl::Priority::HIGH);
+                pixl::run_async([&]() { urgent++; });
+            }
+            for (pixl::i64 i = from; i < to; i++) {
+                visits[i]++;
+            }
+        });
+        REQUIRE(pixl::current_priority() == pixl::Priority::LOW);
+    }
+    REQUIRE(pixl::current_priority() == pixl::Priority::NORMAL);
+
+    while (urgent < 4) {
+        std::this_thread::yield();
+    }
+
+    int wrong = 0;
+    for (auto& v : visits) {
+        wrong += (v != 1);
+    }
+    REQUIRE(wrong == 0);
+}